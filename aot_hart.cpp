@@ -0,0 +1,181 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "aot_hart.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+//******************************************************************************
+// This constructor creates a hart for a table of translated blocks. The range
+// of translated code is derived from the word list so that stores into it can
+// be detected.
+//
+// Parameters:
+//   m  - Reference to the simulated memory object backing this hart.
+//   b  - The block table, sorted by pc.
+//   nb - The number of blocks.
+//   w  - The translated instruction words, sorted by address.
+//   nw - The number of words.
+//******************************************************************************
+aot_hart::aot_hart(memory &m, const aot_block *b, size_t nb, const aot_word *w, size_t nw)
+    : cpu_single_hart(m), blocks(b), nblocks(nb), words(w), nwords(nw)
+{
+    if (nwords)
+    {
+        code_lo = words[0].addr;
+        code_hi = words[nwords - 1].addr + 4;
+    }
+}
+
+//******************************************************************************
+// This function finds the translated block that starts at addr.
+//
+// Parameters:
+//   addr - The pc to look up.
+//   len  - Set to the number of instructions in the block.
+//
+// Return value:
+//   The block function, or nullptr if there is none.
+//******************************************************************************
+aot_block_fn aot_hart::lookup(uint32_t addr, uint32_t &len) const
+{
+    const aot_block *end = blocks + nblocks;
+    const aot_block *b = lower_bound(blocks, end, addr,
+        [](const aot_block &blk, uint32_t a) { return blk.pc < a; });
+
+    if (b == end || b->pc != addr)
+        return nullptr;
+
+    len = b->len;
+    return b->fn;
+}
+
+//******************************************************************************
+// This function keeps the interpreter's instruction cache coherent after a
+// store from a translated block and notes whether translated code was hit.
+//
+// Parameters:
+//   addr - The address of the first byte stored.
+//   len  - The number of bytes stored.
+//
+// Return value:
+//   true if the translated blocks may no longer match memory.
+//******************************************************************************
+bool aot_hart::stored(uint32_t addr, uint32_t len)
+{
+    invalidate(addr, len);
+    if (static_cast<uint64_t>(addr) + len > code_lo && addr < code_hi)
+        dirty = true;
+    return dirty;
+}
+
+//******************************************************************************
+// STORES
+// Translated blocks store through these so that the hart sees every write.
+//
+// Parameters:
+//   addr - The effective address.
+//   val  - The value to store (only the low bits are used).
+//
+// Return value:
+//   true if the calling block must stop because it stored into translated code.
+//******************************************************************************
+
+bool aot_hart::store8(uint32_t addr, uint32_t val)
+{
+    mem.set8(addr, static_cast<uint8_t>(val));
+    return stored(addr, 1);
+}
+
+bool aot_hart::store16(uint32_t addr, uint32_t val)
+{
+    mem.set16(addr, static_cast<uint16_t>(val));
+    return stored(addr, 2);
+}
+
+bool aot_hart::store32(uint32_t addr, uint32_t val)
+{
+    mem.set32(addr, val);
+    return stored(addr, 4);
+}
+
+//******************************************************************************
+// This function runs the translated program until the hart halts or the limit
+// is reached and then reports the result the same way cpu_single_hart::run()
+// does. If the loaded image does not match the translated words every
+// instruction is interpreted instead.
+//
+// Parameters:
+//   exec_limit - maximum number of instructions to execute (0 = no limit)
+//
+// Return value:
+//   None
+//******************************************************************************
+void aot_hart::run(uint64_t exec_limit)
+{
+    regs.set(2, static_cast<int32_t>(mem.get_size()));
+
+    for (size_t i = 0; i < nwords && !dirty; ++i)
+    {
+        if (words[i].addr >= mem.get_size() || mem.get32(words[i].addr) != words[i].insn)
+        {
+            cerr << "WARNING: image does not match the translated code, interpreting" << endl;
+            dirty = true;
+        }
+    }
+
+    uint64_t limit = exec_limit ? exec_limit : UINT64_MAX;
+    auto start_time = chrono::steady_clock::now();
+
+    aot_state s = { regs.data(), &mem, this, 0, 0 };
+
+    while (!is_halted() && insn_counter < limit)
+    {
+        uint32_t len = 0;
+        aot_block_fn fn = dirty ? nullptr : lookup(pc, len);
+
+        if (fn && limit - insn_counter >= len)
+        {
+            s.pc = pc;
+            s.executed = 0;
+            fn(s);
+            pc = s.pc;
+            insn_counter += s.executed;
+        }
+        else
+        {
+            tick("");
+        }
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start_time;
+
+    if (is_halted())
+        cout << "Execution terminated. Reason: "
+                  << get_halt_reason() << "\n";
+
+    cout << get_insn_counter() << " instructions executed" << endl;
+
+    if (show_speed)
+    {
+        double secs = elapsed.count();
+        double mips = secs > 0 ? get_insn_counter() / secs / 1e6 : 0;
+        ios::fmtflags flags = cout.flags();
+        streamsize prec = cout.precision();
+        cout << fixed << setprecision(2) << mips << " MIPS ("
+             << secs << " seconds)" << endl;
+        cout.flags(flags);
+        cout.precision(prec);
+    }
+}
@@ -0,0 +1,88 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "cpu_single_hart.h"
+#include "memory.h"
+
+class aot_hart;
+
+//******************************************************************************
+// The state a translated block works on. The block executes its instructions
+// on x (the hart's register file, in place), then sets pc to where execution
+// continues and executed to the number of instructions it retired.
+//******************************************************************************
+struct aot_state
+{
+    int32_t *x;
+    memory *mem;
+    aot_hart *hart;
+    uint32_t pc;
+    uint32_t executed;
+};
+
+typedef void (*aot_block_fn)(aot_state &s);
+
+//******************************************************************************
+// One entry of the block table emitted by rv32i_aot, sorted by pc. len is the
+// number of instructions the block retires when it runs to the end.
+//******************************************************************************
+struct aot_block
+{
+    uint32_t pc;
+    uint32_t len;
+    aot_block_fn fn;
+};
+
+//******************************************************************************
+// One guest instruction word that was translated, used to check at start-up
+// that the loaded image is the one the blocks were generated from.
+//******************************************************************************
+struct aot_word
+{
+    uint32_t addr;
+    uint32_t insn;
+};
+
+//******************************************************************************
+// A single hart that runs the C++ blocks generated ahead of time by rv32i_aot.
+// Execution is dispatched through the block table by pc. Whenever there is no
+// block for the pc (an unresolved indirect jump target, a halting instruction,
+// code outside the image) or a block would overrun the execution limit, the
+// hart falls back to the interpreter for one instruction. Once the program
+// stores into translated code the blocks are abandoned for the interpreter.
+//******************************************************************************
+class aot_hart : public cpu_single_hart
+{
+public:
+    aot_hart(memory &m, const aot_block *b, size_t nb, const aot_word *w, size_t nw);
+
+    void run(uint64_t exec_limit);
+
+    bool store8(uint32_t addr, uint32_t val);
+    bool store16(uint32_t addr, uint32_t val);
+    bool store32(uint32_t addr, uint32_t val);
+
+private:
+    aot_block_fn lookup(uint32_t addr, uint32_t &len) const;
+    bool stored(uint32_t addr, uint32_t len);
+
+    const aot_block *blocks;
+    size_t nblocks;
+    const aot_word *words;
+    size_t nwords;
+
+    uint32_t code_lo = 0;
+    uint32_t code_hi = 0;
+    bool dirty       = false;
+};
@@ -0,0 +1,121 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "async_trace.h"
+
+using namespace std;
+
+//******************************************************************************
+// This constructor starts the background thread.
+//
+// Parameters:
+//   mem_size          - The size of the simulated memory.
+//   show_instructions - Print the instruction trace (-i).
+//   show_registers    - Print the registers before each instruction (-r).
+//   keyframes         - See rv32i_hart::set_register_keyframes() (-k).
+//   next              - Where the records are passed on to, or nullptr.
+//
+// Return value:
+//   None
+//******************************************************************************
+async_trace::async_trace(uint64_t mem_size, bool show_instructions, bool show_registers, uint32_t keyframes,
+                         trace_sink *next)
+    : ring(ring_size),
+      replaying(show_instructions || show_registers),
+      next(next),
+      mem(static_cast<uint32_t>(mem_size - 1)),
+      hart(mem)
+{
+    hart.set_show_instructions(show_instructions);
+    hart.set_show_registers(show_registers);
+    hart.set_register_keyframes(keyframes);
+    hart.start();
+
+    worker = thread(&async_trace::consume, this);
+}
+
+//******************************************************************************
+// destructor stops a trace that was not finished
+//******************************************************************************
+async_trace::~async_trace()
+{
+    if (worker.joinable())
+        finish(false);
+}
+
+//******************************************************************************
+// This function hands one retired instruction to the background thread.
+//
+// Parameters:
+//   r - The instruction.
+//
+// Return value:
+//   None
+//******************************************************************************
+void async_trace::write(const trace_record &r)
+{
+    ring.push(r);
+}
+
+//******************************************************************************
+// This function waits until the background thread has printed every record,
+// after which the caller may write to cout again.
+//
+// Parameters:
+//   h - true if the hart halted (see trace_replay_hart::finish()).
+//
+// Return value:
+//   None
+//******************************************************************************
+void async_trace::finish(bool h)
+{
+    halted = h;
+    done.store(true, memory_order_release);
+    worker.join();
+}
+
+//******************************************************************************
+// This function is the background thread. It takes records until the ring is
+// empty and finish() has been called.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   None
+//******************************************************************************
+void async_trace::consume()
+{
+    trace_record r;
+
+    for (;;)
+    {
+        if (!ring.pop(r))
+        {
+            if (!done.load(memory_order_acquire))
+            {
+                this_thread::yield();
+                continue;
+            }
+
+            // done is set after the last push, so this sees everything left
+            if (!ring.pop(r))
+                break;
+        }
+
+        if (replaying)
+            hart.step(r);
+        if (next)
+            next->write(r);
+    }
+
+    if (replaying)
+        hart.finish(halted);
+}
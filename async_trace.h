@@ -0,0 +1,69 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "memory.h"
+#include "spsc_ring.h"
+#include "trace_record.h"
+#include "trace_replay_hart.h"
+
+using namespace std;
+
+//******************************************************************************
+// This class moves the -i and -r trace off the simulating thread. The hart
+// only pushes a trace_record for each retired instruction into a lock-free
+// ring (blocking only when the ring is full); a background thread replays the
+// records on a trace_replay_hart of its own, which formats and prints the
+// trace exactly as the simulating hart would have, and passes them on to the
+// binary trace, if there is one. While it runs, the background thread is the
+// only one that writes to cout.
+//******************************************************************************
+class async_trace : public trace_sink
+{
+public:
+    async_trace(uint64_t mem_size, bool show_instructions, bool show_registers, uint32_t keyframes,
+                trace_sink *next);
+    ~async_trace();
+
+    void write(const trace_record &r) override;
+    void finish(bool h);
+
+    //******************************************************************************
+    // This function returns the disassembly cache of the replaying hart.
+    //
+    // Parameters:
+    //   None
+    //
+    // Return value:
+    //   A const reference to the cache.
+    //******************************************************************************
+    const render_cache &get_render_cache() const { return hart.get_render_cache(); }
+
+private:
+    static constexpr size_t ring_size = 1 << 16;
+
+    void consume();
+
+    spsc_ring<trace_record> ring;
+    atomic<bool> done{false};
+    bool halted = false;
+
+    bool replaying;
+    trace_sink *next;
+    memory mem;
+    trace_replay_hart hart;
+
+    thread worker;
+};
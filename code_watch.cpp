@@ -0,0 +1,69 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+
+#include "code_watch.h"
+
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+//******************************************************************************
+// This function sets up the watch for a memory of mem_size bytes with no code
+// decoded yet. It registers the process for expedited memory barriers.
+//
+// Parameters:
+//   mem_size - The size of the memory.
+//
+// Return value:
+//   None
+//******************************************************************************
+code_watch::code_watch(uint64_t mem_size)
+{
+    npages = (mem_size + (1u << page_bits) - 1) >> page_bits;
+    pages.reset(new atomic<uint8_t>[npages]());
+    fenced = syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) != 0;
+}
+
+//******************************************************************************
+// This function is called by a hart before it reads an instruction word to
+// decode and keep it. The first time a page is marked every thread is made
+// to pass a memory barrier, so a store to the word that is not yet visible
+// to this hart is sure to see the mark. A hart that finds the page being
+// marked by another waits until the barrier is done.
+//
+// Parameters:
+//   addr - The address of the word.
+//
+// Return value:
+//   None
+//******************************************************************************
+void code_watch::add_code(uint32_t addr)
+{
+    atomic<uint8_t> &p = pages[addr >> page_bits];
+    uint8_t s = p.load(memory_order_acquire);
+    if (s == page_code)
+        return;
+
+    if (s == page_clean && p.compare_exchange_strong(s, page_marking))
+    {
+        if (fenced)
+            atomic_thread_fence(memory_order_seq_cst);
+        else
+            syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+        p.store(page_code, memory_order_release);
+        return;
+    }
+
+    while (p.load(memory_order_acquire) != page_code)
+        ;
+}
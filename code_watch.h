@@ -0,0 +1,103 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+using namespace std;
+
+//******************************************************************************
+// The pages of a shared memory that hold code some hart has decoded, and a
+// generation number that any hart's store to such a page advances. Each hart
+// decodes into caches of its own (its instruction cache, blocks and compiled
+// blocks), and it only invalidates them itself for its own stores. The harts
+// of a cpu_multi_hart share a code_watch: a hart that sees a new generation
+// when it enters a block drops all of its decodings, so code that one hart
+// writes is run by all of them.
+//
+// A store and the first decoding of a page can race: the storing hart checks
+// the page after its store, and the decoding hart reads the word after it
+// marks the page. To make sure that one of them sees the other, the decoding
+// hart issues a process-wide memory barrier (membarrier) after it marks a new
+// page, which happens once per page. Where membarrier is not available every
+// store is fenced instead.
+//******************************************************************************
+class code_watch
+{
+public:
+    explicit code_watch(uint64_t mem_size);
+
+    void add_code(uint32_t addr);
+
+    //******************************************************************************
+    // This function returns the current generation.
+    //
+    // Parameters:
+    //   None
+    //
+    // Return value:
+    //   The number of stores to pages with code so far.
+    //******************************************************************************
+    uint64_t get_generation() const { return generation.load(memory_order_acquire); }
+
+    //******************************************************************************
+    // This function is called after every store of a hart. It advances the
+    // generation if the store touched a page with code.
+    //
+    // Parameters:
+    //   addr - The address of the first byte that was written.
+    //   len  - The number of bytes that were written.
+    //   seen - The generation the hart's decodings are up to date with. It
+    //          follows the hart's own advance, which it has already handled.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void wrote(uint32_t addr, uint32_t len, uint64_t &seen)
+    {
+        if (fenced)
+            atomic_thread_fence(memory_order_seq_cst);
+        else
+            atomic_signal_fence(memory_order_seq_cst);
+
+        uint64_t first = addr >> page_bits;
+        uint64_t last = (static_cast<uint64_t>(addr) + len - 1) >> page_bits;
+        for (uint64_t p = first; p <= last && p < npages; ++p)
+        {
+            if (pages[p].load(memory_order_relaxed) != page_clean)
+            {
+                uint64_t g = generation.fetch_add(1, memory_order_acq_rel);
+                if (seen == g)
+                    seen = g + 1;
+                return;
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t page_bits = 12;
+
+    enum page_state : uint8_t
+    {
+        page_clean,                         // no decoded code
+        page_marking,                       // being marked by add_code()
+        page_code                           // holds decoded code
+    };
+
+    unique_ptr<atomic<uint8_t>[]> pages;    // page_state of each page
+    uint64_t npages;
+    bool fenced;                            // no membarrier: fence every store
+
+    alignas(64) atomic<uint64_t> generation{0};
+};
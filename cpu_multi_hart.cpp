@@ -0,0 +1,333 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "cpu_multi_hart.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+//******************************************************************************
+// This constructor creates the harts, numbered 0 to nharts-1 by mhartid.
+//
+// Parameters:
+//   mem    - The memory the harts share.
+//   nharts - The number of harts.
+//
+// Return value:
+//   None
+//******************************************************************************
+cpu_multi_hart::cpu_multi_hart(memory &mem, uint32_t nharts) : watch(mem.get_size())
+{
+    for (uint32_t i = 0; i < nharts; ++i)
+    {
+        harts.emplace_back(new cpu_single_hart(mem));
+        harts.back()->set_mhartid(i);
+        harts.back()->set_code_watch(&watch);
+    }
+}
+
+//******************************************************************************
+// This function resets every hart.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   None
+//******************************************************************************
+void cpu_multi_hart::reset()
+{
+    for (unique_ptr<cpu_single_hart> &h : harts)
+        h->reset();
+}
+
+//******************************************************************************
+// This function sets the address every hart starts at.
+//
+// Parameters:
+//   addr - The start address.
+//
+// Return value:
+//   None
+//******************************************************************************
+void cpu_multi_hart::set_pc(uint32_t addr)
+{
+    for (unique_ptr<cpu_single_hart> &h : harts)
+        h->set_pc(addr);
+}
+
+//******************************************************************************
+// This function runs the harts until every one of them has halted or executed
+// exec_limit instructions, then prints the halt reason and instruction count
+// of each hart and the totals. The paged memory backend keeps a last-page
+// cache that is not safe to share, so with it the harts all run on one thread.
+//
+// Parameters:
+//   exec_limit - The maximum number of instructions each hart executes (0 =
+//                no limit).
+//
+// Return value:
+//   None
+//******************************************************************************
+void cpu_multi_hart::run(uint64_t exec_limit)
+{
+    uint64_t limit = exec_limit ? exec_limit : UINT64_MAX;
+
+    uint32_t n = threads ? threads : thread::hardware_concurrency();
+#if !MEMORY_GUARD_PAGES
+    n = 1;
+#endif
+    if (quantum)
+        n = 1;      // the rounds are only reproducible on one thread
+    n = max<uint32_t>(1, min<uint32_t>(n, harts.size()));
+
+    for (unique_ptr<cpu_single_hart> &h : harts)
+        h->init_stack();
+
+    uint64_t start_count = get_insn_counter();
+    auto start_time = chrono::steady_clock::now();
+
+    if (quantum)
+        run_quanta(limit);
+    else
+        run_stealing(n, limit);
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start_time;
+
+    for (size_t i = 0; i < harts.size(); ++i)
+    {
+        const cpu_single_hart &h = *harts[i];
+        if (h.is_halted())
+            cout << "Hart " << i << ": Execution terminated. Reason: " << h.get_halt_reason() << "\n";
+        cout << "Hart " << i << ": " << h.get_insn_counter() << " instructions executed\n";
+    }
+    cout << get_halted_count() << " of " << harts.size() << " harts halted" << "\n";
+    cout << get_insn_counter() << " instructions executed" << endl;
+
+    if (show_speed)
+    {
+        double secs = elapsed.count();
+        double mips = secs > 0 ? (get_insn_counter() - start_count) / secs / 1e6 : 0;
+        ios::fmtflags flags = cout.flags();
+        streamsize prec = cout.precision();
+        cout << fixed << setprecision(2) << mips << " MIPS (" << secs << " seconds, " << n << " threads, ";
+        if (quantum)
+            cout << rounds << " rounds of " << quantum << " instructions)" << endl;
+        else
+            cout << turns << " slices, " << steals << " steals)" << endl;
+        cout.flags(flags);
+        cout.precision(prec);
+    }
+}
+
+//******************************************************************************
+// This function runs the harts on n threads, each with a run queue of its own
+// that the harts are dealt out to round robin.
+//
+// Parameters:
+//   n     - The number of threads.
+//   limit - The instruction count each hart stops at.
+//
+// Return value:
+//   None
+//******************************************************************************
+void cpu_multi_hart::run_stealing(uint32_t n, uint64_t limit)
+{
+    queues.reset(new run_queue[n]);
+    nqueues = n;
+    unfinished = 0;
+    steals = 0;
+    turns = 0;
+
+    for (size_t i = 0; i < harts.size(); ++i)
+    {
+        cpu_single_hart &h = *harts[i];
+        if (!h.is_halted() && h.get_insn_counter() < limit)
+        {
+            queues[i % n].harts.push_back(&h);
+            ++unfinished;
+        }
+    }
+
+    vector<thread> pool;
+    for (uint32_t i = 1; i < n; ++i)
+        pool.emplace_back(&cpu_multi_hart::work, this, i, limit);
+    work(0, limit);
+    for (thread &t : pool)
+        t.join();
+
+    queues.reset();
+    nqueues = 0;
+}
+
+//******************************************************************************
+// This function runs the harts in rounds of quantum instructions. In each
+// round the unfinished harts take their turns in order of mhartid, all on the
+// calling thread, so that their loads and stores (and their stores to code)
+// happen in the same order every time.
+//
+// Parameters:
+//   limit - The instruction count each hart stops at.
+//
+// Return value:
+//   None
+//******************************************************************************
+void cpu_multi_hart::run_quanta(uint64_t limit)
+{
+    vector<cpu_single_hart *> live;
+    for (unique_ptr<cpu_single_hart> &h : harts)
+        if (!h->is_halted() && h->get_insn_counter() < limit)
+            live.push_back(h.get());
+
+    for (rounds = 0; !live.empty(); ++rounds)
+    {
+        for (cpu_single_hart *h : live)
+        {
+            uint64_t count = h->get_insn_counter();
+            h->run_slice(limit - count > quantum ? count + quantum : limit);
+        }
+
+        live.erase(remove_if(live.begin(), live.end(), [&](cpu_single_hart *h)
+            { return h->is_halted() || h->get_insn_counter() >= limit; }), live.end());
+    }
+}
+
+//******************************************************************************
+// This function is the loop of one host thread. It runs a slice of the hart it
+// takes, then queues the hart again at the end of its own queue, until every
+// hart is finished. A thread that finds no hart to take while others are still
+// running theirs yields and tries again.
+//
+// Parameters:
+//   self  - The index of the thread and of its run queue.
+//   limit - The instruction count each hart stops at.
+//
+// Return value:
+//   None
+//******************************************************************************
+void cpu_multi_hart::work(uint32_t self, uint64_t limit)
+{
+    while (unfinished.load(memory_order_acquire))
+    {
+        cpu_single_hart *h = take(self);
+        if (!h)
+        {
+            this_thread::yield();
+            continue;
+        }
+
+        uint64_t n = h->get_insn_counter();
+        h->run_slice(limit - n > slice ? n + slice : limit);
+        turns.fetch_add(1, memory_order_relaxed);
+
+        if (h->is_halted() || h->get_insn_counter() >= limit)
+        {
+            unfinished.fetch_sub(1, memory_order_release);
+            continue;
+        }
+
+        lock_guard<mutex> lock(queues[self].lock);
+        queues[self].harts.push_back(h);
+    }
+}
+
+//******************************************************************************
+// This function takes the next hart for a thread to run: the one at the front
+// of its own queue or, failing that, the one at the end of the first other
+// queue (searching from the next thread on) that has any.
+//
+// Parameters:
+//   self - The index of the thread.
+//
+// Return value:
+//   The hart, or nullptr if every queue is empty.
+//******************************************************************************
+cpu_single_hart *cpu_multi_hart::take(uint32_t self)
+{
+    {
+        lock_guard<mutex> lock(queues[self].lock);
+        if (!queues[self].harts.empty())
+        {
+            cpu_single_hart *h = queues[self].harts.front();
+            queues[self].harts.pop_front();
+            return h;
+        }
+    }
+
+    for (uint32_t i = 1; i < nqueues; ++i)
+    {
+        run_queue &q = queues[(self + i) % nqueues];
+        lock_guard<mutex> lock(q.lock);
+        if (!q.harts.empty())
+        {
+            cpu_single_hart *h = q.harts.back();
+            q.harts.pop_back();
+            steals.fetch_add(1, memory_order_relaxed);
+            return h;
+        }
+    }
+    return nullptr;
+}
+
+//******************************************************************************
+// This function prints the registers and pc of every hart, each line headed by
+// the hart's number.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   None
+//******************************************************************************
+void cpu_multi_hart::dump() const
+{
+    for (size_t i = 0; i < harts.size(); ++i)
+        harts[i]->dump("hart " + to_string(i) + " ");
+}
+
+//******************************************************************************
+// This function returns the total number of instructions the harts executed.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   The sum of the harts' instruction counters.
+//******************************************************************************
+uint64_t cpu_multi_hart::get_insn_counter() const
+{
+    uint64_t n = 0;
+    for (const unique_ptr<cpu_single_hart> &h : harts)
+        n += h->get_insn_counter();
+    return n;
+}
+
+//******************************************************************************
+// This function returns the number of harts that have halted.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   The number of halted harts.
+//******************************************************************************
+uint32_t cpu_multi_hart::get_halted_count() const
+{
+    uint32_t n = 0;
+    for (const unique_ptr<cpu_single_hart> &h : harts)
+        n += h->is_halted();
+    return n;
+}
@@ -0,0 +1,147 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "code_watch.h"
+#include "cpu_single_hart.h"
+#include "memory.h"
+
+using namespace std;
+
+//******************************************************************************
+// This class represents a CPU with many harts sharing one memory. Every hart
+// starts at the same pc with its own registers; mhartid tells them apart. The
+// harts are run by a pool of host threads, a slice of instructions at a time:
+// each thread has a run queue of its own and runs the hart at its front, puts
+// the hart back at the end unless it is finished, and steals a hart from the
+// end of another thread's queue when its own is empty. A hart is finished
+// when it halts or has executed the per-hart instruction limit.
+//
+// With a quantum set, the harts are run in rounds instead, on one thread
+// whatever set_threads() asks for: in each round every unfinished hart, in
+// order of mhartid, executes exactly quantum instructions (fewer if it halts
+// or reaches the limit). The harts' accesses to the shared memory then happen
+// in the same order every time, so a run is reproducible bit for bit.
+//
+// Tracing is not available. Each hart decodes instructions into caches of its
+// own, which share a code_watch: a store by any hart to code that has been
+// decoded makes every other hart drop its decodings by the next block it
+// enters, so code one hart writes is run by all of them.
+//******************************************************************************
+class cpu_multi_hart
+{
+public:
+    cpu_multi_hart(memory &mem, uint32_t nharts);
+
+    void reset();
+    void set_pc(uint32_t addr);
+    void run(uint64_t exec_limit);
+    void dump() const;
+
+    //******************************************************************************
+    // This function selects the execution engine every hart runs with.
+    //
+    // Parameters:
+    //   e - The engine to use.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_engine(cpu_single_hart::engine_type e)
+    {
+        for (unique_ptr<cpu_single_hart> &h : harts)
+            h->set_engine(e);
+    }
+
+    //******************************************************************************
+    // This function sets the number of host threads run() uses (0 = one per
+    // hardware thread). No more threads than harts are started, and only one
+    // with a quantum.
+    //
+    // Parameters:
+    //   n - The number of threads.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_threads(uint32_t n)       { threads = n; }
+
+    //******************************************************************************
+    // This function sets the number of instructions each hart executes per
+    // round (0 = no rounds: the harts run as fast as the threads can take them).
+    // A smaller quantum interleaves the harts more finely at the cost of more
+    // switches between them.
+    //
+    // Parameters:
+    //   q - The quantum.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_quantum(uint64_t q)       { quantum = q; }
+
+    //******************************************************************************
+    // This function enables or disables reporting of the simulation speed and
+    // of the scheduler's counts at the end of run().
+    //
+    // Parameters:
+    //   b - true to report them.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_show_speed(bool b)        { show_speed = b; }
+
+    //******************************************************************************
+    // These functions return the aggregate state of the harts: the total number
+    // of instructions they executed and how many of them have halted.
+    //******************************************************************************
+    uint64_t get_insn_counter() const;
+    uint32_t get_halted_count() const;
+
+private:
+    static constexpr uint64_t slice = 1 << 16;      // instructions per turn
+
+    //******************************************************************************
+    // The run queue of one host thread.
+    //******************************************************************************
+    struct alignas(64) run_queue
+    {
+        mutex lock;
+        deque<cpu_single_hart *> harts;
+    };
+
+    void run_stealing(uint32_t n, uint64_t limit);
+    void run_quanta(uint64_t limit);
+    void work(uint32_t self, uint64_t limit);
+    cpu_single_hart *take(uint32_t self);
+
+    code_watch watch;                               // shared by the harts
+    vector<unique_ptr<cpu_single_hart>> harts;
+
+    uint32_t threads = 0;
+    uint64_t quantum = 0;
+    bool show_speed = false;
+
+    unique_ptr<run_queue[]> queues;
+    uint32_t nqueues = 0;
+    atomic<uint32_t> unfinished{0};
+    atomic<uint64_t> steals{0};
+    atomic<uint64_t> turns{0};
+    uint64_t rounds = 0;
+};
@@ -9,36 +9,181 @@
 //******************************************************************************
 
 #include "cpu_single_hart.h"
+#include "async_trace.h"
 #include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
 
 using std::cout;
 using std::endl;
 
 //******************************************************************************
-// This function runs the CPU simulation for a single hart. It repeatedly calls
-// tick() to execute instructions until halt or limit reached
+// This function runs the CPU simulation for a single hart. It executes
+// instructions with run_ticks(), whose loop is specialized once for the tracing
+// flags, until halt or limit reached. When tracing
+// (text or binary) is off the selected engine may instead run the hart a whole basic block at a
+// time (run_block(), optionally compiling hot blocks to native code) or
+// entirely inside the threaded engine (run_threaded()). With set_async_trace()
+// the hart only records each instruction and an async_trace prints the trace.
+// A trace window (set_trace_window(), add_trace_range()) takes precedence over
+// set_async_trace(), see run_windowed().
 // Parameters:
 //   exec_limit — maximum number of instructions to execute
 // Return value: None
 //******************************************************************************
 void cpu_single_hart::run(uint64_t exec_limit)
 {
-    regs.set(2, static_cast<int32_t>(mem.get_size()));
+    init_stack();
 
-    if (exec_limit == 0)
+    uint64_t start_count = get_insn_counter();
+    auto start_time = std::chrono::steady_clock::now();
+
+    bool tracing = show_instructions || show_registers || record_sink;
+
+    if (engine != engine_switch && !tracing)
+    {
+        run_slice(exec_limit ? exec_limit : UINT64_MAX);
+    }
+    else if ((show_instructions || show_registers) &&
+             (window_first || window_last != UINT64_MAX || !trace_ranges.empty()))
+    {
+        run_windowed(exec_limit);
+    }
+    else if (async && tracing)
     {
-        while (!is_halted())
-            tick("");         
+        bool show_insns = show_instructions;
+        bool show_regs = show_registers;
+        trace_sink *sink = record_sink;
+
+        async_trace background(mem.get_size(), show_insns, show_regs, keyframe_interval, sink);
+        set_show_instructions(false);
+        set_show_registers(false);
+        set_trace_sink(&background);
+        mem.set_warnings(!show_insns && !show_regs);    // the replay prints them
+
+        run_ticks(exec_limit);
+
+        background.finish(is_halted());
+        insn_text.add_counts(background.get_render_cache());
+        mem.set_warnings(true);
+        set_trace_sink(sink);
+        set_show_registers(show_regs);
+        set_show_instructions(show_insns);
     }
     else
     {
-        while (!is_halted() && get_insn_counter() < exec_limit)
-            tick("");
+        run_ticks(exec_limit);
     }
 
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+
     if (is_halted())
         cout << "Execution terminated. Reason: "
                   << get_halt_reason() << "\n";
                   
     cout << get_insn_counter() << " instructions executed" << endl;
+
+    if (show_speed)
+    {
+        double secs = elapsed.count();
+        double mips = secs > 0 ? (get_insn_counter() - start_count) / secs / 1e6 : 0;
+        std::ios::fmtflags flags = cout.flags();
+        std::streamsize prec = cout.precision();
+        cout << std::fixed << std::setprecision(2) << mips << " MIPS ("
+             << secs << " seconds)" << endl;
+        cout.flags(flags);
+        cout.precision(prec);
+
+        insn_text.print_stats(cout);
+    }
+}
+
+//******************************************************************************
+// This function runs the hart untraced with the selected engine until it halts
+// or its instruction counter reaches limit. cpu_multi_hart runs its harts a
+// slice at a time through it.
+// Parameters:
+//   limit — the instruction count to stop at
+// Return value: None
+//******************************************************************************
+void cpu_single_hart::run_slice(uint64_t limit)
+{
+    if (engine == engine_threaded)
+    {
+        run_threaded(limit);
+    }
+    else if (engine == engine_block || engine == engine_jit)
+    {
+        set_jit(engine == engine_jit);
+        while (!is_halted() && get_insn_counter() < limit)
+            run_block(limit);
+    }
+    else
+    {
+        run_ticks(limit);
+    }
+}
+
+//******************************************************************************
+// This function runs the hart with the -i and -r traces limited to the trace
+// window: the instruction count window and, inside it, the pc ranges. Only
+// the instructions in the window go through tick() with tracing enabled. The
+// rest run in run_block() (compiled when the jit engine is selected), which
+// has no trace checks at all; while the count window is open it is stopped at
+// the pc ranges through rv32i_hart::set_stop_ranges(). A binary trace needs
+// every instruction, so with one the rest go through tick() instead, still
+// without the text traces.
+// Parameters:
+//   exec_limit — maximum number of instructions to execute (0 = no limit)
+// Return value: None
+//******************************************************************************
+void cpu_single_hart::run_windowed(uint64_t exec_limit)
+{
+    uint64_t limit = exec_limit ? exec_limit : UINT64_MAX;
+    bool show_insns = show_instructions;
+    bool show_regs = show_registers;
+    bool stopping = false;
+
+    set_show_instructions(false);
+    set_show_registers(false);
+    set_jit(engine == engine_jit);
+
+    while (!is_halted() && get_insn_counter() < limit)
+    {
+        uint64_t n = get_insn_counter();
+        bool counting = n >= window_first && n < window_last;
+
+        if (counting != stopping && !trace_ranges.empty())
+        {
+            set_stop_ranges(counting ? trace_ranges : vector<pair<uint32_t, uint32_t>>());
+            stopping = counting;
+        }
+
+        if (counting && (trace_ranges.empty() || in_stop_range(pc)))
+        {
+            uint64_t end = std::min(limit, window_last);
+
+            set_show_instructions(show_insns);
+            set_show_registers(show_regs);
+            do
+                tick("");
+            while (!is_halted() && get_insn_counter() < end && (trace_ranges.empty() || in_stop_range(pc)));
+            set_show_instructions(false);
+            set_show_registers(false);
+            continue;
+        }
+
+        uint64_t end = n < window_first ? window_first : (n < window_last ? window_last : UINT64_MAX);
+
+        if (record_sink)
+            tick("");
+        else
+            run_block(std::min(limit, end));
+    }
+
+    if (stopping)
+        set_stop_ranges(vector<pair<uint32_t, uint32_t>>());
+    set_show_registers(show_regs);
+    set_show_instructions(show_insns);
 }
@@ -20,7 +20,111 @@
 class cpu_single_hart : public rv32i_hart
 {
 public:
+    //******************************************************************************
+    // The execution engines that run() can use to drive the hart.
+    //   engine_switch   - call tick() once per instruction (supports tracing)
+    //   engine_threaded - run_threaded(), direct-threaded dispatch without tracing
+    //   engine_block    - run_block(), chained basic blocks without tracing
+    //   engine_jit      - run_block() with hot blocks compiled to native code
+    //******************************************************************************
+    enum engine_type
+    {
+        engine_switch,
+        engine_threaded,
+        engine_block,
+        engine_jit
+    };
+
     cpu_single_hart(memory &mem) : rv32i_hart(mem) {}
 
     void run(uint64_t exec_limit);
+    void run_slice(uint64_t limit);
+
+    //******************************************************************************
+    // This function sets the stack pointer (x2) to the size of the memory, as
+    // run() does before it starts the hart.
+    //
+    // Parameters:
+    //   None
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void init_stack()                  { regs.set(2, static_cast<int32_t>(mem.get_size())); }
+
+    //******************************************************************************
+    // This function selects the execution engine used by run(). Tracing is only
+    // available with engine_switch, so run() falls back to it whenever
+    // instruction or register tracing is enabled.
+    //
+    // Parameters:
+    //   e - The engine to use.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_engine(engine_type e)     { engine = e; }
+
+    //******************************************************************************
+    // This function enables or disables reporting of the simulation speed (in
+    // millions of instructions per second) and, after an -i trace, of the
+    // disassembly cache counts at the end of run().
+    //
+    // Parameters:
+    //   b - true to report the speed, false to suppress it.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_show_speed(bool b)        { show_speed = b; }
+
+    //******************************************************************************
+    // This function makes run() format and write the trace on a background
+    // thread (see async_trace) instead of in tick().
+    //
+    // Parameters:
+    //   b - true to trace in the background.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_async_trace(bool b)       { async = b; }
+
+    //******************************************************************************
+    // This function limits the -i and -r traces to the instructions executed
+    // while the instruction counter is at least first and below last. Outside
+    // the window the hart runs without any tracing (see run_windowed()).
+    //
+    // Parameters:
+    //   first - The number of instructions to execute before tracing starts.
+    //   last  - The instruction count at which tracing stops.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_trace_window(uint64_t first, uint64_t last) { window_first = first; window_last = last; }
+
+    //******************************************************************************
+    // This function limits the -i and -r traces to instructions whose address
+    // is in one of the ranges added. With no ranges every address is traced.
+    //
+    // Parameters:
+    //   lo - The first address of the range.
+    //   hi - The address after the last one.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void add_trace_range(uint32_t lo, uint32_t hi) { trace_ranges.push_back({ lo, hi }); }
+
+protected:
+    void run_windowed(uint64_t exec_limit);
+
+    engine_type engine = engine_switch;
+    bool show_speed    = false;
+    bool async         = false;
+
+    uint64_t window_first = 0;
+    uint64_t window_last  = UINT64_MAX;
+    vector<pair<uint32_t, uint32_t>> trace_ranges;
 };
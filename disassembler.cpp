@@ -0,0 +1,273 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "disassembler.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "hex.h"
+
+using namespace std;
+
+//******************************************************************************
+// Takes the address of four bytes as its parameter and returns them combined in
+// little-endian order.
+//******************************************************************************
+static uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+//******************************************************************************
+// This function writes the listing of the whole memory. Small memories (a
+// single chunk) are listed on the calling thread.
+//
+// Parameters:
+//   os - The stream to write the listing to.
+//
+// Return value:
+//   None
+//******************************************************************************
+void disassembler::write(ostream &os)
+{
+    uint64_t size = mem.get_size();
+    uint64_t nchunks = (size + chunk_size - 1) / chunk_size;
+
+    uint64_t nthreads = thread::hardware_concurrency();
+    if (nthreads > nchunks)
+        nthreads = nchunks;
+
+    if (nthreads <= 1)
+    {
+        string text;
+        render_cache cache;
+        for (uint64_t c = 0; c < nchunks; ++c)
+        {
+            format_chunk(c * chunk_size, min(size, (c + 1) * chunk_size), text, cache);
+            os.write(text.data(), text.size());
+        }
+        counts.add_counts(cache);
+        return;
+    }
+
+    // chunk c is formatted into texts[c % slots]; a worker only takes a chunk
+    // once the one that last used its slot has been written
+    uint64_t slots = 2 * nthreads;
+    vector<string> texts(slots);
+    vector<bool> ready(slots, false);
+    uint64_t next = 0;          // next chunk to format
+    uint64_t written = 0;       // chunks written so far
+
+    mutex m;
+    condition_variable cv;
+
+    auto work = [&]()
+    {
+        string text;
+        render_cache cache;
+        for (;;)
+        {
+            uint64_t c;
+            {
+                unique_lock<mutex> lock(m);
+                cv.wait(lock, [&]() { return next == nchunks || next < written + slots; });
+                if (next == nchunks)
+                {
+                    counts.add_counts(cache);
+                    return;
+                }
+                c = next++;
+            }
+
+            format_chunk(c * chunk_size, min(size, (c + 1) * chunk_size), text, cache);
+
+            {
+                lock_guard<mutex> lock(m);
+                texts[c % slots].swap(text);
+                ready[c % slots] = true;
+            }
+            cv.notify_all();
+        }
+    };
+
+    vector<thread> workers;
+    for (uint64_t i = 0; i < nthreads; ++i)
+        workers.emplace_back(work);
+
+    string text;
+    for (uint64_t c = 0; c < nchunks; ++c)
+    {
+        {
+            unique_lock<mutex> lock(m);
+            cv.wait(lock, [&]() { return ready[c % slots]; });
+            text.swap(texts[c % slots]);
+            ready[c % slots] = false;
+            written = c + 1;
+        }
+        cv.notify_all();
+        os.write(text.data(), text.size());
+    }
+
+    for (thread &t : workers)
+        t.join();
+}
+
+//******************************************************************************
+// This function disassembles one chunk of the memory. A run of identical words
+// that starts in the chunk is listed by it, even where the run goes on into
+// the chunks after it; those chunks skip what is left of the run.
+//
+// Parameters:
+//   lo    - The address of the first word of the chunk.
+//   hi    - The address after the last word of the chunk.
+//   out   - Replaced by the text of the chunk.
+//   cache - The calling thread's disassembly cache.
+//
+// Return value:
+//   None
+//******************************************************************************
+void disassembler::format_chunk(uint64_t lo, uint64_t hi, string &out, render_cache &cache) const
+{
+    vector<uint8_t> bytes(hi - lo);
+    mem.read(lo, bytes.data(), hi - lo);
+    auto word = [&](uint64_t addr) { return le32(&bytes[addr - lo]); };
+
+    // every word takes at most one line: a summary line replaces a run's words
+    out.resize((hi - lo) / 4 * line_size);
+    char *begin = &out[0];
+    char *p = begin;
+
+    uint64_t addr = lo;
+    if (collapse_fill && addr > 0 && addr < hi)
+    {
+        uint32_t w = word(addr);
+        if (word_at(addr - 4) == w && in_long_run(addr, w))
+            while (addr < hi && word(addr) == w)
+                addr += 4;
+    }
+
+    while (addr < hi)
+    {
+        uint32_t insn = word(addr);
+
+        p = hex::to_hex32(p, addr);
+        *p++ = ':';
+        *p++ = ' ';
+        p = hex::to_hex32(p, insn);
+        *p++ = ' ';
+        *p++ = ' ';
+        p = cache.render(p, addr, insn);
+        *p++ = '\n';
+
+        uint64_t end = addr + 4;
+        if (collapse_fill)
+        {
+            while (end < hi && word(end) == insn)
+                end += 4;
+            if (end == hi)
+                end = run_end(hi, insn);
+
+            if (end - addr >= fill_run * 4)
+            {
+                static const char summary[] = " repeated through ";
+                *p++ = '*';
+                for (int i = 0; i < 9; ++i)
+                    *p++ = ' ';
+                p = hex::to_hex32(p, insn);
+                for (const char *s = summary; *s; ++s)
+                    *p++ = *s;
+                p = hex::to_hex32(p, end - 4);
+                *p++ = '\n';
+            }
+            else
+            {
+                end = addr + 4;
+            }
+        }
+        addr = end;
+    }
+
+    out.resize(p - begin);
+}
+
+//******************************************************************************
+// This function reads one word of the memory.
+//
+// Parameters:
+//   addr - The address of the word.
+//
+// Return value:
+//   The word.
+//******************************************************************************
+uint32_t disassembler::word_at(uint64_t addr) const
+{
+    uint8_t b[4];
+    mem.read(addr, b, sizeof(b));
+    return le32(b);
+}
+
+//******************************************************************************
+// This function finds the end of a run of identical words.
+//
+// Parameters:
+//   addr - The address to start looking at.
+//   w    - The word the run is made of.
+//
+// Return value:
+//   The address of the first word at or after addr that is not w, or the size
+//   of the memory.
+//******************************************************************************
+uint64_t disassembler::run_end(uint64_t addr, uint32_t w) const
+{
+    uint64_t size = mem.get_size();
+    uint8_t buf[4096];
+
+    while (addr < size)
+    {
+        uint64_t n = min<uint64_t>(sizeof(buf), size - addr);
+        mem.read(addr, buf, n);
+        for (uint64_t i = 0; i < n; i += 4)
+            if (le32(buf + i) != w)
+                return addr + i;
+        addr += n;
+    }
+    return size;
+}
+
+//******************************************************************************
+// This function tells whether a word is part of a run long enough to collapse,
+// looking at no more than fill_run words on either side of it.
+//
+// Parameters:
+//   addr - The address of the word.
+//   w    - The word at addr.
+//
+// Return value:
+//   true if at least fill_run words equal to w surround addr without a break.
+//******************************************************************************
+bool disassembler::in_long_run(uint64_t addr, uint32_t w) const
+{
+    const uint64_t span = fill_run * 4;
+    uint64_t size = mem.get_size();
+
+    uint64_t start = addr;
+    while (start > 0 && addr - start < span && word_at(start - 4) == w)
+        start -= 4;
+
+    uint64_t end = addr + 4;
+    while (end < size && end - start < span && word_at(end) == w)
+        end += 4;
+
+    return end - start >= span;
+}
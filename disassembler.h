@@ -0,0 +1,79 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "memory.h"
+#include "render_cache.h"
+#include "rv32i_decode.h"
+
+using namespace std;
+
+//******************************************************************************
+// This class writes the -d listing of the whole memory. The memory is split
+// into chunks that worker threads disassemble into buffers of their own, and
+// the buffers are written in address order, each with a single write. Each
+// thread renders through a render_cache of its own. Only a
+// few chunks may be finished ahead of the one being written, so the text of a
+// large image is never held all at once.
+//
+// With set_collapse_fill() a run of fill_run or more identical words (such as
+// the 0xa5a5a5a5 of memory that was never written) is listed as its first word
+// and one summary line.
+//******************************************************************************
+class disassembler
+{
+public:
+    disassembler(const memory &mem) : mem(mem) {}
+
+    //******************************************************************************
+    // This function enables or disables listing runs of identical words as one
+    // summary line.
+    //
+    // Parameters:
+    //   b - true to collapse the runs.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_collapse_fill(bool b) { collapse_fill = b; }
+
+    void write(ostream &os);
+
+    //******************************************************************************
+    // This function returns the combined counts of the disassembly caches the
+    // listing was rendered through.
+    //
+    // Parameters:
+    //   None
+    //
+    // Return value:
+    //   A const reference to the counts.
+    //******************************************************************************
+    const render_cache &get_render_cache() const { return counts; }
+
+private:
+    static constexpr uint64_t chunk_size = 1 << 18;     // bytes of memory per chunk
+    static constexpr uint64_t fill_run = 8;             // shortest run that is collapsed
+    static constexpr size_t line_size = 32 + rv32i_decode::render_size;
+
+    void format_chunk(uint64_t lo, uint64_t hi, string &out, render_cache &cache) const;
+    uint32_t word_at(uint64_t addr) const;
+    uint64_t run_end(uint64_t addr, uint32_t w) const;
+    bool in_long_run(uint64_t addr, uint32_t w) const;
+
+    const memory &mem;
+    bool collapse_fill = false;
+    render_cache counts;                                // of every thread's cache
+};
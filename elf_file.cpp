@@ -0,0 +1,295 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "elf_file.h"
+#include "hex.h"
+#include <iostream>
+
+using namespace std;
+
+//******************************************************************************
+// This function reports whether the file named fname starts with the ELF magic
+// number. It is used to tell ELF executables from flat binary images.
+//
+// Parameters:
+//   fname - The name of the file to check.
+//
+// Return value:
+//   true if the file is an ELF file, false if not (or if it can't be read).
+//******************************************************************************
+bool elf_file::is_elf(const string &fname)
+{
+    ifstream in(fname, ios::in | ios::binary);
+    char magic[4];
+    if (!in.read(magic, sizeof(magic)))
+        return false;
+
+    return magic[0] == 0x7f && magic[1] == 'E' && magic[2] == 'L' && magic[3] == 'F';
+}
+
+//******************************************************************************
+// This function loads the ELF executable named fname into mem. Each PT_LOAD
+// segment is copied to its virtual address and the rest of its memory size
+// (the BSS) is set to zero without reading anything more from the file. The
+// entry point and the symbol table are remembered.
+//
+// Parameters:
+//   fname - The name of the ELF file.
+//   mem   - The memory to load it into.
+//
+// Return value:
+//   true if the executable was loaded, false (after printing why) if not.
+//******************************************************************************
+bool elf_file::load(const string &fname, memory &mem)
+{
+    ifstream in(fname, ios::in | ios::binary);
+    if (!in)
+    {
+        cerr << "Can't open file '" << fname << "' for reading." << endl;
+        entry = 0;
+        symbols.clear();
+        return false;
+    }
+
+    return load(in, fname, mem);
+}
+
+//******************************************************************************
+// This function loads the ELF executable that in reads from into mem, as
+// load(fname, mem) does. It lets an executable that is already in memory (see
+// program_image) be loaded without a file.
+//
+// Parameters:
+//   in   - The stream to read the executable from. It must be seekable.
+//   name - The name of the executable, for the messages.
+//   mem  - The memory to load it into.
+//
+// Return value:
+//   true if the executable was loaded, false (after printing why) if not.
+//******************************************************************************
+bool elf_file::load(istream &in, const string &name, memory &mem)
+{
+    fname = name;
+    entry = 0;
+    symbols.clear();
+
+    in.seekg(0, ios::end);
+    file_size = static_cast<uint64_t>(in.tellg());
+
+    vector<uint8_t> ehdr;
+    if (!read_at(in, 0, ehdr_size, ehdr))
+        return fail("truncated ELF header");
+
+    if (ehdr[0] != 0x7f || ehdr[1] != 'E' || ehdr[2] != 'L' || ehdr[3] != 'F')
+        return fail("not an ELF file");
+    if (ehdr[4] != 1)
+        return fail("not a 32-bit ELF file");
+    if (ehdr[5] != 1)
+        return fail("not a little-endian ELF file");
+    if (get16(ehdr, 16) != et_exec)
+        return fail("not an executable");
+    if (get16(ehdr, 18) != em_riscv)
+        return fail("not a RISC-V executable");
+
+    entry = get32(ehdr, 24);
+
+    uint32_t phoff = get32(ehdr, 28);
+    uint16_t phentsize = get16(ehdr, 42);
+    uint16_t phnum = get16(ehdr, 44);
+
+    if (phnum && phentsize != phdr_size)
+        return fail("unexpected program header size");
+
+    vector<uint8_t> ph;
+    if (!read_at(in, phoff, static_cast<uint64_t>(phnum) * phdr_size, ph))
+        return fail("truncated program headers");
+
+    vector<uint8_t> buf;
+    for (uint32_t i = 0; i < phnum; ++i)
+    {
+        size_t p = i * phdr_size;
+        if (get32(ph, p) != pt_load)
+            continue;
+
+        uint32_t offset = get32(ph, p + 4);
+        uint32_t vaddr  = get32(ph, p + 8);
+        uint32_t filesz = get32(ph, p + 16);
+        uint32_t memsz  = get32(ph, p + 20);
+
+        if (filesz > memsz)
+            return fail("segment at " + hex::to_hex0x32(vaddr) + " is bigger in the file than in memory");
+        if (static_cast<uint64_t>(vaddr) + memsz > mem.get_size())
+            return fail("segment at " + hex::to_hex0x32(vaddr) + " does not fit in memory");
+
+        // copy the file part in bounded pieces so huge segments need no huge buffer
+        const uint32_t chunk = 1 << 20;
+        for (uint32_t done = 0; done < filesz; done += chunk)
+        {
+            uint32_t n = filesz - done < chunk ? filesz - done : chunk;
+            if (!read_at(in, static_cast<uint64_t>(offset) + done, n, buf))
+                return fail("truncated segment at " + hex::to_hex0x32(vaddr));
+            mem.write(vaddr + done, buf.data(), n);
+        }
+
+        mem.fill(vaddr + filesz, 0, memsz - filesz);
+    }
+
+    load_symbols(in, ehdr);
+    return true;
+}
+
+//******************************************************************************
+// This function finds the symbol that addr belongs to, which is the one with
+// the highest address not above addr.
+//
+// Parameters:
+//   addr   - The address to look up.
+//   name   - Set to the name of the symbol.
+//   offset - Set to the distance of addr from the symbol.
+//
+// Return value:
+//   true if there is such a symbol, false if addr is below every symbol.
+//******************************************************************************
+bool elf_file::find_symbol(uint32_t addr, string &name, uint32_t &offset) const
+{
+    auto it = symbols.upper_bound(addr);
+    if (it == symbols.begin())
+        return false;
+
+    --it;
+    name = it->second;
+    offset = addr - it->first;
+    return true;
+}
+
+//******************************************************************************
+// These functions extract little-endian 16 and 32-bit fields from a buffer.
+//
+// Parameters:
+//   b   - The buffer.
+//   off - The offset of the field in the buffer.
+//
+// Return value:
+//   The value of the field.
+//******************************************************************************
+uint16_t elf_file::get16(const vector<uint8_t> &b, size_t off)
+{
+    return b[off] | (b[off + 1] << 8);
+}
+
+uint32_t elf_file::get32(const vector<uint8_t> &b, size_t off)
+{
+    return b[off] | (b[off + 1] << 8) | (b[off + 2] << 16) | (static_cast<uint32_t>(b[off + 3]) << 24);
+}
+
+//******************************************************************************
+// This function reads len bytes at offset off of the file into buf.
+//
+// Parameters:
+//   in  - The executable.
+//   off - The offset to read from.
+//   len - The number of bytes to read.
+//   buf - Resized to len and filled with the bytes read.
+//
+// Return value:
+//   true if all of the bytes are in the file and were read.
+//******************************************************************************
+bool elf_file::read_at(istream &in, uint64_t off, uint64_t len, vector<uint8_t> &buf)
+{
+    if (off > file_size || len > file_size - off)
+        return false;
+
+    buf.resize(len);
+    in.clear();
+    in.seekg(off);
+    return len == 0 || in.read(reinterpret_cast<char *>(buf.data()), len);
+}
+
+//******************************************************************************
+// This function reports why the file can't be loaded.
+//
+// Parameters:
+//   msg - The reason.
+//
+// Return value:
+//   false, so that callers can return fail(...) directly.
+//******************************************************************************
+bool elf_file::fail(const string &msg)
+{
+    cerr << "Bad ELF file '" << fname << "': " << msg << "." << endl;
+    return false;
+}
+
+//******************************************************************************
+// This function reads the function, object and untyped symbols that are
+// defined in the executable's symbol table. Where several symbols share an
+// address a global one is preferred. Section, file and mapping symbols are
+// ignored. A missing or damaged symbol table just leaves the table empty.
+//
+// Parameters:
+//   in   - The executable.
+//   ehdr - The ELF header.
+//
+// Return value:
+//   None
+//******************************************************************************
+void elf_file::load_symbols(istream &in, const vector<uint8_t> &ehdr)
+{
+    uint32_t shoff = get32(ehdr, 32);
+    uint16_t shentsize = get16(ehdr, 46);
+    uint16_t shnum = get16(ehdr, 48);
+
+    vector<uint8_t> sh;
+    if (!shnum || shentsize != shdr_size || !read_at(in, shoff, static_cast<uint64_t>(shnum) * shdr_size, sh))
+        return;
+
+    for (uint32_t i = 0; i < shnum; ++i)
+    {
+        size_t s = i * shdr_size;
+        if (get32(sh, s + 4) != sht_symtab)
+            continue;
+
+        uint32_t link = get32(sh, s + 24);
+        if (link >= shnum)
+            return;
+
+        vector<uint8_t> syms, strs;
+        if (!read_at(in, get32(sh, s + 16), get32(sh, s + 20), syms) ||
+            !read_at(in, get32(sh, link * shdr_size + 16), get32(sh, link * shdr_size + 20), strs))
+            return;
+
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (size_t e = 0; e + sym_size <= syms.size(); e += sym_size)
+            {
+                uint32_t name  = get32(syms, e);
+                uint32_t value = get32(syms, e + 4);
+                uint8_t info   = syms[e + 12];
+                uint16_t shndx = get16(syms, e + 14);
+
+                uint8_t type = info & 0xf;
+                bool global = (info >> 4) != 0;
+
+                if (type > 2 || shndx == 0 || name >= strs.size() || global != (pass == 0))
+                    continue;
+
+                string n;
+                for (size_t c = name; c < strs.size() && strs[c]; ++c)
+                    n += static_cast<char>(strs[c]);
+
+                if (n.empty() || n[0] == '$' || n.compare(0, 2, ".L") == 0)
+                    continue;
+
+                symbols.emplace(value, n);
+            }
+        }
+        return;
+    }
+}
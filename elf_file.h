@@ -0,0 +1,83 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+#include "memory.h"
+
+using namespace std;
+
+//******************************************************************************
+// This class loads a 32-bit little-endian RISC-V ELF executable into a memory.
+// Every PT_LOAD segment is placed at its virtual address and the part of it
+// that is not in the file (the BSS) is set to zero. The entry point and the
+// function and object symbols are kept for the simulator and its tools.
+//******************************************************************************
+class elf_file
+{
+public:
+    static bool is_elf(const string &fname);
+
+    bool load(const string &fname, memory &mem);
+    bool load(istream &in, const string &name, memory &mem);
+
+    //******************************************************************************
+    // This function returns the entry point of the last loaded executable.
+    //
+    // Parameters:
+    //   None
+    //
+    // Return value:
+    //   The address at which execution is to start.
+    //******************************************************************************
+    uint32_t get_entry() const { return entry; }
+
+    //******************************************************************************
+    // This function returns the symbols of the last loaded executable.
+    //
+    // Parameters:
+    //   None
+    //
+    // Return value:
+    //   The symbol names, indexed by address.
+    //******************************************************************************
+    const map<uint32_t, string> &get_symbols() const { return symbols; }
+
+    bool find_symbol(uint32_t addr, string &name, uint32_t &offset) const;
+
+private:
+    static constexpr uint32_t ehdr_size = 52;
+    static constexpr uint32_t phdr_size = 32;
+    static constexpr uint32_t shdr_size = 40;
+    static constexpr uint32_t sym_size  = 16;
+
+    static constexpr uint16_t et_exec   = 2;
+    static constexpr uint16_t em_riscv  = 243;
+    static constexpr uint32_t pt_load   = 1;
+    static constexpr uint32_t sht_symtab = 2;
+
+    static uint16_t get16(const vector<uint8_t> &b, size_t off);
+    static uint32_t get32(const vector<uint8_t> &b, size_t off);
+
+    bool read_at(istream &in, uint64_t off, uint64_t len, vector<uint8_t> &buf);
+    bool fail(const string &msg);
+    void load_symbols(istream &in, const vector<uint8_t> &ehdr);
+
+    string fname;
+    uint64_t file_size = 0;
+    uint32_t entry = 0;
+    map<uint32_t, string> symbols;
+};
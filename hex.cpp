@@ -10,19 +10,74 @@
 
 #include "hex.h"
 #include <iostream>
-#include <sstream>
-#include <iomanip>
 using namespace std;
 
+static const char hex_digits[] = "0123456789abcdef";
+
+//******************************************************************************
+// This function writes the digits least significant hex digits of i into buf.
+//
+// Parameters:
+//   buf    - Where to write the digits.
+//   i      - The value to format.
+//   digits - The number of hex digits to write.
+//
+// Return value:
+//   A pointer just past the last digit written.
+//******************************************************************************
+char *hex::to_hex(char *buf, uint32_t i, int digits)
+{
+  for (int d = digits - 1; d >= 0; --d)
+  {
+    buf[d] = hex_digits[i & 0xf];
+    i >>= 4;
+  }
+  return buf + digits;
+}
+
+//******************************************************************************
+// These functions write the same text as the string returning functions below
+// into buf and return a pointer just past it.
+//******************************************************************************
+char *hex::to_hex8(char *buf, uint8_t i)
+{
+  return to_hex(buf, i, 2);
+}
+
+char *hex::to_hex32(char *buf, uint32_t i)
+{
+  return to_hex(buf, i, 8);
+}
+
+char *hex::to_hex0x32(char *buf, uint32_t i)
+{
+  buf[0] = '0';
+  buf[1] = 'x';
+  return to_hex(buf + 2, i, 8);
+}
+
+char *hex::to_hex0x20(char *buf, uint32_t i)
+{
+  buf[0] = '0';
+  buf[1] = 'x';
+  return to_hex(buf + 2, i & 0xFFFFF, 5);
+}
+
+char *hex::to_hex0x12(char *buf, uint32_t i)
+{
+  buf[0] = '0';
+  buf[1] = 'x';
+  return to_hex(buf + 2, i & 0xFFF, 3);
+}
+
 //******************************************************************************
 // This function takes a uint8_t parameter i must return a std::string with exactly 2  
 // hex digits representing the 8 bits of the i argument.
 //******************************************************************************
 string hex::to_hex8(uint8_t i)
 {
-  ostringstream os;
-  os << std::hex << setfill('0') << setw(2) << static_cast<uint16_t>(i);
-  return os.str();
+  char buf[2];
+  return string(buf, to_hex8(buf, i));
 }
 
 //******************************************************************************
@@ -31,9 +86,8 @@ string hex::to_hex8(uint8_t i)
 //******************************************************************************
 string hex::to_hex32(uint32_t i)
 {
-  ostringstream os;
-  os << std::hex << setfill('0') << setw(8) << i;
-  return os.str();
+  char buf[8];
+  return string(buf, to_hex32(buf, i));
 }
 
 //******************************************************************************
@@ -42,7 +96,8 @@ string hex::to_hex32(uint32_t i)
 //******************************************************************************
 string hex::to_hex0x32(uint32_t i)
 {
-  return string("0x")+to_hex32(i);
+  char buf[10];
+  return string(buf, to_hex0x32(buf, i));
 }
 
 //******************************************************************************
@@ -52,12 +107,8 @@ string hex::to_hex0x32(uint32_t i)
 //******************************************************************************
 string hex::to_hex0x20(uint32_t i)
 {
-  uint32_t val = i & 0xFFFFF;   // keep ONLY low 20 bits
-
-  ostringstream os;
-  os << "0x" << std::hex << setfill('0') << setw(5) << val;
-
-  return os.str();
+  char buf[7];
+  return string(buf, to_hex0x20(buf, i));
 }
 
 //******************************************************************************
@@ -67,10 +118,6 @@ string hex::to_hex0x20(uint32_t i)
 //******************************************************************************
 string hex::to_hex0x12(uint32_t i)
 {
-  uint32_t val = i & 0xFFF;   // keep ONLY low 20 bits
-
-  ostringstream os;
-  os << "0x" << std::hex << setfill('0') << setw(3) << val;
-
-  return os.str();
-}
\ No newline at end of file
+  char buf[5];
+  return string(buf, to_hex0x12(buf, i));
+}
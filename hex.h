@@ -14,7 +14,9 @@
 
 //******************************************************************************
 // contains some utility functions for formatting numbers as hex strings
-// for printing
+// for printing. The overloads taking a char buffer write the digits straight
+// into it (without a terminating nul) and return a pointer just past them, so
+// hot paths such as the trace can format a whole line without allocating.
 //******************************************************************************
 
 class hex
@@ -25,4 +27,13 @@ class hex
     static std::string to_hex0x32(uint32_t i);
     static std::string to_hex0x20(uint32_t i);
     static std::string to_hex0x12(uint32_t i);
+
+    static char *to_hex8(char *buf, uint8_t i);
+    static char *to_hex32(char *buf, uint32_t i);
+    static char *to_hex0x32(char *buf, uint32_t i);
+    static char *to_hex0x20(char *buf, uint32_t i);
+    static char *to_hex0x12(char *buf, uint32_t i);
+
+  private:
+    static char *to_hex(char *buf, uint32_t i, int digits);
 };
\ No newline at end of file
@@ -0,0 +1,193 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+
+#include "image_cache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+
+using namespace std;
+
+//******************************************************************************
+// This function returns the image in the file named fname, reading the file
+// only if it is not the one that was read last time under this name.
+//
+// Parameters:
+//   fname - The name of the file.
+//
+// Return value:
+//   The image, or nullptr (after printing why) if the file can't be read.
+//******************************************************************************
+shared_ptr<const program_image> image_cache::get_file(const string &fname)
+{
+    struct stat st;
+    if (stat(fname.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        cerr << "Can't open file '" << fname << "' for reading." << endl;
+        return nullptr;
+    }
+
+    file_key key;
+    key.dev = st.st_dev;
+    key.ino = st.st_ino;
+    key.size = st.st_size;
+    key.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+
+    {
+        lock_guard<mutex> guard(lock);
+        auto f = files.find(fname);
+        if (f != files.end() && f->second.same_file(key))
+        {
+            ++hits;
+            ++file_hits;
+            return find(f->second.hash);
+        }
+    }
+
+    ifstream in(fname, ios::in | ios::binary);
+    vector<uint8_t> data(key.size);
+    if (!in || !in.read(reinterpret_cast<char *>(data.data()), data.size()))
+    {
+        cerr << "Can't open file '" << fname << "' for reading." << endl;
+        return nullptr;
+    }
+
+    shared_ptr<const program_image> image = get_bytes(move(data));
+
+    lock_guard<mutex> guard(lock);
+    forget_file(fname);
+    if (find(image->get_hash()) == image)
+    {
+        key.hash = image->get_hash();
+        files[fname] = key;
+        images[key.hash].names.push_back(fname);
+    }
+    return image;
+}
+
+//******************************************************************************
+// This function returns the image of bytes: the cached image with the same
+// content if there is one, or else a new image, which is cached.
+//
+// Parameters:
+//   bytes - The bytes of the image.
+//
+// Return value:
+//   The image.
+//******************************************************************************
+shared_ptr<const program_image> image_cache::get_bytes(vector<uint8_t> bytes)
+{
+    shared_ptr<const program_image> image = make_shared<const program_image>(move(bytes));
+
+    lock_guard<mutex> guard(lock);
+    shared_ptr<const program_image> cached = find(image->get_hash());
+    if (cached && cached->get_bytes() == image->get_bytes())
+    {
+        ++hits;
+        return cached;
+    }
+
+    ++misses;
+    return cached ? image : insert(image);
+}
+
+//******************************************************************************
+// This function summarizes the contents of the cache and how often it has
+// been of use.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   A line of text (without a newline).
+//******************************************************************************
+string image_cache::get_stats()
+{
+    lock_guard<mutex> guard(lock);
+    ostringstream os;
+    os << images.size() << " images, " << bytes << " bytes, " << hits << " hits ("
+       << file_hits << " by file name), " << misses << " misses";
+    return os.str();
+}
+
+//******************************************************************************
+// This function finds the image with the given hash and makes it the most
+// recently used. The caller holds the lock.
+//
+// Parameters:
+//   hash - The hash of the image.
+//
+// Return value:
+//   The image, or nullptr if there is no image with that hash.
+//******************************************************************************
+shared_ptr<const program_image> image_cache::find(uint64_t hash)
+{
+    auto it = images.find(hash);
+    if (it == images.end())
+        return nullptr;
+
+    used.splice(used.begin(), used, it->second.use);
+    return it->second.image;
+}
+
+//******************************************************************************
+// This function adds an image, whose hash is not in the cache yet, and drops
+// the least recently used images, and the file names that lead to them, while
+// the cache is over its size (but never the one just added). The caller holds
+// the lock.
+//
+// Parameters:
+//   image - The image.
+//
+// Return value:
+//   image
+//******************************************************************************
+shared_ptr<const program_image> image_cache::insert(shared_ptr<const program_image> image)
+{
+    used.push_front(image->get_hash());
+    images[image->get_hash()] = { image, used.begin(), {} };
+    bytes += image->get_bytes().size();
+
+    while (bytes > max_bytes && used.size() > 1)
+    {
+        auto it = images.find(used.back());
+        bytes -= it->second.image->get_bytes().size();
+        for (const string &name : it->second.names)
+            files.erase(name);
+        images.erase(it);
+        used.pop_back();
+    }
+    return image;
+}
+
+//******************************************************************************
+// This function forgets what was last read from the file named fname, if
+// anything. The caller holds the lock.
+//
+// Parameters:
+//   fname - The name of the file.
+//
+// Return value:
+//   None
+//******************************************************************************
+void image_cache::forget_file(const string &fname)
+{
+    auto f = files.find(fname);
+    if (f == files.end())
+        return;
+
+    vector<string> &names = images[f->second.hash].names;
+    names.erase(std::find(names.begin(), names.end(), fname));
+    files.erase(f);
+}
@@ -0,0 +1,91 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "program_image.h"
+
+using namespace std;
+
+//******************************************************************************
+// The images that jobs have run, keyed by content hash and shared between all
+// the threads of a job_server. An image given by its bytes is found by its
+// hash (and the bytes compared). An image given by a file name is found by the
+// name as long as the file's device, inode, size and modification time are the
+// same as when it was read, so a repeated job reads nothing; otherwise the
+// file is read and then found by its hash like any other image. When the
+// images take more than max_bytes the least recently used are dropped (jobs
+// that are still running one keep it until they are done), and with each the
+// file names that were found to hold it, so the names kept are no more than
+// the images hold.
+//******************************************************************************
+class image_cache
+{
+public:
+    static constexpr uint64_t default_max_bytes = 256 << 20;
+
+    explicit image_cache(uint64_t max_bytes = default_max_bytes) : max_bytes(max_bytes) {}
+
+    shared_ptr<const program_image> get_file(const string &fname);
+    shared_ptr<const program_image> get_bytes(vector<uint8_t> bytes);
+
+    string get_stats();
+
+private:
+    //******************************************************************************
+    // What a file was when it was read, and the hash of the image read from it.
+    //******************************************************************************
+    struct file_key
+    {
+        uint64_t dev, ino, size;
+        int64_t mtime_ns;
+        uint64_t hash;
+
+        bool same_file(const file_key &k) const
+        {
+            return dev == k.dev && ino == k.ino && size == k.size && mtime_ns == k.mtime_ns;
+        }
+    };
+
+    //******************************************************************************
+    // A cached image, its place in the use order and the names in files that
+    // lead to it.
+    //******************************************************************************
+    struct entry
+    {
+        shared_ptr<const program_image> image;
+        list<uint64_t>::iterator use;
+        vector<string> names;
+    };
+
+    shared_ptr<const program_image> find(uint64_t hash);
+    shared_ptr<const program_image> insert(shared_ptr<const program_image> image);
+    void forget_file(const string &fname);
+
+    mutex lock;
+    uint64_t max_bytes;
+    uint64_t bytes = 0;                         // sum of the sizes of the images
+    unordered_map<uint64_t, entry> images;      // by hash
+    list<uint64_t> used;                        // hashes, most recently used first
+    unordered_map<string, file_key> files;      // by file name, of cached images only
+
+    uint64_t hits = 0;                          // images found
+    uint64_t misses = 0;                        // images read or received
+    uint64_t file_hits = 0;                     // of the hits, found by file name
+};
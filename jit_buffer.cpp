@@ -0,0 +1,78 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "jit_buffer.h"
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+//******************************************************************************
+// This constructor maps siz bytes of readable, writable and executable memory.
+// If the mapping is refused the buffer is left unusable and commit() always
+// fails, so callers simply keep interpreting.
+//
+// Parameters:
+//   siz - The number of bytes to reserve for generated code.
+//******************************************************************************
+jit_buffer::jit_buffer(size_t siz)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    void *p = mmap(nullptr, siz, PROT_READ | PROT_WRITE | PROT_EXEC,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p != MAP_FAILED)
+    {
+        base = static_cast<uint8_t *>(p);
+        size = siz;
+    }
+#else
+    (void)siz;
+#endif
+}
+
+//******************************************************************************
+// destructor unmaps the code region
+//******************************************************************************
+jit_buffer::~jit_buffer()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (base)
+        munmap(base, size);
+#endif
+}
+
+//******************************************************************************
+// This function copies a finished piece of machine code into the executable
+// region.
+//
+// Parameters:
+//   code - The machine code to commit.
+//
+// Return value:
+//   The address of the committed code, or nullptr if the buffer is unusable or
+//   does not have room for it.
+//******************************************************************************
+void *jit_buffer::commit(const vector<uint8_t> &code)
+{
+    if (!base || code.size() > size - used)
+        return nullptr;
+
+    uint8_t *p = base + used;
+    memcpy(p, code.data(), code.size());
+
+    used += (code.size() + 15) & ~static_cast<size_t>(15);
+    if (used > size)
+        used = size;
+
+    return p;
+}
@@ -0,0 +1,51 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+//******************************************************************************
+// An mmap'd region of executable memory that machine code is appended to. Code
+// is assembled into a staging vector and then committed to the region as one
+// piece; the region is never reused, so committed code stays valid for the
+// lifetime of the buffer.
+//******************************************************************************
+class jit_buffer
+{
+public:
+    jit_buffer(size_t siz);
+    ~jit_buffer();
+
+    jit_buffer(const jit_buffer &) = delete;
+    jit_buffer &operator=(const jit_buffer &) = delete;
+
+    //******************************************************************************
+    // This function reports whether the executable region could be mapped.
+    //
+    // Parameters:
+    //   None
+    //
+    // Return value:
+    //   true if code can be committed to the buffer.
+    //******************************************************************************
+    bool is_usable() const              { return base != nullptr; }
+
+    void *commit(const vector<uint8_t> &code);
+
+private:
+    uint8_t *base = nullptr;
+    size_t size   = 0;
+    size_t used   = 0;
+};
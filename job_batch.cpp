@@ -0,0 +1,149 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "job_batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+//******************************************************************************
+// This function reads the jobs of a manifest.
+//
+// Parameters:
+//   fname      - The name of the manifest.
+//   mem_size   - The memory size of jobs that do not give one.
+//   exec_limit - The instruction limit of jobs that do not give one.
+//
+// Return value:
+//   true if the manifest was read, false (after printing why) if it could not
+//   be opened or has a line that is not a job.
+//******************************************************************************
+bool job_batch::load_manifest(const string &fname, uint32_t mem_size, uint64_t exec_limit)
+{
+    ifstream in(fname);
+    if (!in)
+    {
+        cerr << "Can't open file '" << fname << "' for reading." << endl;
+        return false;
+    }
+
+    string line;
+    for (uint32_t n = 1; getline(in, line); ++n)
+    {
+        istringstream iss(line);
+        sim_job job;
+        if (!(iss >> job.image) || job.image[0] == '#')
+            continue;
+
+        job.mem_size = mem_size;
+        job.exec_limit = exec_limit;
+        string extra;
+        if ((iss >> std::hex >> job.mem_size) && (iss >> std::dec >> job.exec_limit))
+            iss >> extra;
+        if (!iss.eof() || !extra.empty())
+        {
+            cerr << fname << ":" << n << ": Bad job: " << line << endl;
+            return false;
+        }
+        jobs.push_back(job);
+    }
+
+    results.assign(jobs.size(), sim_result());
+    return true;
+}
+
+//******************************************************************************
+// This function runs every job. Each thread takes the next job not yet taken
+// until none is left.
+//
+// Parameters:
+//   threads - The number of threads (0 = one per hardware thread). No more
+//             threads than jobs are started.
+//   engine  - The execution engine the jobs run with.
+//
+// Return value:
+//   None
+//******************************************************************************
+void job_batch::run(uint32_t threads, cpu_single_hart::engine_type engine)
+{
+    uint32_t n = threads ? threads : thread::hardware_concurrency();
+    n = max<uint32_t>(1, min<size_t>(n, jobs.size()));
+
+    atomic<size_t> next{0};
+    auto work = [&]()
+    {
+        job_runner runner(engine);
+        for (size_t i; (i = next.fetch_add(1, memory_order_relaxed)) < jobs.size(); )
+            runner.run(jobs[i], results[i]);
+    };
+
+    auto start_time = chrono::steady_clock::now();
+
+    vector<thread> pool;
+    for (uint32_t i = 1; i < n; ++i)
+        pool.emplace_back(work);
+    work();
+    for (thread &t : pool)
+        t.join();
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start_time;
+    seconds = elapsed.count();
+    nthreads = n;
+}
+
+//******************************************************************************
+// This function writes the summary: a header row, then for each job its
+// number and image followed by its sim_result::write() fields. With
+// show_speed a last line, starting with #, gives the totals.
+//
+// Parameters:
+//   os         - The stream to write to.
+//   show_speed - true to write the totals.
+//
+// Return value:
+//   None
+//******************************************************************************
+void job_batch::write_summary(ostream &os, bool show_speed) const
+{
+    os << "job\timage\tstatus\treason\tinstructions\tseconds\tpc";
+    for (uint32_t r = 0; r < 32; ++r)
+        os << "\tx" << r;
+    os << "\n";
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        os << i << "\t" << jobs[i].image << "\t";
+        results[i].write(os);
+        os << "\n";
+        total += results[i].insns;
+    }
+
+    if (show_speed)
+    {
+        ios::fmtflags flags = os.flags();
+        streamsize prec = os.precision();
+        os << fixed << setprecision(2) << "# " << jobs.size() << " jobs, " << total << " instructions, "
+           << (seconds > 0 ? total / seconds / 1e6 : 0) << " MIPS (" << seconds << " seconds, "
+           << nthreads << " threads)\n";
+        os.flags(flags);
+        os.precision(prec);
+    }
+
+    os.flush();
+}
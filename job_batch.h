@@ -0,0 +1,47 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cpu_single_hart.h"
+#include "job_runner.h"
+
+using namespace std;
+
+//******************************************************************************
+// A batch of independent jobs read from a manifest and run on a fixed pool of
+// threads, each with a job_runner of its own, in place of one process per
+// image. A manifest has one job per line:
+//
+//     image [hex-mem-size [exec-limit]]
+//
+// where the sizes default to those of -m and -l. Blank lines and lines that
+// start with # are skipped. The summary is a tab separated table with a row
+// per job, in manifest order.
+//******************************************************************************
+class job_batch
+{
+public:
+    bool load_manifest(const string &fname, uint32_t mem_size, uint64_t exec_limit);
+    void run(uint32_t threads, cpu_single_hart::engine_type engine);
+    void write_summary(ostream &os, bool show_speed) const;
+
+private:
+    vector<sim_job> jobs;
+    vector<sim_result> results;
+
+    uint32_t nthreads = 0;          // threads the last run() used
+    double seconds = 0;             // wall time of the last run()
+};
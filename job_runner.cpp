@@ -0,0 +1,151 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "job_runner.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "elf_file.h"
+#include "hex.h"
+
+using namespace std;
+
+//******************************************************************************
+// This function loads and runs a job the way main() runs its infile and
+// records the outcome.
+//
+// Parameters:
+//   job    - The job.
+//   result - Set to what became of it.
+//
+// Return value:
+//   None
+//******************************************************************************
+void job_runner::run(const sim_job &job, sim_result &result)
+{
+    auto start_time = chrono::steady_clock::now();
+
+    if (!mem)
+    {
+        mem.reset(new memory(job.mem_size));
+        mem->set_warnings(false);
+        hart.reset(new cpu_single_hart(*mem));
+        hart->set_engine(engine);
+    }
+    else
+    {
+        mem->reset(job.mem_size);
+    }
+
+    result = sim_result();
+
+    uint32_t entry = 0;                     // 0 for a flat binary image
+    if (job.program)
+    {
+        result.loaded = job.program->load(*mem, entry);
+    }
+    else if (elf_file::is_elf(job.image))
+    {
+        elf_file elf;
+        result.loaded = elf.load(job.image, *mem);
+        entry = elf.get_entry();
+    }
+    else
+    {
+        result.loaded = mem->load_file(job.image);
+    }
+
+    if (result.loaded)
+    {
+        uint64_t limit = job.exec_limit ? job.exec_limit : UINT64_MAX;
+
+        hart->reset();
+        hart->set_pc(entry);
+        hart->set_mhartid(0);
+        hart->init_stack();
+
+        if (job.show_instructions || job.show_registers)
+            run_traced(job, limit, result.trace);
+        else
+            hart->run_slice(limit);
+
+        result.halted = hart->is_halted();
+        result.halt_reason = hart->get_halt_reason();
+        result.insns = hart->get_insn_counter();
+        for (uint32_t r = 0; r < 32; ++r)
+            result.regs[r] = static_cast<uint32_t>(hart->get_registers().get(r));
+        result.pc = hart->get_pc();
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start_time;
+    result.seconds = elapsed.count();
+}
+
+//******************************************************************************
+// This function runs the loaded job with its traces on and captures them. The
+// hart and memory print them to a stream of this job's own, so the traced jobs
+// of several runners run at once.
+//
+// Parameters:
+//   job   - The job.
+//   limit - The instruction count to stop at.
+//   trace - Set to the text of the traces.
+//
+// Return value:
+//   None
+//******************************************************************************
+void job_runner::run_traced(const sim_job &job, uint64_t limit, string &trace)
+{
+    ostringstream text;
+    hart->set_trace_output(text);
+    mem->set_warning_output(text);
+    mem->set_warnings(true);
+    hart->set_show_instructions(job.show_instructions);
+    hart->set_show_registers(job.show_registers);
+
+    hart->run_ticks(limit);
+
+    hart->set_show_registers(false);
+    hart->set_show_instructions(false);
+    mem->set_warnings(false);
+    mem->set_warning_output(cout);
+    hart->set_trace_output(cout);
+    trace = text.str();
+}
+
+//******************************************************************************
+// This function writes the outcome of a job as tab separated fields: its
+// status (halted, limit when it reached its instruction limit, or error when
+// the image could not be loaded), the halt reason, the number of instructions
+// executed, the wall time in seconds, and the final pc and x0-x31 in hex.
+//
+// Parameters:
+//   os - The stream to write to.
+//
+// Return value:
+//   None
+//******************************************************************************
+void sim_result::write(ostream &os) const
+{
+    ios::fmtflags flags = os.flags();
+    streamsize prec = os.precision();
+
+    os << (!loaded ? "error" : halted ? "halted" : "limit") << "\t"
+       << (loaded ? halt_reason : "Can't load image") << "\t" << insns << "\t"
+       << fixed << setprecision(6) << seconds << "\t" << hex::to_hex32(pc);
+    for (uint32_t r = 0; r < 32; ++r)
+        os << "\t" << hex::to_hex32(regs[r]);
+
+    os.flags(flags);
+    os.precision(prec);
+}
@@ -0,0 +1,76 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "cpu_single_hart.h"
+#include "memory.h"
+#include "program_image.h"
+
+using namespace std;
+
+//******************************************************************************
+// A simulation to run: the image to load, the memory and instruction count to
+// run it with, and the traces (as -i and -r) to capture.
+//******************************************************************************
+struct sim_job
+{
+    string image;                   // ELF32 executable or flat binary
+    shared_ptr<const program_image> program;    // if set, loaded instead of image
+    uint32_t mem_size = 0x100;
+    uint64_t exec_limit = 0;        // 0 = no limit
+    bool show_instructions = false;
+    bool show_registers = false;
+};
+
+//******************************************************************************
+// What became of a job.
+//******************************************************************************
+struct sim_result
+{
+    bool loaded = false;            // false if the image could not be loaded
+    bool halted = false;
+    string halt_reason = "none";
+    uint64_t insns = 0;
+    uint32_t regs[32] = {};
+    uint32_t pc = 0;
+    double seconds = 0;             // wall time, loading included
+    string trace;                   // the -i and -r text of a traced job
+
+    void write(ostream &os) const;
+};
+
+//******************************************************************************
+// A hart and memory that run one job after another. The memory is created for
+// the first job and reset() to each later job's size, so a job costs neither
+// an allocation nor a fill of the whole memory. The memory warnings are off:
+// the jobs of several runners may be running at once. A traced job runs with
+// the switch engine and its warnings on, and the hart and memory print its
+// traces and warnings into the job's result instead of cout.
+//******************************************************************************
+class job_runner
+{
+public:
+    explicit job_runner(cpu_single_hart::engine_type engine) : engine(engine) {}
+
+    void run(const sim_job &job, sim_result &result);
+
+private:
+    void run_traced(const sim_job &job, uint64_t limit, string &trace);
+
+    cpu_single_hart::engine_type engine;
+    unique_ptr<memory> mem;
+    unique_ptr<cpu_single_hart> hart;
+};
@@ -0,0 +1,486 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+
+#include "job_server.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+//******************************************************************************
+// A connection to a client, read through a buffer of its own so that request
+// lines cost a system call per buffer rather than per byte. A read waits at
+// most request_timeout seconds for data, and the connection is closed when the
+// object goes.
+//******************************************************************************
+class job_server::connection
+{
+public:
+    explicit connection(int fd) : fd(fd)
+    {
+        timeval tv = {request_timeout, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    ~connection() { close(fd); }
+
+    int get_fd() const { return fd; }
+
+    //******************************************************************************
+    // This function tells whether data read from the client is still waiting
+    // in the buffer, where polling the connection would not see it.
+    //
+    // Parameters:
+    //   None
+    //
+    // Return value:
+    //   true if there is such data.
+    //******************************************************************************
+    bool has_input() const { return pos < len; }
+
+    //******************************************************************************
+    // This function reads a line.
+    //
+    // Parameters:
+    //   line - Set to the line, without its newline.
+    //
+    // Return value:
+    //   true if a whole line was read, false at the end of the connection or
+    //   if the line is too long to be a request.
+    //******************************************************************************
+    bool read_line(string &line)
+    {
+        line.clear();
+        for (;;)
+        {
+            for (; pos < len; ++pos)
+            {
+                if (buf[pos] == '\n')
+                {
+                    ++pos;
+                    return true;
+                }
+                line += buf[pos];
+            }
+            if (line.size() > max_line || !fill())
+                return false;
+        }
+    }
+
+    //******************************************************************************
+    // This function reads n bytes.
+    //
+    // Parameters:
+    //   dst - Where to put them.
+    //   n   - The number of bytes.
+    //
+    // Return value:
+    //   true if all of them were read.
+    //******************************************************************************
+    bool read(uint8_t *dst, size_t n)
+    {
+        while (n)
+        {
+            if (pos == len && !fill())
+                return false;
+            size_t k = min(n, len - pos);
+            memcpy(dst, buf + pos, k);
+            pos += k;
+            dst += k;
+            n -= k;
+        }
+        return true;
+    }
+
+    //******************************************************************************
+    // This function writes text.
+    //
+    // Parameters:
+    //   s - The text.
+    //
+    // Return value:
+    //   true if all of it was written.
+    //******************************************************************************
+    bool write(const string &s)
+    {
+        for (size_t done = 0; done < s.size(); )
+        {
+            ssize_t k = send(fd, s.data() + done, s.size() - done, MSG_NOSIGNAL);
+            if (k < 0 && errno == EINTR)
+                continue;
+            if (k <= 0)
+                return false;
+            done += k;
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t max_line = 1 << 16;
+
+    bool fill()
+    {
+        ssize_t k;
+        do
+            k = ::read(fd, buf, sizeof(buf));
+        while (k < 0 && errno == EINTR);
+
+        pos = 0;
+        len = k > 0 ? k : 0;
+        return k > 0;
+    }
+
+    int fd;
+    char buf[1 << 16];
+    size_t pos = 0, len = 0;
+};
+
+//******************************************************************************
+// constructor
+//
+// Parameters:
+//   threads - The number of threads to run jobs on, 0 for one per hardware
+//             thread.
+//   engine  - The execution engine to run them with.
+//******************************************************************************
+job_server::job_server(uint32_t threads, cpu_single_hart::engine_type engine)
+    : nthreads(threads), engine(engine)
+{
+}
+
+//******************************************************************************
+// This function listens on the Unix domain socket path (replacing a socket
+// left there by an earlier server) and serves the connections made to it
+// until a client asks the server to quit. The socket is removed again before
+// it returns.
+//
+// Parameters:
+//   path - The file name of the socket.
+//
+// Return value:
+//   true if the server ran, false (after printing why) if it could not
+//   listen on path.
+//******************************************************************************
+bool job_server::serve(const string &path)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+    {
+        cerr << "Bad socket name '" << path << "'." << endl;
+        return false;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path.c_str());
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd, SOMAXCONN) != 0)
+    {
+        cerr << "Can't listen on '" << path << "': " << strerror(errno) << "." << endl;
+        if (listen_fd >= 0)
+            close(listen_fd);
+        return false;
+    }
+    if (pipe2(wake_fd, O_CLOEXEC | O_NONBLOCK) != 0)
+    {
+        cerr << "Can't create a pipe: " << strerror(errno) << "." << endl;
+        close(listen_fd);
+        return false;
+    }
+
+    uint32_t n = nthreads ? nthreads : thread::hardware_concurrency();
+    vector<thread> pool;
+    for (uint32_t i = 0; i < max<uint32_t>(n, 1); ++i)
+        pool.emplace_back(&job_server::work, this);
+
+    // the connections waiting for their next request, polled after the wake
+    // pipe and the listening socket
+    vector<unique_ptr<connection>> idle;
+    vector<pollfd> fds;
+    for (;;)
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            if (stopping)
+                break;
+            for (unique_ptr<connection> &conn : served)
+                idle.push_back(move(conn));
+            served.clear();
+        }
+
+        fds.assign({{wake_fd[0], POLLIN, 0}, {listen_fd, POLLIN, 0}});
+        for (const unique_ptr<connection> &conn : idle)
+            fds.push_back({conn->get_fd(), POLLIN, 0});
+        if (poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno != EINTR)
+                cerr << "Can't poll the connections: " << strerror(errno) << "." << endl;
+            continue;
+        }
+
+        char drain[64];
+        if (fds[0].revents)
+            while (read(wake_fd[0], drain, sizeof(drain)) > 0)
+                ;
+
+        {
+            // a connection that was closed is readable too, and is closed by
+            // the thread that finds nothing to read
+            lock_guard<mutex> guard(lock);
+            size_t kept = 0;
+            for (size_t i = 0; i < idle.size(); ++i)
+            {
+                if (fds[i + 2].revents)
+                {
+                    pending.push_back(move(idle[i]));
+                    ready.notify_one();
+                }
+                else
+                {
+                    idle[kept++] = move(idle[i]);
+                }
+            }
+            idle.resize(kept);
+        }
+
+        if (fds[1].revents)
+        {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0)
+            {
+                ++connections;
+                idle.push_back(make_unique<connection>(fd));
+            }
+            else if (errno != EINTR && errno != ECONNABORTED && errno != EAGAIN)
+            {
+                cerr << "Can't accept a connection: " << strerror(errno) << "." << endl;
+            }
+        }
+    }
+
+    for (thread &t : pool)
+        t.join();
+    idle.clear();
+    served.clear();
+
+    close(wake_fd[0]);
+    close(wake_fd[1]);
+    close(listen_fd);
+    unlink(path.c_str());
+    return true;
+}
+
+//******************************************************************************
+// destructor (no param)
+//******************************************************************************
+job_server::~job_server() = default;
+
+//******************************************************************************
+// This function summarizes what the server has done.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   A line of text (without a newline).
+//******************************************************************************
+string job_server::get_stats()
+{
+    return to_string(connections.load()) + " connections, " + to_string(jobs.load()) + " jobs, image cache: " +
+           cache.get_stats();
+}
+
+//******************************************************************************
+// This function is run by each thread of the pool. It takes a connection with
+// a request waiting, serves the requests that have arrived on it, and gives it
+// back to serve() to be polled for more rather than wait on it. Its jobs are
+// run with a job_runner that lives as long as the thread.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   None
+//******************************************************************************
+void job_server::work()
+{
+    job_runner runner(engine);
+
+    for (;;)
+    {
+        unique_ptr<connection> conn;
+        {
+            unique_lock<mutex> guard(lock);
+            ready.wait(guard, [this]() { return stopping || !pending.empty(); });
+            if (pending.empty())
+                return;
+            conn = move(pending.front());
+            pending.pop_front();
+            if (stopping)
+                continue;
+            active.insert(conn->get_fd());
+        }
+
+        bool open;
+        do
+            open = serve_request(*conn, runner);
+        while (open && conn->has_input());
+
+        lock_guard<mutex> guard(lock);
+        active.erase(conn->get_fd());
+        if (open && !stopping)
+        {
+            served.push_back(move(conn));
+            wake();
+        }
+    }
+}
+
+//******************************************************************************
+// This function reads a request from conn and replies to it.
+//
+// Parameters:
+//   conn   - The connection.
+//   runner - The job_runner to run a job with.
+//
+// Return value:
+//   true if the connection is to be served further, false if it is to be
+//   closed.
+//******************************************************************************
+bool job_server::serve_request(connection &conn, job_runner &runner)
+{
+    string line;
+    if (!conn.read_line(line))
+        return false;
+
+    istringstream iss(line);
+    string cmd;
+    iss >> cmd;
+
+    if (cmd == "stats" || cmd == "quit")
+    {
+        string body = cmd == "stats" ? get_stats() + "\n" : "";
+        if (!conn.write("ok " + to_string(body.size()) + "\n" + body))
+            return false;
+        if (cmd == "quit")
+            stop();
+        return true;
+    }
+
+    sim_job job;
+    string trace, kind;
+    if (cmd == "run")
+        iss >> std::hex >> job.mem_size >> std::dec >> job.exec_limit >> trace >> kind;
+    for (size_t i = 0; trace != "-" && i < trace.size(); ++i)
+    {
+        job.show_instructions |= trace[i] == 'i';
+        job.show_registers |= trace[i] == 'r';
+        if (trace[i] != 'i' && trace[i] != 'r')
+            iss.setstate(ios::failbit);
+    }
+
+    if (iss && kind == "file" && iss.get() == ' ' && getline(iss, job.image) && !job.image.empty())
+    {
+        job.program = cache.get_file(job.image);
+    }
+    else if (iss && kind == "bytes")
+    {
+        uint64_t n;
+        string extra;
+        if (!(iss >> n) || (iss >> extra) || n > job.mem_size)
+        {
+            conn.write("error Bad request\n");
+            return false;
+        }
+
+        // the image grows only as its bytes arrive, so a client can't make
+        // the server hold more memory than it has actually sent
+        vector<uint8_t> bytes;
+        while (bytes.size() < n)
+        {
+            size_t done = bytes.size();
+            size_t k = min<uint64_t>(n - done, max_chunk);
+            bytes.resize(done + k);
+            if (!conn.read(bytes.data() + done, k))
+                return false;
+        }
+        job.program = cache.get_bytes(move(bytes));
+    }
+    else
+    {
+        conn.write("error Bad request\n");
+        return false;
+    }
+
+    sim_result result;
+    if (job.program)
+        runner.run(job, result);
+    ++jobs;
+
+    ostringstream body;
+    body << result.trace;
+    result.write(body);
+    body << "\n";
+    return conn.write("ok " + to_string(body.str().size()) + "\n" + body.str());
+}
+
+//******************************************************************************
+// This function stops the server: no more connections are accepted, those
+// waiting to be served are closed, and those being served are closed once
+// the requests already sent on them are done.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   None
+//******************************************************************************
+void job_server::stop()
+{
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+    for (int fd : active)
+        shutdown(fd, SHUT_RD);
+    wake();
+    ready.notify_all();
+}
+
+//******************************************************************************
+// This function wakes serve() from its poll so that it sees the connections
+// given back to it and whether the server is stopping.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   None
+//******************************************************************************
+void job_server::wake()
+{
+    // the pipe is only ever full when serve() has yet to read it anyway
+    char c = 0;
+    [[maybe_unused]] ssize_t k = write(wake_fd[1], &c, 1);
+}
@@ -0,0 +1,89 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "cpu_single_hart.h"
+#include "image_cache.h"
+#include "job_runner.h"
+
+using namespace std;
+
+//******************************************************************************
+// A long-lived simulator that runs jobs sent to it over a Unix domain socket,
+// so that a test driver pays for neither a process start nor a file read per
+// job. The server polls the open connections and hands each one that has a
+// request waiting to a fixed pool of threads, so a connection held open
+// between jobs takes no thread. Each thread runs jobs with a job_runner of its
+// own, whose hart and memory stay warm from job to job, and the images are kept
+// in an image_cache shared by all of them. A client that wants jobs run at once
+// opens a connection per job stream. A request is a line:
+//
+//     run <hex-mem-size> <exec-limit> <trace> file <image>
+//     run <hex-mem-size> <exec-limit> <trace> bytes <n>
+//     stats
+//     quit
+//
+// where trace is - or any of i and r (as -i and -r), <image> is the rest of
+// the line, and a bytes request is followed by the n bytes of the image. The
+// reply to a good request is "ok <n>" and a newline followed by n bytes: for
+// run the job's trace and then its sim_result::write() fields and a newline,
+// for stats a line of counts. quit stops the server once the jobs being run
+// are done. The reply to anything else is "error <message>" and a newline,
+// and the connection is closed, as it is when the rest of a request takes
+// longer than request_timeout seconds to arrive.
+//******************************************************************************
+class job_server
+{
+public:
+    job_server(uint32_t threads, cpu_single_hart::engine_type engine);
+    ~job_server();
+
+    bool serve(const string &path);
+    string get_stats();
+
+private:
+    class connection;
+
+    void work();
+    bool serve_request(connection &conn, job_runner &runner);
+    void stop();
+    void wake();
+
+    static constexpr size_t max_chunk = 1 << 20;   // bytes of an image read at a time
+    static constexpr int request_timeout = 10;      // seconds
+
+    uint32_t nthreads;                  // 0 = one per hardware thread
+    cpu_single_hart::engine_type engine;
+    image_cache cache;
+
+    mutex lock;
+    condition_variable ready;
+    deque<unique_ptr<connection>> pending;  // connections with a request waiting
+    vector<unique_ptr<connection>> served;  // connections to be polled again
+    set<int> active;                    // connections being served
+    bool stopping = false;
+    int listen_fd = -1;
+    int wake_fd[2] = {-1, -1};          // a pipe written to by wake()
+
+    atomic<uint64_t> connections{0};
+    atomic<uint64_t> jobs{0};
+};
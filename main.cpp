@@ -14,55 +14,149 @@
 #include <cstdint>
 #include <cstdlib>
 #include <iomanip>
+#include <chrono>
 
 #include "memory.h"
+#include "elf_file.h"
 #include "hex.h"
 #include "rv32i_decode.h"
 #include "cpu_single_hart.h"
+#include "cpu_multi_hart.h"
+#include "rv32i_batch.h"
+#include "job_batch.h"
+#include "job_server.h"
+#include "disassembler.h"
+#include "trace_writer.h"
 
 using namespace std;
 
-static void disassemble(const memory &mem)
-{
-    uint32_t size = mem.get_size();
-
-    for (uint32_t addr = 0; addr < size; addr += 4)
-    {
-        uint32_t insn = mem.get32(addr);
-
-        cout
-            << hex::to_hex32(addr) << ": "
-            << hex::to_hex32(insn) << "  "
-            << rv32i_decode::decode(addr, insn)
-            << endl;
-    }
-}
-
 static void usage()
 {
-    cerr << "Usage: rv32i [-d] [-i] [-r] [-z] [-l exec_limit] [-m hex-mem-size] infile" << endl;
+    cerr << "Usage: rv32i [-d] [-f] [-i] [-r] [-k interval] [-a] [-s] [-z] [-b tracefile] [-e engine] [-l exec_limit] [-n harts] [-t threads] [-q quantum] [-v lanes] [-j manifest] [-u socket] [-w first:last] [-p lo:hi] [-m hex-mem-size] infile" << endl;
     cerr << "    -d  disassemble before simulation" << endl;
+    cerr << "    -f  with -d, show each run of 8 or more identical words (such as unwritten memory) as one line" << endl;
     cerr << "    -i  show instructions as they execute" << endl;
     cerr << "    -r  show register dump before each instruction" << endl;
+    cerr << "    -k  with -r, show only changed registers, with a full dump every interval instructions" << endl;
+    cerr << "    -a  format and write the -i, -r and -b traces on a background thread" << endl;
+    cerr << "    -s  show the simulation speed in MIPS and the disassembly cache counts after simulation (and -d)" << endl;
     cerr << "    -z  show final register and memory dump after simulation" << endl;
-    cerr << "    -l  limit the number of instructions executed (0 = no limit)" << endl;
+    cerr << "    -b  write a binary trace of every retired instruction to tracefile" << endl;
+    cerr << "    -e  execution engine: switch (default), threaded, block or jit" << endl;
+    cerr << "    -l  limit the number of instructions executed (0 = no limit), per hart with -n" << endl;
+    cerr << "    -n  run this many harts over the same memory (no tracing)" << endl;
+    cerr << "    -t  with -n, -j or -u, the number of host threads to run the harts or jobs on (default: one per core)" << endl;
+    cerr << "    -q  with -n, run the harts in turns of quantum instructions each on one thread, reproducibly" << endl;
+    cerr << "        (0 = as fast as possible; -t can't be above 1)" << endl;
+    cerr << "    -v  run this many copies of the program in lockstep, each with its own memory and its copy number in mhartid (no tracing)" << endl;
+    cerr << "        (at most " << memory::get_max_count() - 1 << ", one memory per copy besides the one infile is loaded into)" << endl;
+    cerr << "    -j  run the jobs listed in manifest (lines of: image [hex-mem-size [exec-limit]]) on -t threads" << endl;
+    cerr << "        instead of infile, and print a tab separated summary of them" << endl;
+    cerr << "    -u  instead of infile, serve jobs sent to the Unix domain socket named socket on -t threads" << endl;
+    cerr << "        until a client asks to quit (see job_server.h and tools/rv32i_client.cpp)" << endl;
+    cerr << "    -w  trace (-i, -r) only while the instruction count is in first..last-1 (last may be omitted)" << endl;
+    cerr << "    -p  trace (-i, -r) only instructions at hex addresses lo..hi-1 (may be repeated)" << endl;
     cerr << "    -m  specify memory size in hex (default = 0x100)" << endl;
+    cerr << "    infile is a flat binary image loaded at 0 or an ELF32 RISC-V executable" << endl;
     exit(1);
 }
 
+//******************************************************************************
+// This function runs copies of the program in lockstep (-v) and prints the
+// halt reason and instruction count of each copy and the totals.
+//
+// Parameters:
+//   mem        - The memory the program was loaded into.
+//   entry      - The address to start at.
+//   nlanes     - The number of copies.
+//   exec_limit - The maximum number of instructions each copy executes.
+//   show_speed - true to print the simulation speed.
+//   final_dump - true to print the registers and memory of each copy.
+//
+// Return value:
+//   None
+//******************************************************************************
+static void run_batch(const memory &mem, uint32_t entry, uint32_t nlanes, uint64_t exec_limit,
+                      bool show_speed, bool final_dump)
+{
+    rv32i_batch batch(mem, nlanes);
+    batch.set_pc(entry);
+
+    auto start_time = chrono::steady_clock::now();
+    batch.run(exec_limit);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start_time;
+
+    uint64_t total = 0;
+    uint32_t halted = 0;
+    for (uint32_t l = 0; l < nlanes; ++l)
+    {
+        if (batch.is_halted(l))
+        {
+            cout << "Lane " << l << ": Execution terminated. Reason: " << batch.get_halt_reason(l) << "\n";
+            ++halted;
+        }
+        cout << "Lane " << l << ": " << batch.get_insn_counter(l) << " instructions executed\n";
+        total += batch.get_insn_counter(l);
+    }
+    cout << halted << " of " << nlanes << " lanes halted" << "\n";
+    cout << total << " instructions executed" << endl;
+
+    if (show_speed)
+    {
+        double secs = elapsed.count();
+        double mips = secs > 0 ? total / secs / 1e6 : 0;
+        ios::fmtflags flags = cout.flags();
+        streamsize prec = cout.precision();
+        cout << fixed << setprecision(2) << mips << " MIPS (" << secs << " seconds)" << endl;
+        cout.flags(flags);
+        cout.precision(prec);
+    }
+
+    if (final_dump)
+    {
+        for (uint32_t l = 0; l < nlanes; ++l)
+        {
+            batch.dump(l, "lane " + to_string(l) + " ");
+            batch.get_memory(l).dump();
+        }
+    }
+}
+
 int main(int argc, char **argv)
 {
+    // Block buffer everything written to cout (most of all the -i and -r traces).
+    // cerr stays tied to cout, so messages on it still appear in order.
+    static char cout_buffer[1 << 20];
+    ios::sync_with_stdio(false);
+    cout.rdbuf()->pubsetbuf(cout_buffer, sizeof(cout_buffer));
+
     uint32_t memory_limit = 0x100;
     uint64_t exec_limit   = 0;
 
     bool opt_disassemble  = false;   // -d
+    bool opt_collapse     = false;   // -f
     bool opt_show_insn    = false;   // -i
     bool opt_show_regs    = false;   // -r
+    bool opt_async_trace  = false;   // -a
+    uint32_t keyframes    = 0;       // -k
+    bool opt_show_speed   = false;   // -s
     bool opt_final_dump   = false;   // -z
 
+    cpu_single_hart::engine_type engine = cpu_single_hart::engine_switch;   // -e
+    string trace_file;                                                      // -b
+    uint64_t window_first = 0;                                              // -w
+    uint64_t window_last  = UINT64_MAX;
+    vector<pair<uint32_t, uint32_t>> trace_ranges;                          // -p
+    uint32_t nharts = 1;                                                    // -n
+    uint32_t nthreads = 0;                                                  // -t
+    uint64_t quantum = 0;                                                   // -q
+    uint32_t nlanes = 0;                                                    // -v
+    string manifest;                                                        // -j
+    string socket_name;                                                     // -u
+
     int opt;
 
-    while ((opt = getopt(argc, argv, "m:dirzl:")) != -1)
+    while ((opt = getopt(argc, argv, "m:dfirk:sazl:e:b:w:p:n:t:q:v:j:u:")) != -1)
     {
         switch (opt)
         {
@@ -82,6 +176,10 @@ int main(int argc, char **argv)
                 opt_disassemble = true;
                 break;
 
+            case 'f':
+                opt_collapse = true;
+                break;
+
             case 'i':
                 opt_show_insn = true;
                 break;
@@ -90,10 +188,53 @@ int main(int argc, char **argv)
                 opt_show_regs = true;
                 break;
 
+            case 'k':
+            {
+                istringstream iss(optarg);
+                iss >> keyframes;
+                if (!iss || keyframes == 0)
+                {
+                    cerr << "Bad -k value: " << optarg << endl;
+                    usage();
+                }
+                break;
+            }
+
+            case 'a':
+                opt_async_trace = true;
+                break;
+
+            case 's':
+                opt_show_speed = true;
+                break;
+
             case 'z':
                 opt_final_dump = true;
                 break;
 
+            case 'b':
+                trace_file = optarg;
+                break;
+
+            case 'e':
+            {
+                string name = optarg;
+                if (name == "switch")
+                    engine = cpu_single_hart::engine_switch;
+                else if (name == "threaded")
+                    engine = cpu_single_hart::engine_threaded;
+                else if (name == "block")
+                    engine = cpu_single_hart::engine_block;
+                else if (name == "jit")
+                    engine = cpu_single_hart::engine_jit;
+                else
+                {
+                    cerr << "Bad -e value: " << optarg << endl;
+                    usage();
+                }
+                break;
+            }
+
             case 'l':
             {
                 istringstream iss(optarg);
@@ -106,31 +247,212 @@ int main(int argc, char **argv)
                 break;
             }
 
+            case 'n':
+            case 't':
+            case 'v':
+            {
+                istringstream iss(optarg);
+                uint32_t n;
+                iss >> n;
+                if (!iss || (opt != 't' && n == 0))
+                {
+                    cerr << "Bad -" << static_cast<char>(opt) << " value: " << optarg << endl;
+                    usage();
+                }
+                if (opt == 'v' && n > memory::get_max_count() - 1)
+                {
+                    cerr << "Too many -v lanes: " << n << " (at most " << memory::get_max_count() - 1 << ")" << endl;
+                    usage();
+                }
+                (opt == 'n' ? nharts : opt == 't' ? nthreads : nlanes) = n;
+                break;
+            }
+
+            case 'j':
+                manifest = optarg;
+                break;
+
+            case 'u':
+                socket_name = optarg;
+                break;
+
+            case 'q':
+            {
+                istringstream iss(optarg);
+                iss >> quantum;
+                if (!iss)
+                {
+                    cerr << "Bad -q value: " << optarg << endl;
+                    usage();
+                }
+                break;
+            }
+
+            case 'w':
+            {
+                istringstream iss(optarg);
+                char colon = 0;
+                iss >> window_first >> colon;
+                if (iss && colon == ':' && iss.peek() != EOF)
+                    iss >> window_last;
+                if (!iss || colon != ':' || window_last <= window_first)
+                {
+                    cerr << "Bad -w value: " << optarg << endl;
+                    usage();
+                }
+                break;
+            }
+
+            case 'p':
+            {
+                istringstream iss(optarg);
+                uint32_t lo, hi;
+                char colon = 0;
+                iss >> std::hex >> lo >> colon >> hi;
+                if (!iss || colon != ':' || hi <= lo)
+                {
+                    cerr << "Bad -p value: " << optarg << endl;
+                    usage();
+                }
+                trace_ranges.push_back({ lo, hi });
+                break;
+            }
+
             default:
                 usage();
         }
     }
 
+    if (!socket_name.empty())
+    {
+        if (opt_disassemble || opt_show_insn || opt_show_regs || opt_final_dump ||
+            !trace_file.empty() || nharts > 1 || nlanes || !manifest.empty())
+        {
+            cerr << "-u can't be used with -d, -i, -r, -z, -b, -n, -v or -j." << endl;
+            usage();
+        }
+
+        job_server server(nthreads, engine);
+        if (!server.serve(socket_name))
+            return 1;
+        if (opt_show_speed)
+            cout << server.get_stats() << endl;
+        return 0;
+    }
+
+    if (!manifest.empty())
+    {
+        if (opt_disassemble || opt_show_insn || opt_show_regs || opt_final_dump ||
+            !trace_file.empty() || nharts > 1 || nlanes)
+        {
+            cerr << "-j can't be used with -d, -i, -r, -z, -b, -n or -v." << endl;
+            usage();
+        }
+
+        job_batch batch;
+        if (!batch.load_manifest(manifest, memory_limit, exec_limit))
+            return 1;
+        batch.run(nthreads, engine);
+        batch.write_summary(cout, opt_show_speed);
+        return 0;
+    }
+
     if (optind >= argc)
         usage();
 
     const char *filename = argv[optind];
 
     memory mem(memory_limit);
-    if (!mem.load_file(filename))
+    elf_file elf;
+    if (elf_file::is_elf(filename))
+    {
+        if (!elf.load(filename, mem))
+            usage();
+    }
+    else if (!mem.load_file(filename))
         usage();
 
     if (opt_disassemble)
-        disassemble(mem);
+    {
+        disassembler dis(mem);
+        dis.set_collapse_fill(opt_collapse);
+        dis.write(cout);
+        if (opt_show_speed)
+            dis.get_render_cache().print_stats(cout);
+    }
+
+    if ((nharts > 1 || nlanes) && (opt_show_insn || opt_show_regs || !trace_file.empty()))
+    {
+        cerr << "Tracing (-i, -r, -b) is only available with a single hart." << endl;
+        usage();
+    }
+
+    if (nlanes)
+    {
+        if (nharts > 1)
+        {
+            cerr << "-v and -n can't be used together." << endl;
+            usage();
+        }
+        run_batch(mem, elf.get_entry(), nlanes, exec_limit, opt_show_speed, opt_final_dump);
+        return 0;
+    }
+
+    if (nharts > 1)
+    {
+        if (quantum && nthreads > 1)
+        {
+            cerr << "-q runs the harts on one thread, so -t can't be above 1." << endl;
+            usage();
+        }
+
+        cpu_multi_hart cpu(mem, nharts);
+        cpu.reset();
+        cpu.set_pc(elf.get_entry());
+        cpu.set_engine(engine);
+        cpu.set_threads(nthreads);
+        cpu.set_quantum(quantum);
+        cpu.set_show_speed(opt_show_speed);
+        cpu.run(exec_limit);
+
+        if (opt_final_dump)
+        {
+            cpu.dump();
+            mem.dump();
+        }
+        return 0;
+    }
 
     cpu_single_hart cpu(mem);
     cpu.reset();
+    cpu.set_pc(elf.get_entry());    // 0 for a flat binary image
     cpu.set_mhartid(0);
     cpu.set_show_instructions(opt_show_insn);
     cpu.set_show_registers(opt_show_regs);
+    cpu.set_register_keyframes(keyframes);
+    cpu.set_show_speed(opt_show_speed);
+    cpu.set_async_trace(opt_async_trace);
+    cpu.set_trace_window(window_first, window_last);
+    for (const pair<uint32_t, uint32_t> &r : trace_ranges)
+        cpu.add_trace_range(r.first, r.second);
+    cpu.set_engine(engine);
+
+    trace_writer trace;
+    if (!trace_file.empty())
+    {
+        if (!trace.open(trace_file, mem.get_size()))
+        {
+            cerr << "Can't open file '" << trace_file << "' for writing." << endl;
+            usage();
+        }
+        cpu.set_trace_sink(&trace);
+    }
 
     cpu.run(exec_limit);
 
+    if (!trace_file.empty())
+        trace.close(cpu.is_halted(), cpu.get_halt_reason(), cpu.get_insn_counter());
+
     if (opt_final_dump)
     {
         cpu.dump("");
@@ -12,16 +12,305 @@
 #include "hex.h"
 #include <iostream>
 #include <fstream>
+#include <cstring>
+#include <cstdlib>
+
+#if MEMORY_GUARD_PAGES
+#include <mutex>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 
+#if MEMORY_GUARD_PAGES
+
+// Every guarded load and store records the address of its host instruction and
+// of the code to resume at if that instruction faults. The linker gathers the
+// records of all of them into this section.
+struct fault_fixup
+{
+  const void *insn;
+  const void *resume;
+};
+
+extern "C" const fault_fixup __start_rv32i_mem_fixups[];
+extern "C" const fault_fixup __stop_rv32i_mem_fixups[];
+
+// the memories whose regions the fault handler is responsible for (each
+// reserves 4 GiB of address space, so 4096 of them take 16 TiB of the 128)
+static const size_t max_regions = 4096;
+static atomic<memory *> regions[max_regions];
+static struct sigaction previous_action;
+
 //******************************************************************************
-// Takes uint32_t siz as parameter and allocate siz bytes in the mem vector and 
-// initialize every byte/element to 0xa5. Implements rounding logic for formatting and alignment
+// This function loads a T from host address p. It compiles to a single mov and
+// reports a fault on that mov by returning false instead of crashing.
+//
+// Parameters:
+//   p - The host address to load from.
+//   v - Set to the loaded value when the load succeeds.
+//
+// Return value:
+//   true if the load succeeded, false if p is outside the memory.
+//******************************************************************************
+template<typename T>
+static inline bool guarded_load(const uint8_t *p, T &v)
+{
+  asm volatile goto("1: mov %1, %0\n\t"
+                    ".pushsection rv32i_mem_fixups, \"aw\"\n\t"
+                    ".quad 1b, %l[fault]\n\t"
+                    ".popsection"
+                    : "=r"(v)
+                    : "m"(*reinterpret_cast<const T *>(p))
+                    :
+                    : fault);
+  return true;
+fault:
+  return false;
+}
+
+//******************************************************************************
+// This function stores the T v to host address p in a single mov, reporting a
+// fault on that mov by returning false instead of crashing.
+//
+// Parameters:
+//   p - The host address to store to.
+//   v - The value to store.
+//
+// Return value:
+//   true if the store succeeded, false if p is outside the memory.
+//******************************************************************************
+template<typename T>
+static inline bool guarded_store(uint8_t *p, T v)
+{
+  asm volatile goto("1: mov %1, %0\n\t"
+                    ".pushsection rv32i_mem_fixups, \"aw\"\n\t"
+                    ".quad 1b, %l[fault]\n\t"
+                    ".popsection"
+                    : "=m"(*reinterpret_cast<T *>(p))
+                    : "r"(v)
+                    :
+                    : fault);
+  return true;
+fault:
+  return false;
+}
+
+//******************************************************************************
+// Takes uint32_t siz as parameter and reserves a 4 GiB (plus guard) region of
+// address space for it, enough for a memory of any size (see reset()). Nothing is committed yet; every page is committed and
+// filled with 0xa5 by the fault handler the first time it is accessed. The
+// region is placed so that guest address siz falls on a page boundary, which
+// makes every address past the end of the memory fault. Implements rounding
+// logic for formatting and alignment (a size within 15 bytes of 4 GiB rounds up
+// to the full 32-bit address space).
 //******************************************************************************
 memory::memory(uint32_t siz)
 {
-  siz = (siz+15)&0xfffffff0;
-  mem.resize(siz, 0xa5);
+  size = (static_cast<uint64_t>(siz) + 15) & ~static_cast<uint64_t>(15);
+
+  size_t offset = ((size + page_mask) & ~static_cast<uint64_t>(page_mask)) - size;
+  region_size = (static_cast<size_t>(1) << 32) + 2 * page_size;
+  npages = (offset + size) >> page_bits;
+
+  // the guest view and the alias are two mappings of the same (sparse) pages
+  int fd = memfd_create("rv32i memory", MFD_CLOEXEC);
+  void *p = MAP_FAILED, *a = MAP_FAILED;
+  if (fd >= 0 && ftruncate(fd, region_size) == 0)
+  {
+    p = mmap(nullptr, region_size, PROT_NONE, MAP_SHARED | MAP_NORESERVE, fd, 0);
+    a = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0);
+  }
+  if (fd >= 0)
+    close(fd);
+  if (p == MAP_FAILED || a == MAP_FAILED)
+  {
+    cerr << "Can't reserve address space for the simulated memory." << endl;
+    exit(1);
+  }
+
+  region = static_cast<uint8_t *>(p);
+  alias = static_cast<uint8_t *>(a);
+  base = region + offset;
+  state.reset(new atomic<uint8_t>[npages]());
+
+  static once_flag installed;
+  call_once(installed, []()
+  {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = fault_handler;
+    sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGSEGV, &sa, &previous_action);
+  });
+
+  size_t i = 0;
+  memory *expected = nullptr;
+  while (!regions[i].compare_exchange_strong(expected, this))
+  {
+    expected = nullptr;
+    if (++i == max_regions)
+    {
+      cerr << "Too many simulated memories." << endl;
+      exit(1);
+    }
+  }
+}
+
+//******************************************************************************
+// destructor releases the reserved region (no param)
+//******************************************************************************
+memory::~memory()
+{
+  for (size_t i = 0; i < max_regions; ++i)
+  {
+    memory *self = this;
+    if (regions[i].compare_exchange_strong(self, nullptr))
+      break;
+  }
+  munmap(region, region_size);
+  munmap(alias, region_size);
+}
+
+//******************************************************************************
+// This function empties the memory and gives it a new size, as if it had just
+// been constructed, but keeps its reserved region. Only the pages that were
+// committed are given back.
+//
+// Parameters:
+//   siz - The new size.
+//
+// Return value:
+//   None
+//******************************************************************************
+void memory::reset(uint32_t siz)
+{
+  mprotect(region, npages << page_bits, PROT_NONE);
+  madvise(alias, npages << page_bits, MADV_REMOVE);
+
+  size = (static_cast<uint64_t>(siz) + 15) & ~static_cast<uint64_t>(15);
+  size_t offset = ((size + page_mask) & ~static_cast<uint64_t>(page_mask)) - size;
+  base = region + offset;
+
+  size_t n = (offset + size) >> page_bits;
+  if (n != npages)
+  {
+    npages = n;
+    state.reset(new atomic<uint8_t>[npages]());
+  }
+  else
+  {
+    for (size_t i = 0; i < npages; ++i)
+      state[i].store(page_none);
+  }
+}
+
+//******************************************************************************
+// This function makes host page n of the region accessible. A page that has
+// never been accessed is filled with 0xa5 and left read-only until it is first
+// written, so that dump() can tell which pages hold data. The fill goes through
+// the alias while the guest view of the page is still PROT_NONE, so other
+// threads (the harts of a cpu_multi_hart) can't see the page before it is
+// filled: they fault too and wait here for its state. Faults on one page from
+// several threads at once are serialized through the page state.
+//
+// Parameters:
+//   n     - The host page to commit.
+//   write - true if the faulting access was a store.
+//
+// Return value:
+//   None
+//******************************************************************************
+void memory::commit_page(size_t n, bool write)
+{
+  uint8_t *page = region + (n << page_bits);
+  uint8_t s = page_none;
+
+  if (state[n].compare_exchange_strong(s, page_filling))
+  {
+    memset(alias + (n << page_bits), fill_byte, page_size);
+    mprotect(page, page_size, write ? PROT_READ | PROT_WRITE : PROT_READ);
+    state[n].store(write ? page_written : page_read, memory_order_release);
+    return;
+  }
+
+  while (s == page_filling)
+    s = state[n].load(memory_order_acquire);
+
+  if (write && s == page_read && state[n].compare_exchange_strong(s, page_written))
+    mprotect(page, page_size, PROT_READ | PROT_WRITE);
+}
+
+//******************************************************************************
+// This is the SIGSEGV handler. A fault inside the memory commits the page and
+// returns so that the access is retried. A fault outside the memory but inside
+// its reserved region resumes at the fixup code of the guarded access, which
+// then takes the byte path and reports the address through check_illegal().
+// Any other fault is passed on to the previous handler (or the default action).
+//
+// Parameters:
+//   sig  - The signal number.
+//   info - The faulting address.
+//   ctx  - The interrupted context, updated to resume at a fixup.
+//
+// Return value:
+//   None
+//******************************************************************************
+void memory::fault_handler(int sig, siginfo_t *info, void *ctx)
+{
+  uint8_t *addr = static_cast<uint8_t *>(info->si_addr);
+  ucontext_t *uc = static_cast<ucontext_t *>(ctx);
+
+  for (size_t i = 0; i < max_regions; ++i)
+  {
+    memory *m = regions[i].load();
+    if (!m || addr < m->region || addr >= m->region + m->region_size)
+      continue;
+
+    if (addr >= m->base && static_cast<uint64_t>(addr - m->base) < m->size)
+    {
+      bool write = uc->uc_mcontext.gregs[REG_ERR] & 2;
+      m->commit_page((addr - m->region) >> page_bits, write);
+      return;
+    }
+
+    const void *rip = reinterpret_cast<const void *>(uc->uc_mcontext.gregs[REG_RIP]);
+    for (const fault_fixup *f = __start_rv32i_mem_fixups; f < __stop_rv32i_mem_fixups; ++f)
+    {
+      if (f->insn == rip)
+      {
+        uc->uc_mcontext.gregs[REG_RIP] = reinterpret_cast<greg_t>(f->resume);
+        return;
+      }
+    }
+    break;
+  }
+
+  if (previous_action.sa_flags & SA_SIGINFO)
+    previous_action.sa_sigaction(sig, info, ctx);
+  else if (previous_action.sa_handler != SIG_DFL && previous_action.sa_handler != SIG_IGN)
+    previous_action.sa_handler(sig);
+  else
+    signal(sig, SIG_DFL);    // the faulting access is retried and kills us
+}
+
+#else
+
+//******************************************************************************
+// Takes uint32_t siz as parameter and sets up a page table for siz bytes. No page
+// is allocated yet; every byte reads as 0xa5 until its page is first written.
+// Implements rounding logic for formatting and alignment (a size within 15 bytes
+// of 4 GiB rounds up to the full 32-bit address space).
+//******************************************************************************
+memory::memory(uint32_t siz)
+{
+  size = (static_cast<uint64_t>(siz) + 15) & ~static_cast<uint64_t>(15);
+  pages.resize((size + page_size - 1) >> page_bits);
+  last_page = 0xffffffff;
+  last_data = nullptr;
 }
 
 //******************************************************************************
@@ -29,29 +318,125 @@ memory::memory(uint32_t siz)
 //******************************************************************************
 memory::~memory()
 {
-  // vector should handle cleanup automatically
+  // the page vector should handle cleanup automatically
 }
 
+//******************************************************************************
+// This function empties the memory and gives it a new size, as if it had just
+// been constructed. The pages that were written are kept aside for reuse.
+//
+// Parameters:
+//   siz - The new size.
+//
+// Return value:
+//   None
+//******************************************************************************
+void memory::reset(uint32_t siz)
+{
+  for (unique_ptr<uint8_t[]> &pg : pages)
+    if (pg)
+      spare.push_back(move(pg));
+
+  size = (static_cast<uint64_t>(siz) + 15) & ~static_cast<uint64_t>(15);
+  pages.clear();
+  pages.resize((size + page_size - 1) >> page_bits);
+  last_page = 0xffffffff;
+  last_data = nullptr;
+}
+
+//******************************************************************************
+// Takes a uint32_t (in range) address and returns the page that holds it, or
+// nullptr if that page has never been written. The most recently used page is
+// remembered so that consecutive accesses to one page skip the table lookup.
+//******************************************************************************
+const uint8_t *memory::find_page(uint32_t addr) const
+{
+  uint32_t n = addr >> page_bits;
+  if (n == last_page)
+    return last_data;
+
+  uint8_t *p = pages[n].get();
+  if (p)
+  {
+    last_page = n;
+    last_data = p;
+  }
+  return p;
+}
+
+//******************************************************************************
+// Takes a uint32_t (in range) address and returns the page that holds it for
+// writing. A page that has never been written is allocated and filled with 0xa5.
+//******************************************************************************
+uint8_t *memory::touch_page(uint32_t addr)
+{
+  uint32_t n = addr >> page_bits;
+  if (n == last_page)
+    return last_data;
+
+  unique_ptr<uint8_t[]> &pg = pages[n];
+  if (!pg)
+  {
+    if (spare.empty())
+    {
+      pg.reset(new uint8_t[page_size]);
+    }
+    else
+    {
+      pg = move(spare.back());
+      spare.pop_back();
+    }
+    memset(pg.get(), fill_byte, page_size);
+  }
+
+  last_page = n;
+  last_data = pg.get();
+  return last_data;
+}
+
+#endif
+
 //******************************************************************************
 // Takes a uint32_t address and return true if the given address i does not represent 
-// an element that is present in the mem vector
+// an element that is present in the simulated memory
 //******************************************************************************
 bool memory::check_illegal(uint32_t addr) const
 {
-  if (addr >= mem.size())
+  if (addr >= size)
     {
-        cout << "WARNING: Address out of range: " << hex::to_hex0x32(addr) << endl;
+        if (warnings)
+            *warning_out << "WARNING: Address out of range: " << hex::to_hex0x32(addr) << endl;
         return true;
     }
     return false;
 }
 
+//******************************************************************************
+// This function returns how many memories can exist at once: with
+// MEMORY_GUARD_PAGES the number of regions the fault handler keeps track of,
+// otherwise as many as the host has room for.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   The number of memories.
+//******************************************************************************
+uint32_t memory::get_max_count()
+{
+#if MEMORY_GUARD_PAGES
+  return max_regions;
+#else
+  return UINT32_MAX;
+#endif
+}
+
 //******************************************************************************
 // Return the (rounded up) number of bytes in the simulated memory (no param)
 //******************************************************************************
-uint32_t memory::get_size() const
+uint64_t memory::get_size() const
 {
-  return mem.size();
+  return size;
 }
 
 //******************************************************************************
@@ -61,18 +446,46 @@ uint32_t memory::get_size() const
 //******************************************************************************
 uint8_t memory::get8(uint32_t addr) const
 {
-  if (check_illegal(addr))
-    return 0;
-  
-  return mem[addr];
+#if MEMORY_GUARD_PAGES
+  uint8_t v;
+  if (guarded_load(base + addr, v))
+    return v;
+#else
+  if (addr < size)
+  {
+    const uint8_t *p = find_page(addr);
+    return p ? p[addr & page_mask] : fill_byte;
+  }
+#endif
+
+  check_illegal(addr);
+  return 0;
 }
 
 //******************************************************************************
-// Takes a uint32_t address as a parameter, and calls get8() function twice to get
-// two bytes and then combine them in little-endian1 order to return a 16-bit uint16_t
+// Takes a uint32_t address as a parameter and returns the two bytes at addr
+// combined in little-endian1 order as a 16-bit uint16_t. When both bytes are in
+// range and on one page this takes a single range check; otherwise it calls
+// get8() twice so that each missing byte is reported and read as zero.
 //******************************************************************************
 uint16_t memory::get16(uint32_t addr) const
 {
+#if MEMORY_GUARD_PAGES
+  uint16_t v;
+  if (guarded_load(base + addr, v))
+    return v;
+#else
+  if (addr < size && size - addr >= 2 && (addr & page_mask) <= page_size - 2)
+  {
+    const uint8_t *p = find_page(addr);
+    if (!p)
+      return (fill_byte << 8) | fill_byte;
+
+    p += addr & page_mask;
+    return p[0] | (p[1] << 8);
+  }
+#endif
+
   uint16_t lsb = get8(addr);
   uint16_t msb = get8(addr + 1);
 
@@ -80,11 +493,29 @@ uint16_t memory::get16(uint32_t addr) const
 }
 
 //******************************************************************************
-// Takes a uint32_t address as a parameter, and calls get16() function twice and combine  
-// the results in little-endian order to return a uint32_t
+// Takes a uint32_t address as a parameter and returns the four bytes at addr
+// combined in little-endian order as a uint32_t. When all four bytes are in range
+// and on one page this takes a single range check and one load; otherwise it calls
+// get16() twice so that each missing byte is reported and read as zero.
 //******************************************************************************
 uint32_t memory::get32(uint32_t addr) const 
 {
+#if MEMORY_GUARD_PAGES
+  uint32_t v;
+  if (guarded_load(base + addr, v))
+    return v;
+#else
+  if (addr < size && size - addr >= 4 && (addr & page_mask) <= page_size - 4)
+  {
+    const uint8_t *p = find_page(addr);
+    if (!p)
+      return fill_byte * 0x01010101u;
+
+    p += addr & page_mask;
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+  }
+#endif
+
   uint32_t lsb = get16(addr);
   uint32_t msb = get16(addr + 2);
   
@@ -128,105 +559,269 @@ int32_t memory::get32_sx(uint32_t addr) const
 //******************************************************************************
 void memory::set8(uint32_t addr, uint8_t val)
 {
+#if MEMORY_GUARD_PAGES
+  if (!guarded_store(base + addr, val))
+    check_illegal(addr);
+#else
   if (check_illegal(addr))
     return;
   
   else
-    mem[addr] = val;
+    touch_page(addr)[addr & page_mask] = val;
+#endif
 }
 
 //******************************************************************************
-// Takes a uint32_t address and a uint16_t value as a parameter.This function will call
-// set8() twice to store the given val in little-endian order into the
-// simulated memory starting at the address given in the addr argument. Returns nothing.
+// Takes a uint32_t address and a uint16_t value as a parameter and stores the given
+// val in little-endian order into the simulated memory starting at addr. When both
+// bytes are in range and on one page this takes a single range check; otherwise it
+// calls set8() twice so that each out of range byte is reported and discarded.
+// Returns nothing.
 //******************************************************************************
 void memory::set16(uint32_t addr, uint16_t val)
 {
+#if MEMORY_GUARD_PAGES
+  if (guarded_store(base + addr, val))
+    return;
+#else
+  if (addr < size && size - addr >= 2 && (addr & page_mask) <= page_size - 2)
+  {
+    uint8_t *p = touch_page(addr) + (addr & page_mask);
+    p[0] = val & 0xFF;
+    p[1] = (val >> 8) & 0xFF;
+    return;
+  }
+#endif
+
   set8(addr, val & 0xFF);
   set8(addr + 1, (val >> 8) & 0xFF);
 }
 
 //******************************************************************************
-// Takes a uint32_t address and a uint32_t value as a parameter. This function will call 
-// set16() twice to store the given val in little-endian order into the
-// simulated memory starting at the address given in the addr argument. Returns nothing.
+// Takes a uint32_t address and a uint32_t value as a parameter and stores the given
+// val in little-endian order into the simulated memory starting at addr. When all
+// four bytes are in range and on one page this takes a single range check and one
+// store; otherwise it calls set16() twice so that each out of range byte is
+// reported and discarded. Returns nothing.
 //******************************************************************************
 void memory::set32(uint32_t addr, uint32_t val)
 {
+#if MEMORY_GUARD_PAGES
+  if (guarded_store(base + addr, val))
+    return;
+#else
+  if (addr < size && size - addr >= 4 && (addr & page_mask) <= page_size - 4)
+  {
+    uint8_t *p = touch_page(addr) + (addr & page_mask);
+    p[0] = val & 0xFF;
+    p[1] = (val >> 8) & 0xFF;
+    p[2] = (val >> 16) & 0xFF;
+    p[3] = (val >> 24) & 0xFF;
+    return;
+  }
+#endif
+
   set16(addr, val & 0xFFFF);
   set16(addr + 2, (val >> 16) & 0xFFFF);
 }
 
 //******************************************************************************
-// Dump the entire contents of your simulated memory in hex with the corresponding ASCII2
-// characters on the right. No parameter or return.
+// Takes a uint32_t address, a source buffer and a length and copies the len bytes
+// at src into the simulated memory starting at addr. The whole range must be in
+// the memory; it is copied a page at a time rather than a byte at a time.
+// Returns nothing.
+//******************************************************************************
+void memory::write(uint32_t addr, const uint8_t *src, uint64_t len)
+{
+#if MEMORY_GUARD_PAGES
+  memcpy(base + addr, src, len);    // faults commit the pages as written
+#else
+  while (len)
+  {
+    uint64_t chunk = page_size - (addr & page_mask);
+    if (chunk > len)
+      chunk = len;
+
+    memcpy(touch_page(addr) + (addr & page_mask), src, chunk);
+    addr += chunk;
+    src += chunk;
+    len -= chunk;
+  }
+#endif
+}
+
+//******************************************************************************
+// Takes a uint32_t address, a destination buffer and a length and copies the len
+// bytes of the simulated memory starting at addr to dst, a page at a time. The
+// whole range must be in the memory. Unlike get8() and friends it never updates
+// the last page cache, so several threads may read at once. Returns nothing.
+//******************************************************************************
+void memory::read(uint32_t addr, uint8_t *dst, uint64_t len) const
+{
+#if MEMORY_GUARD_PAGES
+  memcpy(dst, base + addr, len);    // faults commit the pages as read
+#else
+  while (len)
+  {
+    uint64_t chunk = page_size - (addr & page_mask);
+    if (chunk > len)
+      chunk = len;
+
+    const uint8_t *p = pages[addr >> page_bits].get();
+    if (p)
+      memcpy(dst, p + (addr & page_mask), chunk);
+    else
+      memset(dst, fill_byte, chunk);
+    addr += chunk;
+    dst += chunk;
+    len -= chunk;
+  }
+#endif
+}
+
+//******************************************************************************
+// Takes a uint32_t address, a uint8_t value and a length and sets the len bytes of
+// the simulated memory starting at addr to val, a page at a time. The whole range
+// must be in the memory. Returns nothing.
+//******************************************************************************
+void memory::fill(uint32_t addr, uint8_t val, uint64_t len)
+{
+#if MEMORY_GUARD_PAGES
+  memset(base + addr, val, len);
+#else
+  while (len)
+  {
+    uint64_t chunk = page_size - (addr & page_mask);
+    if (chunk > len)
+      chunk = len;
+
+    memset(touch_page(addr) + (addr & page_mask), val, chunk);
+    addr += chunk;
+    len -= chunk;
+  }
+#endif
+}
+
+//******************************************************************************
+// Print one line of the memory dump: the 16 bytes at line (guest address addr)
+// in hex with the corresponding ASCII2 characters on the right.
+//******************************************************************************
+void memory::dump_line(uint32_t addr, const uint8_t *line) const
+{
+    const uint32_t bytes_per_line = 16;
+
+    cout << hex::to_hex32(addr) << ": ";
+
+    for (uint32_t j = 0; j < bytes_per_line; ++j)
+    {
+        cout << hex::to_hex8(line[j]) << " ";
+
+        if (j == 7)
+          cout << " ";
+    }
+
+    cout << "*";
+
+    for (uint32_t j = 0; j < bytes_per_line; ++j)
+    {
+        uint8_t ch = line[j];
+        ch = isprint(ch) ? ch : '.';
+        cout << static_cast<char>(ch);
+    }
+
+    cout << "*";
+    cout << endl;
+}
+
+//******************************************************************************
+// Dump the contents of your simulated memory in hex with the corresponding ASCII2
+// characters on the right. Pages that have never been written (and so still hold
+// only 0xa5) are skipped. No parameter or return.
 //******************************************************************************
 void memory::dump() const
 {
     const uint32_t bytes_per_line = 16;
 
-    for (uint32_t addr = 0; addr < mem.size(); addr += bytes_per_line)
+#if MEMORY_GUARD_PAGES
+    uint64_t offset = base - region;
+
+    for (size_t n = 0; n < npages; ++n)
     {
-        cout << hex::to_hex32(addr) << ": ";
-
-        for (uint32_t j = 0; j < bytes_per_line; ++j)
-        {
-            if (addr + j < mem.size())
-                cout << hex::to_hex8(mem[addr + j]) << " ";
-            else
-                cout << "   ";
-
-            if (j == 7)
-              cout << " ";
-        }
-
-        cout << "*";
-
-        for (uint32_t j = 0; j < bytes_per_line; ++j)
-        {
-            if (addr + j < mem.size())
-            {
-                uint8_t ch = get8(addr + j);
-                ch = isprint(ch) ? ch : '.';
-                cout << static_cast<char>(ch);
-            }
-        }
-
-        cout << "*";
-        cout << endl;
+        if (state[n].load() != page_written)
+            continue;
+
+        uint64_t start = n << page_bits;
+        uint64_t end = start + page_size;
+        start = start < offset ? 0 : start - offset;
+        end -= offset;
+
+        for (uint64_t addr = start; addr < end; addr += bytes_per_line)
+            dump_line(addr, base + addr);
     }
+#else
+    for (uint64_t n = 0; n < pages.size(); ++n)
+    {
+        const uint8_t *p = pages[n].get();
+        if (!p)
+            continue;
+
+        uint64_t base = n << page_bits;
+        uint64_t end = base + page_size < size ? base + page_size : size;
+
+        for (uint64_t addr = base; addr < end; addr += bytes_per_line)
+            dump_line(addr, p + (addr - base));
+    }
+#endif
 }
 
 //******************************************************************************
 // Open the file named fname in binary mode and read its contents into your simulated memory.
+// The whole image is read with a single bulk copy, so the memory holds a snapshot of the
+// file that later changes to it (or its truncation) can't affect. An image bigger than the
+// memory is refused.
 // Takes a string filename as its parameter and returns true if it can open and false if not.
 //******************************************************************************
 bool memory::load_file(const string &fname)
 {
-    ifstream infile(fname, ios::in | ios::binary);
+    ifstream infile(fname, ios::in | ios::binary | ios::ate);
     if (!infile)
     {
         cerr << "Can't open file '" << fname << "' for reading." << endl;
         return false;
     }
 
-    infile >> noskipws;
-    uint8_t byte = 0;
-    uint32_t addr = 0;
+    uint64_t len = static_cast<uint64_t>(infile.tellg());
+    if (len > size)
+    {
+        check_illegal(static_cast<uint32_t>(size));
+        cerr << "Program too big." << endl;
+        return false;
+    }
+
+    if (len == 0)
+        return true;
+
+    infile.seekg(0);
+
+#if MEMORY_GUARD_PAGES
+    // read() can't fault pages in, so commit them all before the copy
+    size_t last = ((base - region) + len + page_mask) >> page_bits;
+    for (size_t n = 0; n < last; ++n)
+        commit_page(n, true);
 
-    while (infile >> byte)
+    infile.read(reinterpret_cast<char *>(base), len);
+#else
+    for (uint64_t addr = 0; addr < len; addr += page_size)
     {
-        if (check_illegal(addr))
-        {
-            cerr << "Program too big." << endl;
-            infile.close();
-            return false;
-        }
-
-        mem[addr] = byte;
-        ++addr;
+        uint64_t chunk = len - addr < page_size ? len - addr : page_size;
+        infile.read(reinterpret_cast<char *>(touch_page(addr)), chunk);
     }
+#endif
 
-    infile.close();
+    if (!infile)
+    {
+        cerr << "Can't read file '" << fname << "'." << endl;
+        return false;
+    }
     return true;
-}
\ No newline at end of file
+}
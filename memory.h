@@ -10,12 +10,37 @@
 
 #pragma once
 
+#include <iostream>
 #include <vector>
+#include <memory>
+#include <atomic>
 #include "hex.h"
+
+// On x86-64 Linux with GCC or clang the memory lives in a reserved 4 GiB region
+// guarded by PROT_NONE pages, and loads and stores take no range check at all.
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) && !defined(MEMORY_GUARD_PAGES)
+#define MEMORY_GUARD_PAGES 1
+#endif
+
+#if MEMORY_GUARD_PAGES
+#include <csignal>
+#endif
+
 using namespace std;
 
 //******************************************************************************
 // Represent a memory whose size is defined at run-time via command-line argument.
+// The memory is stored as 4 KiB pages that are only allocated (and filled with
+// 0xa5) the first time they are written, so a large memory costs nothing until
+// it is used. Any size up to the full 32-bit address space can be represented.
+//
+// With MEMORY_GUARD_PAGES the pages are instead host pages of a reserved 4 GiB
+// region that starts out PROT_NONE. The first access to an in-range page faults
+// and the SIGSEGV handler commits it, while an access outside the memory faults
+// and is redirected to the byte path that reports it through check_illegal().
+// The region is a mapping of a memory file (memfd) that is mapped a second
+// time, always writable, so that a page can be filled before any thread can
+// see it through the region.
 //******************************************************************************
 
 class memory : public hex
@@ -24,8 +49,10 @@ public:
   memory(uint32_t siz);
   ~memory();
 
+  void reset(uint32_t siz);
+
   bool check_illegal(uint32_t addr) const;
-  uint32_t get_size() const;
+  uint64_t get_size() const;
   uint8_t get8(uint32_t addr) const;
   uint16_t get16(uint32_t addr) const;
   uint32_t get32(uint32_t addr) const;
@@ -38,10 +65,78 @@ public:
   void set16(uint32_t addr, uint16_t val);
   void set32(uint32_t addr, uint32_t val);
 
+  void write(uint32_t addr, const uint8_t *src, uint64_t len);
+  void read(uint32_t addr, uint8_t *dst, uint64_t len) const;
+  void fill(uint32_t addr, uint8_t val, uint64_t len);
+
   void dump() const;
 
   bool load_file(const string &fname);
 
+  static uint32_t get_max_count();
+
+  //******************************************************************************
+  // This function enables or disables the out of range warnings printed by
+  // check_illegal(). They are turned off while a background thread prints the
+  // trace, which repeats them in their place in the trace.
+  //
+  // Parameters:
+  //   b - true to print the warnings.
+  //
+  // Return value:
+  //   None
+  //******************************************************************************
+  void set_warnings(bool b) { warnings = b; }
+
+  //******************************************************************************
+  // This function sets where check_illegal() prints its warnings (cout until
+  // it is called).
+  //
+  // Parameters:
+  //   os - The stream to print to. It must outlive its use here.
+  //
+  // Return value:
+  //   None
+  //******************************************************************************
+  void set_warning_output(ostream &os) { warning_out = &os; }
+
 private:
-  vector<uint8_t> mem;
+  static constexpr uint32_t page_bits = 12;
+  static constexpr uint32_t page_size = 1u << page_bits;
+  static constexpr uint32_t page_mask = page_size - 1;
+  static constexpr uint8_t fill_byte = 0xa5;
+
+  void dump_line(uint32_t addr, const uint8_t *line) const;
+
+  uint64_t size;                          // rounded up number of bytes
+  bool warnings = true;                   // check_illegal() prints warnings
+  ostream *warning_out = &cout;           // ... to here
+
+#if MEMORY_GUARD_PAGES
+  enum page_state : uint8_t
+  {
+    page_none,                            // PROT_NONE, never accessed
+    page_filling,                         // being committed by a fault
+    page_read,                            // PROT_READ, holds only 0xa5
+    page_written                          // PROT_READ|PROT_WRITE
+  };
+
+  static void fault_handler(int sig, siginfo_t *info, void *ctx);
+  void commit_page(size_t n, bool write);
+
+  uint8_t *region;                        // start of the reserved address space
+  uint8_t *alias;                         // the same pages, always writable
+  size_t region_size;                     // bytes reserved, including guard
+  uint8_t *base;                          // host address of guest address 0
+  unique_ptr<atomic<uint8_t>[]> state;    // page_state of each host page
+  size_t npages;                          // host pages holding guest bytes
+#else
+  const uint8_t *find_page(uint32_t addr) const;
+  uint8_t *touch_page(uint32_t addr);
+
+  vector<unique_ptr<uint8_t[]>> pages;    // nullptr = never written
+  vector<unique_ptr<uint8_t[]>> spare;    // pages given back by reset()
+  mutable uint32_t last_page;             // page number of last_data
+  mutable uint8_t *last_data;             // most recently used page
+#endif
 };
\ No newline at end of file
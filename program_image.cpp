@@ -0,0 +1,136 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+
+#include "program_image.h"
+
+#include <cstring>
+#include <iostream>
+#include <istream>
+#include <streambuf>
+
+#include "elf_file.h"
+
+using namespace std;
+
+//******************************************************************************
+// A read only, seekable stream buffer over bytes that are already in memory,
+// so that elf_file can read an image without a copy of it.
+//******************************************************************************
+class byte_streambuf : public streambuf
+{
+public:
+    explicit byte_streambuf(const vector<uint8_t> &b)
+    {
+        char *p = const_cast<char *>(reinterpret_cast<const char *>(b.data()));
+        setg(p, p, p + b.size());
+    }
+
+protected:
+    pos_type seekoff(off_type off, ios::seekdir dir, ios::openmode which) override
+    {
+        off_type base = dir == ios::beg ? 0 : dir == ios::cur ? gptr() - eback() : egptr() - eback();
+        if (!(which & ios::in) || base + off < 0 || base + off > egptr() - eback())
+            return pos_type(off_type(-1));
+        setg(eback(), eback() + base + off, egptr());
+        return pos_type(base + off);
+    }
+
+    pos_type seekpos(pos_type pos, ios::openmode which) override
+    {
+        return seekoff(off_type(pos), ios::beg, which);
+    }
+};
+
+//******************************************************************************
+// This function makes an image of the bytes of an ELF executable or a flat
+// binary. Which of the two it is is told by the ELF magic number, as
+// elf_file::is_elf() tells it for a file.
+//
+// Parameters:
+//   bytes - The bytes of the image.
+//
+// Return value:
+//   None
+//******************************************************************************
+program_image::program_image(vector<uint8_t> bytes) : bytes(move(bytes))
+{
+    const vector<uint8_t> &b = this->bytes;
+    digest = hash(b);
+    elf = b.size() >= 4 && b[0] == 0x7f && b[1] == 'E' && b[2] == 'L' && b[3] == 'F';
+}
+
+//******************************************************************************
+// This function loads the image into mem the way main() loads its infile: an
+// ELF executable through elf_file, a flat binary at address 0.
+//
+// Parameters:
+//   mem   - The memory to load the image into.
+//   entry - Set to the address at which execution is to start (0 for a flat
+//           binary).
+//
+// Return value:
+//   true if the image was loaded, false (after printing why) if not.
+//******************************************************************************
+bool program_image::load(memory &mem, uint32_t &entry) const
+{
+    entry = 0;
+
+    if (elf)
+    {
+        byte_streambuf buf(bytes);
+        istream in(&buf);
+        elf_file file;
+        if (!file.load(in, "<image>", mem))
+            return false;
+        entry = file.get_entry();
+        return true;
+    }
+
+    if (bytes.size() > mem.get_size())
+    {
+        cerr << "Program too big." << endl;
+        return false;
+    }
+
+    mem.write(0, bytes.data(), bytes.size());
+    return true;
+}
+
+//******************************************************************************
+// This function computes a 64-bit hash of bytes: FNV-1a taken a word of eight
+// bytes at a time (with the high half folded in after each word), then a byte
+// at a time for the rest. It is the key of the image_cache, which compares
+// the bytes as well, so it need only spread images well.
+//
+// Parameters:
+//   bytes - The bytes to hash.
+//
+// Return value:
+//   The hash.
+//******************************************************************************
+uint64_t program_image::hash(const vector<uint8_t> &bytes)
+{
+    const uint64_t prime = 0x100000001b3;
+    uint64_t h = 0xcbf29ce484222325 ^ bytes.size();
+
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, &bytes[i], sizeof(w));
+        h = (h ^ w) * prime;
+        h ^= h >> 32;
+    }
+    for (; i < bytes.size(); ++i)
+        h = (h ^ bytes[i]) * prime;
+
+    return h;
+}
@@ -0,0 +1,63 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "memory.h"
+
+using namespace std;
+
+//******************************************************************************
+// The bytes of an image (an ELF32 executable or a flat binary) held in host
+// memory, so that it can be loaded into a memory again and again without
+// opening or reading a file. The image_cache shares one program_image between
+// all the jobs that run it.
+//******************************************************************************
+class program_image
+{
+public:
+    explicit program_image(vector<uint8_t> bytes);
+
+    bool load(memory &mem, uint32_t &entry) const;
+
+    //******************************************************************************
+    // This function returns the bytes of the image.
+    //
+    // Parameters:
+    //   None
+    //
+    // Return value:
+    //   The bytes, as they were in the file.
+    //******************************************************************************
+    const vector<uint8_t> &get_bytes() const { return bytes; }
+
+    //******************************************************************************
+    // This function returns the content hash of the image.
+    //
+    // Parameters:
+    //   None
+    //
+    // Return value:
+    //   hash(get_bytes()).
+    //******************************************************************************
+    uint64_t get_hash() const { return digest; }
+
+    static uint64_t hash(const vector<uint8_t> &bytes);
+
+private:
+    vector<uint8_t> bytes;
+    uint64_t digest;
+    bool elf;
+};
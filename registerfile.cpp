@@ -10,8 +10,6 @@
 
 #include "registerfile.h"
 #include <iostream>
-#include <iomanip>
-#include <sstream>
 
 using namespace std;
 
@@ -60,29 +58,74 @@ int32_t registerfile::get(uint32_t r) const
 // This function prints a dump of the registers
 // Parameters:
 //   hdr - a string printed at the start of each line
+//   os  - where to print it
 // Return value: none.
 //******************************************************************************
-void registerfile::dump(const string &hdr) const
+void registerfile::dump(const string &hdr, ostream &os) const
 {
     for (int row = 0; row < 4; ++row)
     {
         int base = row * 8;
 
-        ostringstream label;
-        label << "x" << base;
+        // each line is built in a buffer and written in one go
+        char line[96];
+        char *p = line;
 
-        cout << hdr
-                  << right << setw(3) << label.str() << " ";
+        // the label is right aligned in 3 columns: " x0", " x8", "x16", "x24"
+        if (base < 10)
+            *p++ = ' ';
+        *p++ = 'x';
+        if (base >= 10)
+            *p++ = '0' + base / 10;
+        *p++ = '0' + base % 10;
+        *p++ = ' ';
 
         for (int i = 0; i < 8; ++i)
         {
-            cout << hex::to_hex32(static_cast<uint32_t>(regs[base + i]));
+            p = hex::to_hex32(p, static_cast<uint32_t>(regs[base + i]));
 
             if (i == 3)
-                cout << "  ";
+            {
+                *p++ = ' ';
+                *p++ = ' ';
+            }
             else if (i != 7)
-                cout << ' ';
+                *p++ = ' ';
         }
-        cout << '\n';
+        *p++ = '\n';
+
+        os << hdr;
+        os.write(line, p - line);
+    }
+}
+
+//******************************************************************************
+// This function formats the registers whose values differ from those in last,
+// each as " xN value" with the label right aligned in 3 columns as in dump(),
+// and updates last to match.
+// Parameters:
+//   p    - where to write the text, room for 32 * 13 characters
+//   last - the values at the previous dump
+// Return value:
+//   The address after the last character written.
+//******************************************************************************
+char *registerfile::dump_changes(char *p, registerfile &last) const
+{
+    for (size_t r = 1; r < regs.size(); ++r)
+    {
+        if (regs[r] == last.regs[r])
+            continue;
+        last.regs[r] = regs[r];
+
+        *p++ = ' ';
+        if (r < 10)
+            *p++ = ' ';
+        *p++ = 'x';
+        if (r >= 10)
+            *p++ = '0' + r / 10;
+        *p++ = '0' + r % 10;
+        *p++ = ' ';
+        p = hex::to_hex32(p, static_cast<uint32_t>(regs[r]));
     }
+    return p;
 }
@@ -11,6 +11,7 @@
 #pragma once
 
 #include <cstdint>
+#include <iostream>
 #include <string>
 #include <vector>
 #include "hex.h"
@@ -30,7 +31,21 @@ public:
     void reset();
     void set(uint32_t r, int32_t val);
     int32_t get(uint32_t r) const;
-    void dump(const string &hdr) const;
+    void dump(const string &hdr, ostream &os = cout) const;
+    char *dump_changes(char *p, registerfile &last) const;
+
+    //******************************************************************************
+    // This function returns the address of the 32 register values so that an
+    // execution engine can keep working on them in place. x0 must never be
+    // written through this pointer.
+    //
+    // Parameters:
+    //   None
+    //
+    // Return value:
+    //   A pointer to x0; x1-x31 follow it.
+    //******************************************************************************
+    int32_t *data() { return regs.data(); }
 
 private:
     vector<int32_t> regs = vector<int32_t>(32);
@@ -0,0 +1,107 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "render_cache.h"
+
+#include <cstring>
+#include <iomanip>
+
+using namespace std;
+
+//******************************************************************************
+// This function writes the disassembled text of an instruction, exactly as
+// rv32i_decode::render() would, from the cache if it is there. A hit copies
+// the whole fixed size entry, which is cheaper than copying just the text.
+//
+// Parameters:
+//   buf  - A buffer of at least rv32i_decode::render_size bytes, all of which
+//          may be overwritten.
+//   addr - The address of the instruction.
+//   insn - The instruction word.
+//
+// Return value:
+//   The address after the last character written. The text is not terminated.
+//******************************************************************************
+char *render_cache::render(char *buf, uint32_t addr, uint32_t insn)
+{
+    uint32_t op = rv32i_decode::get_opcode(insn);
+    uint32_t key = (op == rv32i_decode::opcode_jal || op == rv32i_decode::opcode_btype) ? addr : 0;
+
+    if (!entries)
+    {
+        capacity = static_cast<uint64_t>(1) << bits;
+        entries.reset(new entry[capacity]);
+        for (uint64_t i = 0; i < capacity; ++i)
+            entries[i].len = 0;
+    }
+
+    uint32_t h = (insn ^ (key >> 2) * 0x9e3779b1u) * 0x9e3779b1u;
+    entry &e = entries[h >> (32 - bits)];
+
+    if (e.len && e.insn == insn && e.addr == key)
+    {
+        ++hits;
+        memcpy(buf, e.text, sizeof(e.text));
+        return buf + e.len;
+    }
+
+    ++misses;
+    char *p = rv32i_decode::render(buf, rv32i_decode::decode_insn(addr, insn));
+    if (!e.len)
+        ++used;
+    e.addr = key;
+    e.insn = insn;
+    e.len = static_cast<uint8_t>(p - buf);
+    memcpy(e.text, buf, e.len);
+    return p;
+}
+
+//******************************************************************************
+// This function adds the counts of another cache (the cache of a different
+// thread that rendered part of the same output) to this one's.
+//
+// Parameters:
+//   other - The other cache.
+//
+// Return value:
+//   None
+//******************************************************************************
+void render_cache::add_counts(const render_cache &other)
+{
+    hits += other.hits;
+    misses += other.misses;
+    used += other.used;
+    capacity += other.capacity;
+}
+
+//******************************************************************************
+// This function prints the number of lookups, the hit rate and how many entries
+// were filled, if the cache was used at all.
+//
+// Parameters:
+//   os - The stream to print to.
+//
+// Return value:
+//   None
+//******************************************************************************
+void render_cache::print_stats(ostream &os) const
+{
+    uint64_t lookups = hits + misses;
+    if (!lookups)
+        return;
+
+    ios::fmtflags flags = os.flags();
+    streamsize prec = os.precision();
+    os << "Disassembly cache: " << lookups << " lookups, " << hits << " hits ("
+       << fixed << setprecision(2) << 100.0 * hits / lookups << "%), "
+       << used << " of " << capacity << " entries used" << endl;
+    os.flags(flags);
+    os.precision(prec);
+}
@@ -0,0 +1,57 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+#include "rv32i_decode.h"
+
+using namespace std;
+
+//******************************************************************************
+// A bounded, direct-mapped cache of disassembled instruction text, so that an
+// instruction traced again and again (in a loop) or a word listed again and
+// again (unwritten memory) is only rendered once. The text of jal and the
+// branches names their target, so they are cached by address and instruction
+// word; every other instruction is cached by its word alone. A cache is not
+// thread safe: each thread that renders keeps its own.
+//******************************************************************************
+class render_cache
+{
+public:
+    static constexpr uint32_t default_bits = 12;     // 4096 entries
+
+    explicit render_cache(uint32_t bits = default_bits) : bits(bits) {}
+
+    char *render(char *buf, uint32_t addr, uint32_t insn);
+
+    void add_counts(const render_cache &other);
+    void print_stats(ostream &os) const;
+
+private:
+    struct entry
+    {
+        uint32_t addr;
+        uint32_t insn;
+        uint8_t  len;           // 0 = empty
+        char     text[rv32i_decode::render_size];
+    };
+
+    uint32_t bits;
+    unique_ptr<entry[]> entries;    // allocated by the first render()
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t used = 0;              // entries filled
+    uint64_t capacity = 0;          // entries allocated
+};
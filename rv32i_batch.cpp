@@ -0,0 +1,589 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "rv32i_batch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "hex.h"
+#include "registerfile.h"
+
+using namespace std;
+
+// Eight lanes of a register. Operations on these compile to AVX2 instructions
+// in the avx2 clone of execute() and to pairs of SSE2 instructions otherwise.
+typedef uint32_t lanes_u __attribute__((vector_size(32)));
+typedef int32_t lanes_s __attribute__((vector_size(32)));
+
+// execute() is compiled once for AVX2 and once for the baseline, and the
+// loader picks the one the host supports.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define BATCH_TARGETS __attribute__((target_clones("avx2", "default")))
+#else
+#define BATCH_TARGETS
+#endif
+
+//******************************************************************************
+// This constructor creates the lanes, each with a memory of the image's size
+// holding a copy of the image.
+//
+// Parameters:
+//   image  - The memory the program was loaded into.
+//   nlanes - The number of lanes.
+//
+// Return value:
+//   None
+//******************************************************************************
+rv32i_batch::rv32i_batch(const memory &image, uint32_t nlanes) : nlanes(nlanes)
+{
+    words = (nlanes + block_lanes - 1) / block_lanes;
+    uint64_t size = image.get_size();
+
+    for (uint32_t l = 0; l < nlanes; ++l)
+        mems.emplace_back(new memory(static_cast<uint32_t>(size)));
+
+    // a new memory already holds the 0xa5 fill, so only the rest is copied
+    uint8_t buf[4096];
+    for (uint64_t addr = 0; addr < size; addr += sizeof(buf))
+    {
+        uint64_t n = min<uint64_t>(sizeof(buf), size - addr);
+        image.read(addr, buf, n);
+        if (all_of(buf, buf + n, [](uint8_t b) { return b == 0xa5; }))
+            continue;
+        for (unique_ptr<memory> &m : mems)
+            m->write(addr, buf, n);
+    }
+
+    x.resize(32 * words);
+    mask.resize(words);
+    ids.resize(words);
+    scratch.resize(words);
+    for (uint32_t l = 0; l < words * block_lanes; ++l)
+        ids[l / block_lanes].v[l % block_lanes] = l;
+
+    pcs.resize(nlanes);
+    counts.resize(nlanes);
+    halted.resize(nlanes);
+    halt_reasons.resize(nlanes);
+    live.resize(nlanes);
+
+    uint64_t nwords = (size + 3) / 4;
+    code.resize((nwords + code_page_words - 1) / code_page_words);
+    stored.resize((nwords + 63) / 64);
+
+    reset();
+}
+
+//******************************************************************************
+// This function resets every lane: pc 0, the registers as rv32i_hart leaves
+// them, except for sp, which points at the end of memory.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_batch::reset()
+{
+    for (uint32_t r = 0; r < 32; ++r)
+        fill(reg(r), reg(r) + words * block_lanes, r ? 0xf0f0f0f0 : 0);
+    fill(reg(2), reg(2) + words * block_lanes, static_cast<uint32_t>(mems[0]->get_size()));
+
+    fill(pcs.begin(), pcs.end(), 0);
+    fill(counts.begin(), counts.end(), 0);
+    fill(halted.begin(), halted.end(), false);
+    fill(halt_reasons.begin(), halt_reasons.end(), "none");
+}
+
+//******************************************************************************
+// This function sets the address every lane starts at.
+//
+// Parameters:
+//   addr - The start address.
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_batch::set_pc(uint32_t addr)
+{
+    fill(pcs.begin(), pcs.end(), addr);
+}
+
+//******************************************************************************
+// This function runs the lanes until every one of them has halted or executed
+// exec_limit instructions.
+//
+// Parameters:
+//   exec_limit - The maximum number of instructions each lane executes (0 =
+//                no limit).
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_batch::run(uint64_t exec_limit)
+{
+    uint64_t limit = exec_limit ? exec_limit : UINT64_MAX;
+
+    for (uint32_t l = 0; l < nlanes; ++l)
+        live[l] = !halted[l];
+
+    for (tile_lo = 0; tile_lo < nlanes; tile_lo = tile_hi)
+    {
+        tile_hi = min(nlanes, tile_lo + tile_lanes);
+        while (form_group(limit))
+            run_group(limit);
+    }
+}
+
+//******************************************************************************
+// This function prints the registers and pc of one lane in the format of
+// rv32i_hart::dump().
+//
+// Parameters:
+//   lane - The lane.
+//   hdr  - A string printed at the beginning of each output line.
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_batch::dump(uint32_t lane, const string &hdr) const
+{
+    registerfile regs;
+    for (uint32_t r = 1; r < 32; ++r)
+        regs.set(r, static_cast<int32_t>(reg(r)[lane]));
+    regs.dump(hdr);
+
+    char buf[16];
+    char *p = buf;
+    *p++ = ' ';
+    *p++ = 'p';
+    *p++ = 'c';
+    *p++ = ' ';
+    p = hex::to_hex32(p, pcs[lane]);
+    *p++ = '\n';
+
+    cout << hdr;
+    cout.write(buf, p - buf);
+}
+
+//******************************************************************************
+// This function forms the group that runs next: the live lanes of the tile at
+// the lowest pc. If any lane has stored to the word at that pc, only the lanes
+// that hold the same instruction there as the first of them join.
+//
+// Parameters:
+//   limit - The instruction count each lane stops at.
+//
+// Return value:
+//   false if no lane is left to run.
+//******************************************************************************
+bool rv32i_batch::form_group(uint64_t limit)
+{
+    uint32_t nlive = 0;
+    uint32_t lo = 0;
+    for (uint32_t l = tile_lo; l < tile_hi; ++l)
+    {
+        if (live[l] && counts[l] >= limit)
+            live[l] = false;
+        if (live[l] && (!nlive++ || pcs[l] < lo))
+            lo = pcs[l];
+    }
+    if (!nlive)
+        return false;
+
+    members.clear();
+    for (uint32_t l = tile_lo; l < tile_hi; ++l)
+        if (live[l] && pcs[l] == lo)
+            members.push_back(l);
+
+    uint64_t word = lo >> 2;
+    if (word < stored.size() * 64 && (stored[word >> 6] >> (word & 63) & 1))
+    {
+        uint32_t insn = mems[members[0]]->get32(lo);
+        members.erase(remove_if(members.begin(), members.end(), [&](uint32_t l)
+            { return mems[l]->get32(lo) != insn; }), members.end());
+    }
+
+    uint32_t wlo = tile_lo / block_lanes;
+    uint32_t whi = (tile_hi + block_lanes - 1) / block_lanes;
+    memset(&mask[wlo], 0, (whi - wlo) * sizeof(lane_block));
+    group_max = 0;
+    for (uint32_t l : members)
+    {
+        mask[l / block_lanes].v[l % block_lanes] = ~0u;
+        group_max = max(group_max, counts[l]);
+    }
+
+    group_pc = lo;
+    group_steps = 0;
+    converged = members.size() == nlive;
+    return true;
+}
+
+//******************************************************************************
+// This function runs the group until it halts, splits, reaches the limit or
+// comes to a word a lane has stored to. A group that is not every live lane
+// of the tile runs only one instruction, so that the lowest pc runs next and
+// the lanes waiting at the pc the group comes to join it.
+//
+// Parameters:
+//   limit - The instruction count each lane stops at.
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_batch::run_group(uint64_t limit)
+{
+    uint64_t budget = limit - group_max;
+
+    while (group_steps < budget)
+    {
+        if (group_pc & 3)
+        {
+            halt_group("PC alignment error");
+            return;
+        }
+
+        uint64_t word = group_pc >> 2;
+        if (group_steps && word < stored.size() * 64 && (stored[word >> 6] >> (word & 63) & 1))
+            break;
+
+        const decoded_insn &d = fetch(group_pc);
+        ++group_steps;
+
+        step_result r = execute(d);
+        if (r == step_halt)
+            return;
+        if (r == step_split)
+        {
+            end_group(true);
+            return;
+        }
+        if (!converged)
+            break;
+    }
+    end_group(false);
+}
+
+//******************************************************************************
+// This function gives the lanes of the group the instructions it executed and,
+// unless they split, its pc.
+//
+// Parameters:
+//   split - true if the lanes' pcs are already set.
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_batch::end_group(bool split)
+{
+    for (uint32_t l : members)
+    {
+        counts[l] += group_steps;
+        if (!split)
+            pcs[l] = group_pc;
+    }
+}
+
+//******************************************************************************
+// This function halts every lane of the group.
+//
+// Parameters:
+//   reason - The halt reason.
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_batch::halt_group(const char *reason)
+{
+    end_group(false);
+    for (uint32_t l : members)
+    {
+        halted[l] = true;
+        halt_reasons[l] = reason;
+        live[l] = false;
+    }
+}
+
+//******************************************************************************
+// This function returns the decoded instruction at an address, decoding it
+// from the memory of the first lane of the group if it is not already.
+//
+// Parameters:
+//   addr - The address of the instruction.
+//
+// Return value:
+//   The decoded instruction, valid until the next call.
+//******************************************************************************
+const rv32i_batch::decoded_insn &rv32i_batch::fetch(uint32_t addr)
+{
+    const memory &mem = *mems[members[0]];
+    uint64_t word = addr >> 2;
+
+    if (word >= static_cast<uint64_t>(code.size()) * code_page_words)
+    {
+        fetched = decode_insn(addr, mem.get32(addr));
+        return fetched;
+    }
+
+    unique_ptr<code_slot[]> &page = code[word / code_page_words];
+    if (!page)
+        page.reset(new code_slot[code_page_words]());
+    code_slot &s = page[word % code_page_words];
+
+    if (!s.valid || (stored[word >> 6] >> (word & 63) & 1))
+    {
+        uint32_t insn = mem.get32(addr);
+        if (!s.valid || s.d.insn != insn)
+        {
+            s.d = decode_insn(addr, insn);
+            s.valid = true;
+        }
+    }
+    return s.d;
+}
+
+//******************************************************************************
+// These macros apply an instruction to the lanes of the group, eight lanes at
+// a time. In them w is the index of the eight lanes, a and b are the rows of
+// rs1 and rs2, and m is the group mask. They cover the blocks of the tile; when
+// every lane of the tile is in the group its results need not be merged with
+// the values of the lanes that are not.
+//******************************************************************************
+#define SET_RD(expr)                                                        \
+    do                                                                      \
+    {                                                                       \
+        if (d.rd == 0)                                                      \
+            break;                                                          \
+        lanes_u *out = rows(d.rd);                                          \
+        if (full)                                                           \
+            for (uint32_t w = wlo; w < whi; ++w)                            \
+                out[w] = (expr);                                            \
+        else                                                                \
+            for (uint32_t w = wlo; w < whi; ++w)                            \
+                out[w] = ((expr) & m[w]) | (out[w] & ~m[w]);                \
+    } while (0)
+
+#define BRANCH(cond)                                                        \
+    do                                                                      \
+    {                                                                       \
+        lanes_u any = {};                                                   \
+        lanes_u all = ~lanes_u{};                                           \
+        for (uint32_t w = wlo; w < whi; ++w)                                \
+        {                                                                   \
+            lanes_u t = (lanes_u)(cond) & m[w];                             \
+            taken[w] = t;                                                   \
+            any |= t;                                                       \
+            all &= t | ~m[w];                                               \
+        }                                                                   \
+        return take_branch(any, all, d.target);                             \
+    } while (0)
+
+#define LOAD(get)                                                           \
+    do                                                                      \
+    {                                                                       \
+        for (uint32_t l : members)                                          \
+        {                                                                   \
+            uint32_t v = mems[l]->get(reg(d.rs1)[l] + d.imm);               \
+            if (d.rd)                                                       \
+                reg(d.rd)[l] = v;                                           \
+        }                                                                   \
+        group_pc += 4;                                                      \
+        return step_next;                                                   \
+    } while (0)
+
+#define STORE(set, type, size)                                              \
+    do                                                                      \
+    {                                                                       \
+        for (uint32_t l : members)                                          \
+        {                                                                   \
+            uint32_t addr = reg(d.rs1)[l] + d.imm;                          \
+            mems[l]->set(addr, static_cast<type>(reg(d.rs2)[l]));           \
+            mark_stored(addr, size);                                        \
+        }                                                                   \
+        group_pc += 4;                                                      \
+        return step_next;                                                   \
+    } while (0)
+
+#define ALU(expr)                                                           \
+    do                                                                      \
+    {                                                                       \
+        SET_RD(expr);                                                       \
+        group_pc += 4;                                                      \
+        return step_next;                                                   \
+    } while (0)
+
+//******************************************************************************
+// This function executes one instruction in every lane of the group.
+//
+// Parameters:
+//   d - The decoded instruction.
+//
+// Return value:
+//   What became of the group.
+//******************************************************************************
+BATCH_TARGETS
+rv32i_batch::step_result rv32i_batch::execute(const decoded_insn &d)
+{
+    auto rows = [&](uint32_t r) { return reinterpret_cast<lanes_u *>(reg(r)); };
+
+    const lanes_u *a = rows(d.rs1);
+    const lanes_u *b = rows(d.rs2);
+    const lanes_u *m = reinterpret_cast<const lanes_u *>(mask.data());
+    lanes_u *taken = reinterpret_cast<lanes_u *>(scratch.data());
+    uint32_t wlo = tile_lo / block_lanes;
+    uint32_t whi = (tile_hi + block_lanes - 1) / block_lanes;
+    bool full = members.size() == tile_hi - tile_lo;
+
+    uint32_t imm = static_cast<uint32_t>(d.imm);
+    lanes_u k = lanes_u{} + imm;
+
+    auto mark_stored = [&](uint32_t addr, uint32_t size)
+    {
+        uint64_t first = addr >> 2;
+        uint64_t last = (static_cast<uint64_t>(addr) + size - 1) >> 2;
+        for (uint64_t w = first; w <= last && w < stored.size() * 64; ++w)
+            stored[w >> 6] |= static_cast<uint64_t>(1) << (w & 63);
+    };
+
+    // moves the group past a branch the lanes in it took (all), did not take
+    // (none of any) or disagreed on; taken holds the lanes that took it
+    auto take_branch = [&](const lanes_u &any, const lanes_u &all, uint32_t target)
+    {
+        uint32_t some = 0;
+        uint32_t every = ~0u;
+        for (uint32_t i = 0; i < block_lanes; ++i)
+        {
+            some |= any[i];
+            every &= all[i];
+        }
+
+        if (every)
+        {
+            group_pc = target;
+            return step_next;
+        }
+        if (!some)
+        {
+            group_pc += 4;
+            return step_next;
+        }
+
+        for (uint32_t l : members)
+            pcs[l] = scratch[l / block_lanes].v[l % block_lanes] ? target : group_pc + 4;
+        return step_split;
+    };
+
+    switch (d.op)
+    {
+    case op_lui:    ALU(k);
+    case op_auipc:  ALU(k + group_pc);
+
+    case op_jal:
+        SET_RD(lanes_u{} + (group_pc + 4));
+        group_pc = d.target;
+        return step_next;
+
+    case op_jalr:
+    {
+        // the targets are taken before rd is set, as rd may be rs1
+        for (uint32_t w = wlo; w < whi; ++w)
+            taken[w] = (a[w] + k) & ~1u;
+        uint32_t target = scratch[members[0] / block_lanes].v[members[0] % block_lanes];
+
+        lanes_u differ = {};
+        for (uint32_t w = wlo; w < whi; ++w)
+            differ |= (lanes_u)(taken[w] != target) & m[w];
+
+        SET_RD(lanes_u{} + (group_pc + 4));
+
+        uint32_t split = 0;
+        for (uint32_t i = 0; i < block_lanes; ++i)
+            split |= differ[i];
+        if (!split)
+        {
+            group_pc = target;
+            return step_next;
+        }
+        for (uint32_t l : members)
+            pcs[l] = scratch[l / block_lanes].v[l % block_lanes];
+        return step_split;
+    }
+
+    case op_beq:    BRANCH(a[w] == b[w]);
+    case op_bne:    BRANCH(a[w] != b[w]);
+    case op_blt:    BRANCH((lanes_s)a[w] < (lanes_s)b[w]);
+    case op_bge:    BRANCH((lanes_s)a[w] >= (lanes_s)b[w]);
+    case op_bltu:   BRANCH(a[w] < b[w]);
+    case op_bgeu:   BRANCH(a[w] >= b[w]);
+
+    case op_lb:     LOAD(get8_sx);
+    case op_lh:     LOAD(get16_sx);
+    case op_lw:     LOAD(get32_sx);
+    case op_lbu:    LOAD(get8);
+    case op_lhu:    LOAD(get16);
+
+    case op_sb:     STORE(set8, uint8_t, 1);
+    case op_sh:     STORE(set16, uint16_t, 2);
+    case op_sw:     STORE(set32, uint32_t, 4);
+
+    case op_addi:   ALU(a[w] + k);
+    case op_slti:   ALU((lanes_u)((lanes_s)a[w] < (lanes_s)k) & 1);
+    case op_sltiu:  ALU((lanes_u)(a[w] < k) & 1);
+    case op_xori:   ALU(a[w] ^ k);
+    case op_ori:    ALU(a[w] | k);
+    case op_andi:   ALU(a[w] & k);
+    case op_slli:   ALU(a[w] << (imm & 31));
+    case op_srli:   ALU(a[w] >> (imm & 31));
+    case op_srai:   ALU((lanes_u)((lanes_s)a[w] >> (imm & 31)));
+
+    case op_add:    ALU(a[w] + b[w]);
+    case op_sub:    ALU(a[w] - b[w]);
+    case op_sll:    ALU(a[w] << (b[w] & 31));
+    case op_slt:    ALU((lanes_u)((lanes_s)a[w] < (lanes_s)b[w]) & 1);
+    case op_sltu:   ALU((lanes_u)(a[w] < b[w]) & 1);
+    case op_xor:    ALU(a[w] ^ b[w]);
+    case op_srl:    ALU(a[w] >> (b[w] & 31));
+    case op_sra:    ALU((lanes_u)((lanes_s)a[w] >> (lanes_s)(b[w] & 31)));
+    case op_or:     ALU(a[w] | b[w]);
+    case op_and:    ALU(a[w] & b[w]);
+
+    case op_csrrw:
+    case op_csrrs:
+    case op_csrrc:
+    case op_csrrwi:
+    case op_csrrsi:
+    case op_csrrci:
+        if (d.csr == csr_mhartid)
+            ALU(reinterpret_cast<const lanes_u *>(ids.data())[w]);
+        ALU(lanes_u{});
+
+    case op_ecall:
+        halt_group("ECALL instruction");
+        return step_halt;
+
+    case op_ebreak:
+        halt_group("EBREAK instruction");
+        return step_halt;
+
+    default:
+        halt_group("Illegal instruction");
+        return step_halt;
+    }
+}
+
+#undef SET_RD
+#undef BRANCH
+#undef LOAD
+#undef STORE
+#undef ALU
@@ -0,0 +1,135 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rv32i_decode.h"
+#include "memory.h"
+
+using namespace std;
+
+//******************************************************************************
+// The rv32i_batch class runs many copies (lanes) of one program in lockstep,
+// in place of one rv32i_hart per copy. Every lane has a memory of its own,
+// loaded with the same image, and reads its lane number from mhartid, which
+// is how each copy finds its own input. The registers are kept lane by lane:
+// register x[k] of every lane is one contiguous row, so an ALU instruction is
+// a single pass of vector operations over three rows.
+//
+// The lanes at the lowest pc form the group that runs next; the others wait.
+// A branch or jalr that the lanes of the group disagree on splits it, and the
+// lanes run on in smaller groups until they meet again at the same pc, where
+// they merge. Loads and stores go lane by lane to each lane's own memory.
+// A lane executes the same instructions, with the same results, as an
+// rv32i_hart would on its own copy of the memory.
+//
+// The lanes run a tile of tile_lanes at a time, each tile to the end, so
+// that the registers and memory pages being worked on stay in the cache.
+//******************************************************************************
+class rv32i_batch : public rv32i_decode
+{
+public:
+    rv32i_batch(const memory &image, uint32_t nlanes);
+
+    void reset();
+    void set_pc(uint32_t addr);
+    void run(uint64_t exec_limit);
+    void dump(uint32_t lane, const string &hdr = "") const;
+
+    //******************************************************************************
+    // These functions return the number of lanes and the state of one lane.
+    //******************************************************************************
+    uint32_t get_lanes() const                      { return nlanes; }
+    bool is_halted(uint32_t lane) const             { return halted[lane]; }
+    const string &get_halt_reason(uint32_t lane) const { return halt_reasons[lane]; }
+    uint64_t get_insn_counter(uint32_t lane) const  { return counts[lane]; }
+    memory &get_memory(uint32_t lane)               { return *mems[lane]; }
+
+private:
+    static constexpr uint32_t block_lanes = 8;          // lanes per vector
+    static constexpr uint32_t tile_lanes = 64;          // lanes run together
+    static constexpr uint32_t code_page_words = 1024;   // words per decode page
+
+    //******************************************************************************
+    // The values of one register (or of the group mask) for eight lanes, aligned
+    // for a vector load.
+    //******************************************************************************
+    struct alignas(32) lane_block
+    {
+        uint32_t v[block_lanes];
+    };
+
+    //******************************************************************************
+    // What executing an instruction did to the group.
+    //******************************************************************************
+    enum step_result
+    {
+        step_next,      // every lane of the group went on to group_pc
+        step_split,     // the lanes went different ways; their pcs are in pcs[]
+        step_halt       // the lanes of the group halted
+    };
+
+    bool form_group(uint64_t limit);
+    void run_group(uint64_t limit);
+    void end_group(bool split);
+    void halt_group(const char *reason);
+    const decoded_insn &fetch(uint32_t addr);
+    step_result execute(const decoded_insn &d);
+
+    uint32_t *reg(uint32_t r)   { return x[r * words].v; }
+    const uint32_t *reg(uint32_t r) const { return x[r * words].v; }
+
+    uint32_t nlanes;
+    uint32_t words;                         // lane_blocks per row
+    vector<unique_ptr<memory>> mems;
+
+    vector<lane_block> x;                   // 32 rows of registers
+    vector<lane_block> mask;                // ~0 for the lanes in the group
+    vector<lane_block> ids;                 // the lane numbers (mhartid)
+    vector<lane_block> scratch;             // per-lane branch results
+
+    vector<uint32_t> pcs;
+    vector<uint64_t> counts;
+    vector<bool> halted;
+    vector<string> halt_reasons;
+    vector<bool> live;                      // not halted, below the limit
+
+    // THE GROUP
+
+    uint32_t tile_lo = 0;                   // the lanes of the tile
+    uint32_t tile_hi = 0;
+    vector<uint32_t> members;               // the lanes in the group
+    uint32_t group_pc = 0;
+    uint64_t group_steps = 0;               // instructions since it formed
+    uint64_t group_max = 0;                 // largest counts[] in the group
+    bool converged = false;                 // every live lane is in the group
+
+    // DECODED CODE, SHARED BY THE LANES
+
+    //******************************************************************************
+    // A decoded word. The lanes share the decoding of a word that none of them
+    // has stored to; a word any of them has stored to is checked again lane by
+    // lane when a group forms at it.
+    //******************************************************************************
+    struct code_slot
+    {
+        bool valid;
+        decoded_insn d;
+    };
+
+    vector<unique_ptr<code_slot[]>> code;
+    vector<uint64_t> stored;                // a bit per word any lane stored to
+    decoded_insn fetched;                   // a word outside the code pages
+};
@@ -9,8 +9,6 @@
 //******************************************************************************
 
 #include "rv32i_decode.h"
-#include <sstream>
-#include <iomanip>
 
 using namespace std;
 
@@ -68,13 +66,98 @@ uint32_t rv32i_decode::get_funct7(uint32_t insn)
     return (insn >> 25) & 0x7f;
 }
 
+//******************************************************************************
+// One field of an immediate: width bits starting at bit from of the instruction
+// go to bit to of the immediate.
+//******************************************************************************
+struct imm_field
+{
+    uint8_t from;
+    uint8_t width;
+    uint8_t to;
+};
+
+//******************************************************************************
+// The bit layout of an immediate, as the fields it is scattered over. An
+// immediate with a field that ends at bit 31 of the instruction is sign
+// extended from the top bit of that field.
+//******************************************************************************
+struct imm_layout
+{
+    uint8_t count;
+    imm_field fields[4];
+};
+
+static constexpr imm_layout layout_i     = { 1, {{20, 12, 0}} };
+static constexpr imm_layout layout_shamt = { 1, {{20, 5, 0}} };
+static constexpr imm_layout layout_u     = { 1, {{12, 20, 12}} };
+static constexpr imm_layout layout_s     = { 2, {{7, 5, 0}, {25, 7, 5}} };
+static constexpr imm_layout layout_b     = { 4, {{8, 4, 1}, {25, 6, 5}, {7, 1, 11}, {31, 1, 12}} };
+static constexpr imm_layout layout_j     = { 4, {{21, 10, 1}, {20, 1, 11}, {12, 8, 12}, {31, 1, 20}} };
+
+//******************************************************************************
+// Takes an immediate layout and a uint32_t instruction as its parameters and
+// gathers and (when the layout reaches bit 31) sign extends the immediate. With
+// a constant layout the loop unrolls into the usual masks and shifts.
+//******************************************************************************
+static constexpr int32_t extract_imm(const imm_layout &l, uint32_t insn)
+{
+    uint32_t imm = 0;
+    uint32_t top = 0;
+    for (uint32_t i = 0; i < l.count; ++i)
+    {
+        const imm_field &f = l.fields[i];
+        imm |= ((insn >> f.from) & ((1u << f.width) - 1)) << f.to;
+        if (f.from + f.width == 32)
+            top = f.to + f.width;
+    }
+
+    if (top && top < 32 && (insn & 0x80000000))
+        imm |= ~0u << top;
+    return static_cast<int32_t>(imm);
+}
+
+//******************************************************************************
+// Takes an immediate layout as its parameter and checks that its fields do not
+// overlap in the instruction or in the immediate and stay within 32 bits
+//******************************************************************************
+static constexpr bool layout_ok(const imm_layout &l)
+{
+    uint32_t from_bits = 0;
+    uint32_t to_bits = 0;
+    for (uint32_t i = 0; i < l.count; ++i)
+    {
+        const imm_field &f = l.fields[i];
+        if (f.width == 0 || f.from + f.width > 32 || f.to + f.width > 32)
+            return false;
+
+        uint32_t m = (1u << f.width) - 1;
+        if ((from_bits & (m << f.from)) || (to_bits & (m << f.to)))
+            return false;
+        from_bits |= m << f.from;
+        to_bits |= m << f.to;
+    }
+    return true;
+}
+
+static_assert(layout_ok(layout_i) && layout_ok(layout_shamt) && layout_ok(layout_u) &&
+              layout_ok(layout_s) && layout_ok(layout_b) && layout_ok(layout_j),
+              "overlapping immediate fields");
+static_assert(extract_imm(layout_i, 0xfff00093) == -1, "imm_i");           // addi x1,x0,-1
+static_assert(extract_imm(layout_u, 0x123450b7) == 0x12345000, "imm_u");   // lui x1,0x12345
+static_assert(extract_imm(layout_s, 0xfe112e23) == -4, "imm_s");           // sw x1,-4(x2)
+static_assert(extract_imm(layout_b, 0xfe208ee3) == -4, "imm_b");           // beq x1,x2,.-4
+static_assert(extract_imm(layout_b, 0x7e208fe3) == 4094, "imm_b");
+static_assert(extract_imm(layout_j, 0xffdff0ef) == -4, "imm_j");           // jal x1,.-4
+static_assert(extract_imm(layout_j, 0x7ffff0ef) == 0xffffe, "imm_j");
+
 //******************************************************************************
 // Takes a uint32_t instruction as its parameter and extracts and returns the imm_i field
 // from the given instruction as a 32-bit signed integer as shown in RVALP.
 //******************************************************************************
 int32_t rv32i_decode::get_imm_i(uint32_t insn)
 {
-    return static_cast<int32_t>(insn) >> 20;
+    return extract_imm(layout_i, insn);
 }
 
 //******************************************************************************
@@ -83,7 +166,7 @@ int32_t rv32i_decode::get_imm_i(uint32_t insn)
 //******************************************************************************
 int32_t rv32i_decode::get_imm_u(uint32_t insn)
 {
-    return static_cast<int32_t>(insn & 0xfffff000);
+    return extract_imm(layout_u, insn);
 }
 
 //******************************************************************************
@@ -92,12 +175,7 @@ int32_t rv32i_decode::get_imm_u(uint32_t insn)
 //******************************************************************************
 int32_t rv32i_decode::get_imm_s(uint32_t insn)
 {
-    int32_t imm_s = (insn & 0xfe000000) >> (25 - 5);
-    imm_s |= (insn & 0x00000f80) >> (7 - 0);
-
-    if (insn & 0x80000000)
-        imm_s |= 0xfffff000;
-    return imm_s;
+    return extract_imm(layout_s, insn);
 }
 
 //******************************************************************************
@@ -106,15 +184,7 @@ int32_t rv32i_decode::get_imm_s(uint32_t insn)
 //******************************************************************************
 int32_t rv32i_decode::get_imm_b(uint32_t insn)
 {
-    int32_t imm_b = 0;
-    imm_b |= (insn & 0x80000000) >> (31 - 12);
-    imm_b |= (insn & 0x00000080) << (11 - 7);
-    imm_b |= (insn & 0x7e000000) >> (25 - 5);
-    imm_b |= (insn & 0x00000f00) >> (8 - 1);
-
-    if (insn & 0x80000000)
-        imm_b |= 0xffffe000;
-    return imm_b;
+    return extract_imm(layout_b, insn);
 }
 
 //******************************************************************************
@@ -123,435 +193,402 @@ int32_t rv32i_decode::get_imm_b(uint32_t insn)
 //******************************************************************************
 int32_t rv32i_decode::get_imm_j(uint32_t insn)
 {
-    int32_t imm_j = 0;
-    imm_j |= (insn & 0x80000000) >> (31 - 20);
-    imm_j |= (insn & 0x000ff000);
-    imm_j |= (insn & 0x00100000) >> (20 - 11);
-    imm_j |= (insn & 0x7fe00000) >> (21 - 1); 
-    if (insn & 0x80000000)
-        imm_j |= 0xffe00000;
-    return imm_j;
+    return extract_imm(layout_j, insn);
 }
 
 //******************************************************************************
-// Takes an integer of register r as its parameter and returns a string with the name
-// of that register
+// The description of one operation: its mnemonic, operand format, immediate
+// layout (nullptr for none) and the bits that identify it, as a mask and the
+// value the masked instruction must have.
 //******************************************************************************
-string rv32i_decode::render_reg(int r)
+struct insn_desc
+{
+    rv32i_decode::insn_op op;
+    const char *mnemonic;
+    rv32i_decode::insn_format format;
+    const imm_layout *imm;
+    uint32_t mask;
+    uint32_t match;
+};
+
+//******************************************************************************
+// Takes the fields of an instruction description and the opcode, funct3 and
+// funct7 that identify it (-1 where the field is part of an operand) as its
+// parameters and returns the description
+//******************************************************************************
+static constexpr insn_desc describe(rv32i_decode::insn_op op, const char *mnemonic,
+                                    rv32i_decode::insn_format format, const imm_layout *imm,
+                                    uint32_t opcode, int funct3 = -1, int funct7 = -1)
 {
-    return "x" + to_string(r);
+    uint32_t mask = 0x7f;
+    uint32_t match = opcode;
+    if (funct3 >= 0)
+    {
+        mask |= 0x7 << 12;
+        match |= static_cast<uint32_t>(funct3) << 12;
+    }
+    if (funct7 >= 0)
+    {
+        mask |= 0x7fu << 25;
+        match |= static_cast<uint32_t>(funct7) << 25;
+    }
+    return { op, mnemonic, format, imm, mask, match };
 }
 
 //******************************************************************************
-// Takes an uint32_t of register and int32_t immediate as its parameter and returns 
-// a string representing the operands of the form imm(register)
+// Takes the fields of an instruction description and the one instruction word
+// that encodes it as its parameters and returns the description
 //******************************************************************************
-string rv32i_decode::render_base_disp(uint32_t reg, int32_t imm)
+static constexpr insn_desc describe_exact(rv32i_decode::insn_op op, const char *mnemonic, uint32_t insn)
 {
-    ostringstream os;
-    os << imm << "(" << render_reg(reg) << ")";
-    return os.str();
+    return { op, mnemonic, rv32i_decode::fmt_none, nullptr, 0xffffffff, insn };
 }
 
+using dec = rv32i_decode;
+
 //******************************************************************************
-// Takes a string of the instruction mnemonic and returns a string of the mnemonic
-// with appropriate space padding
+// Every RV32I operation the simulator implements, indexed by insn_op. The
+// illegal entry matches anything and is what an unlisted encoding decodes to.
 //******************************************************************************
-string rv32i_decode::render_mnemonic(const string &mnemonic)
+static constexpr insn_desc descs[] =
 {
-    if (mnemonic == "ecall" || mnemonic == "ebreak")
-        return mnemonic;
-
-    ostringstream os;
-    os << left << setw(mnemonic_width) << mnemonic;
-    return os.str();
+    { dec::op_illegal, "ERROR: UNIMPLEMENTED INSTRUCTION", dec::fmt_none, nullptr, 0, 0 },
+
+    describe(dec::op_lui,    "lui",    dec::fmt_u,         &layout_u, dec::opcode_lui),
+    describe(dec::op_auipc,  "auipc",  dec::fmt_u,         &layout_u, dec::opcode_auipc),
+    describe(dec::op_jal,    "jal",    dec::fmt_j,         &layout_j, dec::opcode_jal),
+    describe(dec::op_jalr,   "jalr",   dec::fmt_base_disp, &layout_i, dec::opcode_jalr),
+
+    describe(dec::op_beq,    "beq",    dec::fmt_b, &layout_b, dec::opcode_btype, dec::funct3_beq),
+    describe(dec::op_bne,    "bne",    dec::fmt_b, &layout_b, dec::opcode_btype, dec::funct3_bne),
+    describe(dec::op_blt,    "blt",    dec::fmt_b, &layout_b, dec::opcode_btype, dec::funct3_blt),
+    describe(dec::op_bge,    "bge",    dec::fmt_b, &layout_b, dec::opcode_btype, dec::funct3_bge),
+    describe(dec::op_bltu,   "bltu",   dec::fmt_b, &layout_b, dec::opcode_btype, dec::funct3_bltu),
+    describe(dec::op_bgeu,   "bgeu",   dec::fmt_b, &layout_b, dec::opcode_btype, dec::funct3_bgeu),
+
+    describe(dec::op_lb,     "lb",     dec::fmt_base_disp, &layout_i, dec::opcode_load, dec::funct3_lb),
+    describe(dec::op_lh,     "lh",     dec::fmt_base_disp, &layout_i, dec::opcode_load, dec::funct3_lh),
+    describe(dec::op_lw,     "lw",     dec::fmt_base_disp, &layout_i, dec::opcode_load, dec::funct3_lw),
+    describe(dec::op_lbu,    "lbu",    dec::fmt_base_disp, &layout_i, dec::opcode_load, dec::funct3_lbu),
+    describe(dec::op_lhu,    "lhu",    dec::fmt_base_disp, &layout_i, dec::opcode_load, dec::funct3_lhu),
+
+    describe(dec::op_sb,     "sb",     dec::fmt_s, &layout_s, dec::opcode_store, dec::funct3_sb),
+    describe(dec::op_sh,     "sh",     dec::fmt_s, &layout_s, dec::opcode_store, dec::funct3_sh),
+    describe(dec::op_sw,     "sw",     dec::fmt_s, &layout_s, dec::opcode_store, dec::funct3_sw),
+
+    describe(dec::op_addi,   "addi",   dec::fmt_i, &layout_i,     dec::opcode_alu_imm, dec::funct3_add_sub),
+    describe(dec::op_slti,   "slti",   dec::fmt_i, &layout_i,     dec::opcode_alu_imm, dec::funct3_slt),
+    describe(dec::op_sltiu,  "sltiu",  dec::fmt_i, &layout_i,     dec::opcode_alu_imm, dec::funct3_sltu),
+    describe(dec::op_xori,   "xori",   dec::fmt_i, &layout_i,     dec::opcode_alu_imm, dec::funct3_xor),
+    describe(dec::op_ori,    "ori",    dec::fmt_i, &layout_i,     dec::opcode_alu_imm, dec::funct3_or),
+    describe(dec::op_andi,   "andi",   dec::fmt_i, &layout_i,     dec::opcode_alu_imm, dec::funct3_and),
+    describe(dec::op_slli,   "slli",   dec::fmt_i, &layout_shamt, dec::opcode_alu_imm, dec::funct3_sll),
+    describe(dec::op_srli,   "srli",   dec::fmt_i, &layout_shamt, dec::opcode_alu_imm, dec::funct3_srl_sra, dec::funct7_srl),
+    describe(dec::op_srai,   "srai",   dec::fmt_i, &layout_shamt, dec::opcode_alu_imm, dec::funct3_srl_sra, dec::funct7_sra),
+
+    describe(dec::op_add,    "add",    dec::fmt_r, nullptr, dec::opcode_alu_reg, dec::funct3_add_sub, dec::funct7_add),
+    describe(dec::op_sub,    "sub",    dec::fmt_r, nullptr, dec::opcode_alu_reg, dec::funct3_add_sub, dec::funct7_sub),
+    describe(dec::op_sll,    "sll",    dec::fmt_r, nullptr, dec::opcode_alu_reg, dec::funct3_sll,     dec::funct7_add),
+    describe(dec::op_slt,    "slt",    dec::fmt_r, nullptr, dec::opcode_alu_reg, dec::funct3_slt,     dec::funct7_add),
+    describe(dec::op_sltu,   "sltu",   dec::fmt_r, nullptr, dec::opcode_alu_reg, dec::funct3_sltu,    dec::funct7_add),
+    describe(dec::op_xor,    "xor",    dec::fmt_r, nullptr, dec::opcode_alu_reg, dec::funct3_xor,     dec::funct7_add),
+    describe(dec::op_srl,    "srl",    dec::fmt_r, nullptr, dec::opcode_alu_reg, dec::funct3_srl_sra, dec::funct7_srl),
+    describe(dec::op_sra,    "sra",    dec::fmt_r, nullptr, dec::opcode_alu_reg, dec::funct3_srl_sra, dec::funct7_sra),
+    describe(dec::op_or,     "or",     dec::fmt_r, nullptr, dec::opcode_alu_reg, dec::funct3_or,      dec::funct7_add),
+    describe(dec::op_and,    "and",    dec::fmt_r, nullptr, dec::opcode_alu_reg, dec::funct3_and,     dec::funct7_add),
+
+    describe_exact(dec::op_ecall,  "ecall",  0x00000073),
+    describe_exact(dec::op_ebreak, "ebreak", 0x00100073),
+
+    describe(dec::op_csrrw,  "csrrw",  dec::fmt_csr,  &layout_i, dec::opcode_system, dec::funct3_csrrw),
+    describe(dec::op_csrrs,  "csrrs",  dec::fmt_csr,  &layout_i, dec::opcode_system, dec::funct3_csrrs),
+    describe(dec::op_csrrc,  "csrrc",  dec::fmt_csr,  &layout_i, dec::opcode_system, dec::funct3_csrrc),
+    describe(dec::op_csrrwi, "csrrwi", dec::fmt_csri, &layout_i, dec::opcode_system, dec::funct3_csrrwi),
+    describe(dec::op_csrrsi, "csrrsi", dec::fmt_csri, &layout_i, dec::opcode_system, dec::funct3_csrrsi),
+    describe(dec::op_csrrci, "csrrci", dec::fmt_csri, &layout_i, dec::opcode_system, dec::funct3_csrrci),
+};
+
+static constexpr uint32_t desc_count = sizeof(descs) / sizeof(descs[0]);
+
+//******************************************************************************
+// The flat decode lookup. An instruction's slot is its opcode, funct3 and the
+// class of its funct7 (0b0000000, 0b0100000 or anything else); the slot holds
+// the first description that can match it. The few descriptions that share a
+// slot (ecall and ebreak) follow each other in descs and are told apart by
+// their full mask and match.
+//******************************************************************************
+static constexpr uint32_t slot_bits = 0xfe00707f;
+static constexpr uint32_t slot_count = 3 << 10;
+
+static constexpr uint32_t slot_of(uint32_t insn)
+{
+    uint32_t funct7 = insn >> 25;
+    uint32_t funct7_class = (funct7 & ~rv32i_decode::funct7_sub) ? 2 : funct7 >> 5;
+    return (insn & 0x7f) | ((insn >> 5) & 0x380) | (funct7_class << 10);
 }
 
 //******************************************************************************
-// No parameters, returns a string if the instruction is illegal
+// Takes a description and a uint32_t instruction as its parameters and returns
+// true if the description matches the instruction's slot bits
 //******************************************************************************
-string rv32i_decode::render_illegal_insn()
+static constexpr bool in_slot(const insn_desc &desc, uint32_t insn)
 {
-    return "ERROR: UNIMPLEMENTED INSTRUCTION";
+    return ((insn ^ desc.match) & desc.mask & slot_bits) == 0;
 }
 
 //******************************************************************************
-// Takes a uint32_t instruction as its parameter and formats a LUI instruction by extracting
-// its destination register and 20-bit immediate, then returning the correctly formatted 
-// assembly string
+// Takes a slot as its parameter and returns an instruction word in that slot
 //******************************************************************************
-string rv32i_decode::render_lui(uint32_t insn)
+static constexpr uint32_t slot_insn(uint32_t slot)
 {
-    uint32_t rd = get_rd(insn);
-    int32_t imm_u = get_imm_u(insn);
-    uint32_t imm20 = static_cast<uint32_t>(imm_u) >> 12;
-
-    ostringstream os;
-    os << render_mnemonic("lui") << render_reg(rd) << ","
-       << hex::to_hex0x20(imm20);
-    return os.str();
+    constexpr uint32_t funct7_of_class[3] = { rv32i_decode::funct7_add, rv32i_decode::funct7_sub, 0x01 };
+    return (slot & 0x7f) | ((slot & 0x380) << 5) | (funct7_of_class[slot >> 10] << 25);
 }
 
-//******************************************************************************
-// Takes a uint32_t instruction as its parameter and formats a AUIPC instruction by extracting
-// its destination register and 20-bit immediate, then returning the correctly formatted 
-// assembly string
-//******************************************************************************
-string rv32i_decode::render_auipc(uint32_t insn)
+struct decode_lookup
 {
-    uint32_t rd = get_rd(insn);
-    int32_t imm_u = get_imm_u(insn);
-    uint32_t imm20 = static_cast<uint32_t>(imm_u) >> 12;
-
-    ostringstream os;
-    os << render_mnemonic("auipc") << render_reg(rd) << ","
-       << hex::to_hex0x20(imm20);
-    return os.str();
-}
+    uint8_t slot[slot_count];
+};
 
 //******************************************************************************
-// Takes a uint32_t instruction and a uint32_t address as its parameter and formats a 
-// JAL instruction by extracting its destination register and offset, 
-// finding the target address, and returning the correctly formatted assembly string
+// Builds the decode lookup from descs: each slot gets the first description
+// (other than illegal) whose slot bits agree with it, or illegal
 //******************************************************************************
-string rv32i_decode::render_jal(uint32_t addr, uint32_t insn)
+static constexpr decode_lookup build_lookup()
 {
-    uint32_t rd = get_rd(insn);
-    int32_t imm_j = get_imm_j(insn);
-    uint32_t target = addr + imm_j;
-
-    ostringstream os;
-    os << render_mnemonic("jal")
-       << render_reg(rd) << ","
-       << hex::to_hex0x32(target);
-    return os.str();
+    decode_lookup t = {};
+    for (uint32_t s = 0; s < slot_count; ++s)
+    {
+        for (uint32_t i = 1; i < desc_count; ++i)
+        {
+            if (in_slot(descs[i], slot_insn(s)))
+            {
+                t.slot[s] = i;
+                break;
+            }
+        }
+    }
+    return t;
 }
 
+static constexpr decode_lookup lookup = build_lookup();
+
 //******************************************************************************
-// Takes a uint32_t instruction as its parameter and formats a JALR instruction by extracting
-// its destination register, base register, and immediate offset, then returning 
-// the properly formatted assembly string
+// Takes a uint32_t instruction as its parameter and returns the operation it
+// encodes, or op_illegal: the slot's first description, or a following one in
+// the same slot, whose mask and match fit the whole instruction
 //******************************************************************************
-string rv32i_decode::render_jalr(uint32_t insn)
+static constexpr rv32i_decode::insn_op find_op(uint32_t insn)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-    int32_t imm_i = get_imm_i(insn);
-
-    ostringstream os;
-    os << render_mnemonic("jalr")
-       << render_reg(rd) << ","
-       << render_base_disp(rs1, imm_i);
-    return os.str();
+    uint32_t i = lookup.slot[slot_of(insn)];
+    while ((insn & descs[i].mask) != descs[i].match)
+    {
+        if (++i == desc_count || !in_slot(descs[i], insn))
+            return rv32i_decode::op_illegal;
+    }
+    return descs[i].op;
 }
 
 //******************************************************************************
-// Takes a uint32_t instruction, uint32_t address, and char mnemonic pointer as its 
-// parameter and formats a branch instruction by extracting its two source registers 
-// and branch offset, finding the target address, and returning the correctly formatted
-// assembly string
+// Takes nothing and checks the description table: it lists each operation once
+// in insn_op order, identifies operations only by the funct7 values the slots
+// distinguish, and every slot's descriptions follow each other in descs
 //******************************************************************************
-string rv32i_decode::render_btype(uint32_t addr, uint32_t insn, const char *mnemonic)
+static constexpr bool descs_ok()
 {
-    uint32_t rs1 = get_rs1(insn);
-    uint32_t rs2 = get_rs2(insn);
-    int32_t imm_b = get_imm_b(insn);
-    uint32_t target = addr + imm_b;
+    if (desc_count != rv32i_decode::op_count)
+        return false;
 
-    ostringstream os;
-    os << render_mnemonic(mnemonic)
-       << render_reg(rs1) << ","
-       << render_reg(rs2) << ","
-       << hex::to_hex0x32(target);
-    return os.str();
+    for (uint32_t i = 0; i < desc_count; ++i)
+    {
+        if (descs[i].op != i || (descs[i].match & ~descs[i].mask))
+            return false;
+        uint32_t funct7 = descs[i].match >> 25;
+        if ((descs[i].mask & 0xfe000000) == 0xfe000000 && descs[i].mask != 0xffffffff &&
+            funct7 != rv32i_decode::funct7_add && funct7 != rv32i_decode::funct7_sub)
+            return false;
+    }
+
+    for (uint32_t s = 0; s < slot_count; ++s)
+    {
+        uint32_t i = lookup.slot[s];
+        if (i == 0)
+            continue;
+        while (i < desc_count && in_slot(descs[i], slot_insn(s)))
+            ++i;
+        for (; i < desc_count; ++i)
+            if (in_slot(descs[i], slot_insn(s)))
+                return false;
+    }
+    return true;
 }
 
+static_assert(descs_ok(), "inconsistent instruction description table");
+static_assert(find_op(0x00000073) == rv32i_decode::op_ecall, "ecall");
+static_assert(find_op(0x00100073) == rv32i_decode::op_ebreak, "ebreak");
+static_assert(find_op(0x00200073) == rv32i_decode::op_illegal, "system");
+static_assert(find_op(0x40208033) == rv32i_decode::op_sub, "sub");
+static_assert(find_op(0x02208033) == rv32i_decode::op_illegal, "mul");
+static_assert(find_op(0x4020d093) == rv32i_decode::op_srai, "srai");
+static_assert(find_op(0x00000000) == rv32i_decode::op_illegal, "zero");
+static_assert(find_op(0x340110f3) == rv32i_decode::op_csrrw, "csrrw");
+
 //******************************************************************************
-// Takes a uint32_t instruction and char mnemonic pointer as its parameter and
-// formats an I-type load instruction by extracting its destination register, base register,
-// and immediate offset, then returning the properly formatted assembly
+// Takes a uint32_t instruction as its parameter and returns the operation it
+// encodes, or op_illegal, from the decode lookup
 //******************************************************************************
-string rv32i_decode::render_itype_load(uint32_t insn, const char *mnemonic)
+rv32i_decode::insn_op rv32i_decode::decode_op(uint32_t insn)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-    int32_t imm_i = get_imm_i(insn);
-
-    ostringstream os;
-    os << render_mnemonic(mnemonic)
-       << render_reg(rd) << ","
-       << render_base_disp(rs1, imm_i);
-    return os.str();
+    return find_op(insn);
 }
 
 //******************************************************************************
-// Takes a uint32_t instruction and char mnemonic pointer as its parameter and
-// formats an S-type store instruction by extracting its source register, base register,
-// and offset, then returning the correctly formatted assembly string
+// Takes a uint32_t address and uint32_t instruction as its parameters and takes
+// the instruction apart into its operation, operand layout, registers,
+// sign-extended immediate and (for jal and branches) target address. Nothing
+// is allocated, so the interpreter can use it for every instruction it decodes.
 //******************************************************************************
-string rv32i_decode::render_stype(uint32_t insn, const char *mnemonic)
+rv32i_decode::decoded_insn rv32i_decode::decode_insn(uint32_t addr, uint32_t insn)
 {
-    uint32_t rs1 = get_rs1(insn);
-    uint32_t rs2 = get_rs2(insn);
-    int32_t imm_s = get_imm_s(insn);
-
-    ostringstream os;
-    os << render_mnemonic(mnemonic)
-       << render_reg(rs2) << ","
-       << render_base_disp(rs1, imm_s);
-    return os.str();
+    const insn_desc &desc = descs[decode_op(insn)];
+
+    decoded_insn d;
+    d.insn   = insn;
+    d.op     = desc.op;
+    d.format = desc.format;
+    d.rd     = get_rd(insn);
+    d.rs1    = get_rs1(insn);
+    d.rs2    = get_rs2(insn);
+    d.csr    = (insn >> 20) & 0xfff;
+    d.imm    = desc.imm ? extract_imm(*desc.imm, insn) : 0;
+    d.target = (desc.format == fmt_j || desc.format == fmt_b) ? addr + d.imm : 0;
+    return d;
 }
 
 //******************************************************************************
-// Takes a uint32_t instruction and char mnemonic pointer, as well as
-// a int32_t immediate as its parameter and formats an I-type ALU instruction by 
-// extracting its destination register, source register, and immediate value, then 
-// returning the correctly formatted assembly string
+// These functions write a register name ("x" and its number) or a signed
+// decimal number at p and return the address after the last character
 //******************************************************************************
-string rv32i_decode::render_itype_alu(uint32_t insn, const char *mnemonic, int32_t imm_i)
+char *rv32i_decode::render_reg(char *p, uint32_t r)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-
-    ostringstream os;
-    os << render_mnemonic(mnemonic)
-       << render_reg(rd) << ","
-       << render_reg(rs1) << ","
-       << imm_i;
-    return os.str();
+    *p++ = 'x';
+    if (r >= 10)
+        *p++ = '0' + r / 10;
+    *p++ = '0' + r % 10;
+    return p;
 }
 
-//******************************************************************************
-// Takes a uint32_t instruction and char mnemonic pointer as its parameter and
-// formats an R-type ALU instruction by extracting its destination register and two 
-// source registers, then returning the correctly formatted assembly string
-//******************************************************************************
-string rv32i_decode::render_rtype(uint32_t insn, const char *mnemonic)
+char *rv32i_decode::render_dec(char *p, int32_t v)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-    uint32_t rs2 = get_rs2(insn);
+    uint32_t u = static_cast<uint32_t>(v);
+    if (v < 0)
+    {
+        *p++ = '-';
+        u = 0 - u;
+    }
+
+    char digits[10];
+    int n = 0;
+    do
+    {
+        digits[n++] = '0' + u % 10;
+        u /= 10;
+    } while (u);
 
-    ostringstream os;
-    os << render_mnemonic(mnemonic)
-       << render_reg(rd) << ","
-       << render_reg(rs1) << ","
-       << render_reg(rs2);
-    return os.str();
+    while (n)
+        *p++ = digits[--n];
+    return p;
 }
 
 //******************************************************************************
-// Takes a uint32_t instruction as its parameter and formats system instructions by
-// using the funct3 and CSR fields, extracting the registers or immediate values, and 
-// returning the correctly formatted assembly string
+// Takes a char buffer of at least render_size bytes and a decoded instruction
+// as its parameters, writes the disassembled instruction text (the mnemonic
+// padded to mnemonic_width, then its operands) into the buffer and returns the
+// address after the last character. The text is not terminated.
 //******************************************************************************
-string rv32i_decode::render_system(uint32_t insn)
+char *rv32i_decode::render(char *buf, const decoded_insn &d)
 {
-    uint32_t funct3 = get_funct3(insn);
+    char *p = buf;
+    for (const char *m = descs[d.op].mnemonic; *m; ++m)
+        *p++ = *m;
 
-    if (funct3 == 0)
-    {
-        if (insn == 0x00000073)
-            return "ecall";
-        else if (insn == 0x00100073)
-            return "ebreak";
-        else
-            return render_illegal_insn();
-    }
-
-    uint32_t rd   = get_rd(insn);
-    uint32_t rs1  = get_rs1(insn);
-    uint32_t zimm = rs1;
-    uint32_t csr  = (insn >> 20) & 0xfff;
+    if (d.format == fmt_none)
+        return p;
 
-    ostringstream os;
+    while (p < buf + mnemonic_width)
+        *p++ = ' ';
 
-    switch (funct3)
+    switch (d.format)
     {
-        case funct3_csrrw:
-            os << render_mnemonic("csrrw")
-               << render_reg(rd) << ","
-               << hex::to_hex0x12(csr) << ","
-               << render_reg(rs1);
+        case fmt_u:
+            p = render_reg(p, d.rd);
+            *p++ = ',';
+            p = hex::to_hex0x20(p, static_cast<uint32_t>(d.imm) >> 12);
+            break;
+
+        case fmt_j:
+            p = render_reg(p, d.rd);
+            *p++ = ',';
+            p = hex::to_hex0x32(p, d.target);
             break;
-        case funct3_csrrs:
-            os << render_mnemonic("csrrs")
-               << render_reg(rd) << ","
-               << hex::to_hex0x12(csr) << ","
-               << render_reg(rs1);
+
+        case fmt_base_disp:
+        case fmt_s:
+            p = render_reg(p, d.format == fmt_s ? d.rs2 : d.rd);
+            *p++ = ',';
+            p = render_dec(p, d.imm);
+            *p++ = '(';
+            p = render_reg(p, d.rs1);
+            *p++ = ')';
             break;
-        case funct3_csrrc:
-            os << render_mnemonic("csrrc")
-               << render_reg(rd) << ","
-               << hex::to_hex0x12(csr) << ","
-               << render_reg(rs1);
+
+        case fmt_b:
+            p = render_reg(p, d.rs1);
+            *p++ = ',';
+            p = render_reg(p, d.rs2);
+            *p++ = ',';
+            p = hex::to_hex0x32(p, d.target);
             break;
-        case funct3_csrrwi:
-            os << render_mnemonic("csrrwi")
-               << render_reg(rd) << ","
-               << hex::to_hex0x12(csr) << ","
-               << zimm;
+
+        case fmt_i:
+            p = render_reg(p, d.rd);
+            *p++ = ',';
+            p = render_reg(p, d.rs1);
+            *p++ = ',';
+            p = render_dec(p, d.imm);
             break;
-        case funct3_csrrsi:
-            os << render_mnemonic("csrrsi")
-               << render_reg(rd) << ","
-               << hex::to_hex0x12(csr) << ","
-               << zimm;
+
+        case fmt_r:
+            p = render_reg(p, d.rd);
+            *p++ = ',';
+            p = render_reg(p, d.rs1);
+            *p++ = ',';
+            p = render_reg(p, d.rs2);
             break;
-        case funct3_csrrci:
-            os << render_mnemonic("csrrci")
-               << render_reg(rd) << ","
-               << hex::to_hex0x12(csr) << ","
-               << zimm;
+
+        case fmt_csr:
+        case fmt_csri:
+            p = render_reg(p, d.rd);
+            *p++ = ',';
+            p = hex::to_hex0x12(p, d.csr);
+            *p++ = ',';
+            if (d.format == fmt_csr)
+                p = render_reg(p, d.rs1);
+            else
+                p = render_dec(p, d.rs1);
             break;
-        default:
-            return render_illegal_insn();
     }
 
-    return os.str();
+    return p;
 }
 
 //******************************************************************************
 // Takes a uint32_t instruction and uint32_t address as its parameter and returns
-// a string containing the disassembled instruction text by using a switch statement
-// woth the value of the opcode field
+// a string containing the disassembled instruction text (see decode_insn() and
+// render())
 //******************************************************************************
 string rv32i_decode::decode(uint32_t addr, uint32_t insn)
 {
-    uint32_t opcode = get_opcode(insn);
-
-    switch (opcode)
-    {
-        case opcode_lui:
-            return render_lui(insn);
-
-        case opcode_auipc:
-            return render_auipc(insn);
-
-        case opcode_jal:
-            return render_jal(addr, insn);
-
-        case opcode_jalr:
-            return render_jalr(insn);
-
-        case opcode_btype:
-        {
-            uint32_t funct3 = get_funct3(insn);
-            switch (funct3)
-            {
-                case funct3_beq:  return render_btype(addr, insn, "beq");
-                case funct3_bne:  return render_btype(addr, insn, "bne");
-                case funct3_blt:  return render_btype(addr, insn, "blt");
-                case funct3_bge:  return render_btype(addr, insn, "bge");
-                case funct3_bltu: return render_btype(addr, insn, "bltu");
-                case funct3_bgeu: return render_btype(addr, insn, "bgeu");
-                default:          return render_illegal_insn();
-            }
-        }
-
-        case opcode_load:
-        {
-            uint32_t funct3 = get_funct3(insn);
-            switch (funct3)
-            {
-                case funct3_lb:  return render_itype_load(insn, "lb");
-                case funct3_lh:  return render_itype_load(insn, "lh");
-                case funct3_lw:  return render_itype_load(insn, "lw");
-                case funct3_lbu: return render_itype_load(insn, "lbu");
-                case funct3_lhu: return render_itype_load(insn, "lhu");
-                default:         return render_illegal_insn();
-            }
-        }
-
-        case opcode_store:
-        {
-            uint32_t funct3 = get_funct3(insn);
-            switch (funct3)
-            {
-                case funct3_sb: return render_stype(insn, "sb");
-                case funct3_sh: return render_stype(insn, "sh");
-                case funct3_sw: return render_stype(insn, "sw");
-                default:        return render_illegal_insn();
-            }
-        }
-
-        case opcode_alu_imm:
-        {
-            uint32_t funct3 = get_funct3(insn);
-            int32_t imm_i = get_imm_i(insn);
-
-            switch (funct3)
-            {
-                case funct3_add_sub:
-                    return render_itype_alu(insn, "addi", imm_i);
-                case 0b010:
-                    return render_itype_alu(insn, "slti", imm_i);
-                case 0b011:
-                    return render_itype_alu(insn, "sltiu", imm_i);
-                case funct3_xor: 
-                    return render_itype_alu(insn, "xori", imm_i);
-                case funct3_or: 
-                    return render_itype_alu(insn, "ori", imm_i);
-                case funct3_and: 
-                    return render_itype_alu(insn, "andi", imm_i);
-                case funct3_sll: 
-                    return render_itype_alu(insn, "slli", imm_i & 0x1f);
-                case funct3_srl_sra:
-                {
-                    uint32_t funct7 = get_funct7(insn);
-                    if (funct7 == funct7_srl)
-                        return render_itype_alu(insn, "srli", imm_i & 0x1f);
-                    else if (funct7 == funct7_sra)
-                        return render_itype_alu(insn, "srai", imm_i & 0x1f);
-                    else
-                        return render_illegal_insn();
-                }
-                default:
-                    return render_illegal_insn();
-            }
-        }
-
-        case opcode_alu_reg:
-        {
-            uint32_t funct3 = get_funct3(insn);
-            uint32_t funct7 = get_funct7(insn);
-
-            switch (funct3)
-            {
-                case funct3_add_sub:
-                    if (funct7 == funct7_add) return render_rtype(insn, "add");
-                    if (funct7 == funct7_sub) return render_rtype(insn, "sub");
-                    break;
-                case funct3_sll:
-                    if (funct7 == funct7_add) return render_rtype(insn, "sll");
-                    break;
-                case funct3_slt:
-                    if (funct7 == funct7_add) return render_rtype(insn, "slt");
-                    break;
-                case funct3_sltu:
-                    if (funct7 == funct7_add) return render_rtype(insn, "sltu");
-                    break;
-                case funct3_xor:
-                    if (funct7 == funct7_add) return render_rtype(insn, "xor");
-                    break;
-                case funct3_srl_sra:
-                    if (funct7 == funct7_srl) return render_rtype(insn, "srl");
-                    if (funct7 == funct7_sra) return render_rtype(insn, "sra");
-                    break;
-                case funct3_or:
-                    if (funct7 == funct7_add) return render_rtype(insn, "or");
-                    break;
-                case funct3_and:
-                    if (funct7 == funct7_add) return render_rtype(insn, "and");
-                    break;
-            }
-            return render_illegal_insn();
-        }
-
-        case opcode_system:
-            return render_system(insn);
-
-        default:
-            return render_illegal_insn();
-    }
+    char buf[render_size];
+    return string(buf, render(buf, decode_insn(addr, insn)));
 }
@@ -75,6 +75,63 @@ public:
     static constexpr uint32_t funct7_srl  = 0b0000000;
     static constexpr uint32_t funct7_sra  = 0b0100000;
 
+    static constexpr uint32_t csr_mhartid = 0xf14;
+
+    //******************************************************************************
+    // The RV32I operations. The execution engines index their tables with them.
+    //******************************************************************************
+    enum insn_op : uint8_t
+    {
+        op_illegal,
+        op_lui, op_auipc, op_jal, op_jalr,
+        op_beq, op_bne, op_blt, op_bge, op_bltu, op_bgeu,
+        op_lb, op_lh, op_lw, op_lbu, op_lhu,
+        op_sb, op_sh, op_sw,
+        op_addi, op_slti, op_sltiu, op_xori, op_ori, op_andi, op_slli, op_srli, op_srai,
+        op_add, op_sub, op_sll, op_slt, op_sltu, op_xor, op_srl, op_sra, op_or, op_and,
+        op_ecall, op_ebreak,
+        op_csrrw, op_csrrs, op_csrrc, op_csrrwi, op_csrrsi, op_csrrci,
+        op_count
+    };
+
+    //******************************************************************************
+    // The operand layouts of the disassembled instructions.
+    //******************************************************************************
+    enum insn_format : uint8_t
+    {
+        fmt_none,           // no operands: illegal, ecall, ebreak
+        fmt_u,              // rd,imm20
+        fmt_j,              // rd,target
+        fmt_base_disp,      // rd,imm(rs1)      jalr and the loads
+        fmt_b,              // rs1,rs2,target
+        fmt_s,              // rs2,imm(rs1)
+        fmt_i,              // rd,rs1,imm       (the shift amount for shifts)
+        fmt_r,              // rd,rs1,rs2
+        fmt_csr,            // rd,csr,rs1
+        fmt_csri            // rd,csr,zimm      (zimm is in rs1)
+    };
+
+    //******************************************************************************
+    // An instruction taken apart by decode_insn(). The register fields are always
+    // filled in, whether or not the format uses them.
+    //******************************************************************************
+    struct decoded_insn
+    {
+        uint32_t insn;
+        uint8_t  op;        // insn_op
+        uint8_t  format;    // insn_format
+        uint8_t  rd;
+        uint8_t  rs1;
+        uint8_t  rs2;
+        uint16_t csr;
+        int32_t  imm;       // sign extended; U-type already shifted left by 12
+        uint32_t target;    // jal and branch target address
+    };
+
+    static constexpr size_t render_size = 48;   // enough for any render()
+
+    static decoded_insn decode_insn(uint32_t addr, uint32_t insn);
+    static char *render(char *buf, const decoded_insn &d);
     static std::string decode(uint32_t addr, uint32_t insn);
 
     static uint32_t get_opcode(uint32_t insn);
@@ -90,19 +147,8 @@ public:
     static int32_t get_imm_s(uint32_t insn);
     static int32_t get_imm_j(uint32_t insn);
 
-    static std::string render_illegal_insn();
-    static std::string render_lui(uint32_t insn);
-    static std::string render_auipc(uint32_t insn);
-    static std::string render_jal(uint32_t addr, uint32_t insn);
-    static std::string render_jalr(uint32_t insn);
-    static std::string render_btype(uint32_t addr, uint32_t insn, const char *mnemonic);
-    static std::string render_itype_load(uint32_t insn, const char *mnemonic);
-    static std::string render_stype(uint32_t insn, const char *mnemonic);
-    static std::string render_itype_alu(uint32_t insn, const char *mnemonic, int32_t imm_i);
-    static std::string render_rtype(uint32_t insn, const char *mnemonic);
-    static std::string render_system(uint32_t insn); // csrr*, ecall, ebreak
-
-    static std::string render_reg(int r);
-    static std::string render_base_disp(uint32_t reg, int32_t imm);
-    static std::string render_mnemonic(const std::string &mnemonic);
+private:
+    static insn_op decode_op(uint32_t insn);
+    static char *render_reg(char *p, uint32_t r);
+    static char *render_dec(char *p, int32_t v);
 };
@@ -10,7 +10,6 @@
 
 #include "rv32i_hart.h"
 #include <iostream>
-#include <iomanip>
 #include <string>
 
 using namespace std;
@@ -33,6 +32,15 @@ void rv32i_hart::reset()
     halt = false;
     halt_reason = "none";
     insn_counter = 0;
+    since_keyframe = 0;
+
+    icache.clear();
+    icache.resize((static_cast<uint64_t>(mem.get_size()) + icache_page_bytes - 1) / icache_page_bytes);
+
+    blocks.clear();
+    chain_from = nullptr;
+    jit.reset();
+    code_seen = watch ? watch->get_generation() : 0;
 }
 
 //******************************************************************************
@@ -41,17 +49,67 @@ void rv32i_hart::reset()
 //   hdr - A string printed at the beginning of each output line
 //
 // Return value:
-//   None. Output is written directly to std::cout.
+//   None. Output is written to the trace output (see set_trace_output()).
 //******************************************************************************
 void rv32i_hart::dump(const string &hdr) const
 {
-    regs.dump(hdr);
-    cout << hdr << " pc " << hex::to_hex32(pc) << endl;
+    regs.dump(hdr, *trace_out);
+    char buf[16];
+    char *p = buf;
+    *p++ = ' ';
+    *p++ = 'p';
+    *p++ = 'c';
+    *p++ = ' ';
+    p = hex::to_hex32(p, pc);
+    *p++ = '\n';
+
+    *trace_out << hdr;
+    trace_out->write(buf, p - buf);
+}
+
+//******************************************************************************
+// This function prints the register trace for the instruction about to
+// execute: the full dump() or, between keyframes (see set_register_keyframes()),
+// a single line with the pc and the registers that changed since the previous
+// dump.
+//
+// Parameters:
+//   hdr - A string printed at the beginning of each output line
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_hart::dump_registers(const string &hdr)
+{
+    if (keyframe_interval == 0 || since_keyframe == 0)
+    {
+        dump(hdr);
+        dumped_regs = regs;
+    }
+    else
+    {
+        char buf[16 + 32 * 13];
+        char *p = buf;
+        *p++ = ' ';
+        *p++ = 'p';
+        *p++ = 'c';
+        *p++ = ' ';
+        p = hex::to_hex32(p, pc);
+        p = regs.dump_changes(p, dumped_regs);
+        *p++ = '\n';
+
+        *trace_out << hdr;
+        trace_out->write(buf, p - buf);
+    }
+
+    if (keyframe_interval && ++since_keyframe == keyframe_interval)
+        since_keyframe = 0;
 }
 
 //******************************************************************************
 // This function simulates a single CPU cycle. It tells the simulator to execute an
-// instruction
+// instruction. The tracing flags are looked at once, to pick the instantiation
+// of tick_as() that matches them.
 //
 // Parameters:
 //   hdr - A string printed at the start of each trace line when register or
@@ -61,12 +119,99 @@ void rv32i_hart::dump(const string &hdr) const
 //   None
 //******************************************************************************
 void rv32i_hart::tick(const string &hdr)
+{
+    (this->*select_tick())(hdr);
+}
+
+//******************************************************************************
+// This function executes instructions with tick() until the hart halts or
+// exec_limit instructions have been executed. The loop is instantiated for
+// each combination of tracing flags and the one matching them is picked
+// once, so without tracing it contains no trace code or checks at all.
+//
+// Parameters:
+//   exec_limit - The maximum value of the instruction counter (0 = no limit).
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_hart::run_ticks(uint64_t exec_limit)
+{
+    static void (rv32i_hart::*const loops[8])(uint64_t) =
+    {
+        &rv32i_hart::tick_loop<false, false, false>, &rv32i_hart::tick_loop<true, false, false>,
+        &rv32i_hart::tick_loop<false, true, false>,  &rv32i_hart::tick_loop<true, true, false>,
+        &rv32i_hart::tick_loop<false, false, true>,  &rv32i_hart::tick_loop<true, false, true>,
+        &rv32i_hart::tick_loop<false, true, true>,   &rv32i_hart::tick_loop<true, true, true>,
+    };
+
+    (this->*loops[trace_flags()])(exec_limit ? exec_limit : UINT64_MAX);
+}
+
+//******************************************************************************
+// This function returns the instantiation of tick_as() that matches the
+// tracing flags.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   A pointer to the member function.
+//******************************************************************************
+rv32i_hart::tick_fn rv32i_hart::select_tick() const
+{
+    static const tick_fn ticks[8] =
+    {
+        &rv32i_hart::tick_as<false, false, false>, &rv32i_hart::tick_as<true, false, false>,
+        &rv32i_hart::tick_as<false, true, false>,  &rv32i_hart::tick_as<true, true, false>,
+        &rv32i_hart::tick_as<false, false, true>,  &rv32i_hart::tick_as<true, false, true>,
+        &rv32i_hart::tick_as<false, true, true>,   &rv32i_hart::tick_as<true, true, true>,
+    };
+
+    return ticks[trace_flags()];
+}
+
+//******************************************************************************
+// This function calls tick_as() until the hart halts or the limit is reached.
+//
+// Parameters:
+//   limit - The maximum value of the instruction counter.
+//
+// Return value:
+//   None
+//******************************************************************************
+template<bool show_insns, bool show_regs, bool record>
+void rv32i_hart::tick_loop(uint64_t limit)
+{
+    static const string hdr;
+
+    while (!halt && insn_counter < limit)
+    {
+        sync_code();
+        tick_as<show_insns, show_regs, record>(hdr);
+    }
+}
+
+//******************************************************************************
+// This function is tick() for one combination of the tracing flags.
+//
+// Parameters:
+//   show_insns - (template) print the instruction trace (-i)
+//   show_regs  - (template) print the register trace (-r)
+//   record     - (template) pass the instruction to the trace sink
+//   hdr        - A string printed at the start of each trace line
+//
+// Return value:
+//   None
+//******************************************************************************
+template<bool show_insns, bool show_regs, bool record>
+void rv32i_hart::tick_as(const string &hdr)
 {
     if (halt)
         return;
 
-    if (show_registers)
-        dump(hdr);    
+    if constexpr (show_regs)
+        dump_registers(hdr);
 
     if (pc & 0x3)
     {
@@ -75,202 +220,317 @@ void rv32i_hart::tick(const string &hdr)
         return;
     }
 
-    uint32_t cur_pc = pc;
-    uint32_t insn   = mem.get32(cur_pc);
+    uint32_t cur_pc       = pc;
+    const predecoded &d   = fetch(cur_pc);
 
     ++insn_counter;
 
-    ostream *pos = nullptr;
-    if (show_instructions)
+    trace_record rec;
+    if constexpr (record)
+        begin_record(rec, cur_pc, d);
+
+    if constexpr (show_insns)
     {
-        pos = &cout;
-        cout << hdr
-             << hex::to_hex32(cur_pc) << ": "
-             << hex::to_hex32(insn) << "  ";
+        char buf[32];
+        char *p = hex::to_hex32(buf, cur_pc);
+        *p++ = ':';
+        *p++ = ' ';
+        p = hex::to_hex32(p, d.insn);
+        *p++ = ' ';
+        *p++ = ' ';
+
+        *trace_out << hdr;
+        trace_out->write(buf, p - buf);
     }
 
-    exec(insn, pos);
+    exec<show_insns>(d);
 
-    if (show_instructions)
-        cout << endl;
+    if constexpr (show_insns)
+        trace_out->put('\n');    // no flush: cout is block buffered (see main())
+
+    if constexpr (record)
+    {
+        end_record(rec, d);
+        record_sink->write(rec);
+    }
 }
 
+//******************************************************************************
+// This function fills in the parts of a binary trace record that have to be
+// taken before the instruction executes: its address and word and, for loads
+// and stores, the memory address and the value that is loaded or stored.
+// Loaded values are read a byte at a time so that no range warnings are
+// printed; bytes outside the memory read as zero, just as they do for the
+// load itself.
+//
+// Parameters:
+//   r    - The record to fill in.
+//   addr - The address of the instruction.
+//   d    - The instruction about to execute.
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_hart::begin_record(trace_record &r, uint32_t addr, const predecoded &d) const
+{
+    r.pc = addr;
+    r.insn = d.insn;
+    r.has_mem = false;
+    r.mem_addr = 0;
+    r.mem_value = 0;
+
+    uint32_t ea = static_cast<uint32_t>(regs.get(d.rs1)) + static_cast<uint32_t>(d.imm);
+    uint32_t width = 0;
+
+    switch (d.op)
+    {
+        case op_lb: case op_lbu: case op_sb: width = 1; break;
+        case op_lh: case op_lhu: case op_sh: width = 2; break;
+        case op_lw: case op_sw:              width = 4; break;
+        default:
+            return;
+    }
+
+    r.has_mem = true;
+    r.mem_addr = ea;
+
+    if (d.op == op_sb || d.op == op_sh || d.op == op_sw)
+    {
+        uint32_t v = static_cast<uint32_t>(regs.get(d.rs2));
+        r.mem_value = width == 4 ? v : v & ((1u << (8 * width)) - 1);
+        return;
+    }
+
+    uint32_t v = 0;
+    for (uint32_t i = 0; i < width; ++i)
+        if (ea + i < mem.get_size())
+            v |= static_cast<uint32_t>(mem.get8(ea + i)) << (8 * i);
+
+    if (d.op == op_lb)
+        v = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int8_t>(v)));
+    else if (d.op == op_lh)
+        v = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int16_t>(v)));
+    r.mem_value = v;
+}
 
 //******************************************************************************
-// This function will execute the given RV32I instruction by making use of the get_xxx() 
-// methods to extract the needed instruction fields to decode the instruction and invoke
-// the associated exec_xxx() helper function by using the same sort of switch-logic from version 2
+// This function completes a binary trace record after the instruction has
+// executed by adding the register it wrote, if any.
 //
 // Parameters:
-//   insn - The 32-bit instruction fetched from memory.
-//   pos  - Pointer to an output stream used to print trace information.
+//   r - The record to complete.
+//   d - The instruction that executed.
 //
 // Return value:
 //   None
 //******************************************************************************
-void rv32i_hart::exec(uint32_t insn, ostream *pos)
+void rv32i_hart::end_record(trace_record &r, const predecoded &d) const
 {
-    if (pos)
+    r.rd = 0;
+    r.rd_value = 0;
+
+    switch (d.op)
     {
-        string s = rv32i_decode::decode(pc, insn);
-        *pos << left << setw(instruction_width) << s << right;
+        case op_illegal:
+        case op_beq: case op_bne: case op_blt: case op_bge: case op_bltu: case op_bgeu:
+        case op_sb: case op_sh: case op_sw:
+        case op_ecall: case op_ebreak:
+            return;
     }
 
-    uint32_t opcode = get_opcode(insn);
+    if (d.rd)
+    {
+        r.rd = d.rd;
+        r.rd_value = static_cast<uint32_t>(regs.get(d.rd));
+    }
+}
+
+//******************************************************************************
+// This function returns the predecoded form of the instruction at addr. Words
+// inside the simulated memory are decoded once and kept in the instruction
+// cache until a store to that word (or, with a code_watch, another hart's
+// store to code) invalidates them. Fetches from outside the
+// memory are decoded every time so that the usual range warnings still appear.
+//
+// Parameters:
+//   addr - The (word aligned) address of the instruction to fetch.
+//
+// Return value:
+//   A reference to the predecoded instruction. It remains valid until the
+//   next call to fetch().
+//******************************************************************************
+rv32i_hart::predecoded &rv32i_hart::fetch(uint32_t addr)
+{
+    uint32_t page = addr / icache_page_bytes;
 
-    switch (opcode)
+    if (page >= icache.size() || addr >= mem.get_size())
     {
-        case opcode_lui:      exec_lui(insn, pos);      break;
-        case opcode_auipc:    exec_auipc(insn, pos);    break;
-        case opcode_jal:      exec_jal(insn, pos);      break;
-        case opcode_jalr:     exec_jalr(insn, pos);     break;
+        uncached = predecode(mem.get32(addr));
+        return uncached;
+    }
 
-        case opcode_btype:
-        {
-            uint32_t f3 = get_funct3(insn);
-            switch (f3)
-            {
-                case funct3_beq:  exec_beq(insn, pos);  break;
-                case funct3_bne:  exec_bne(insn, pos);  break;
-                case funct3_blt:  exec_blt(insn, pos);  break;
-                case funct3_bge:  exec_bge(insn, pos);  break;
-                case funct3_bltu: exec_bltu(insn, pos); break;
-                case funct3_bgeu: exec_bgeu(insn, pos); break;
-                default:          exec_illegal_insn(insn, pos); break;
-            }
-        }
-        break;
+    if (!icache[page])
+        icache[page].reset(new predecoded[icache_page_words]());
 
-        case opcode_load:
-        {
-            uint32_t f3 = get_funct3(insn);
-            switch (f3)
-            {
-                case funct3_lb:  exec_lb(insn, pos);  break;
-                case funct3_lh:  exec_lh(insn, pos);  break;
-                case funct3_lw:  exec_lw(insn, pos);  break;
-                case funct3_lbu: exec_lbu(insn, pos); break;
-                case funct3_lhu: exec_lhu(insn, pos); break;
-                default:         exec_illegal_insn(insn, pos); break;
-            }
-        }
-        break;
+    predecoded &d = icache[page][(addr / 4) % icache_page_words];
+    if (!d.handler)
+    {
+        if (watch)
+            watch->add_code(addr);
+        d = predecode(mem.get32(addr));
+    }
+    return d;
+}
 
-        case opcode_store:
-        {
-            uint32_t f3 = get_funct3(insn);
-            switch (f3)
-            {
-                case funct3_sb: exec_sb(insn, pos); break;
-                case funct3_sh: exec_sh(insn, pos); break;
-                case funct3_sw: exec_sw(insn, pos); break;
-                default:        exec_illegal_insn(insn, pos); break;
-            }
-        }
-        break;
+//******************************************************************************
+// This function discards any cached decodings of the words touched by a store
+// so that self-modifying code is re-decoded the next time it is fetched. If one
+// of the words belongs to a translated block, every block is marked stale.
+//
+// Parameters:
+//   addr - The address of the first byte that was written.
+//   len  - The number of bytes that were written.
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_hart::invalidate(uint32_t addr, uint32_t len)
+{
+    uint64_t first = addr / 4;
+    uint64_t last  = (static_cast<uint64_t>(addr) + len - 1) / 4;
 
-        case opcode_alu_imm:
+    for (uint64_t w = first; w <= last; ++w)
+    {
+        uint64_t page = w / icache_page_words;
+        if (page < icache.size() && icache[page])
         {
-            uint32_t f3 = get_funct3(insn);
-            switch (f3)
-            {
-                case funct3_add_sub: exec_addi(insn, pos);  break; // addi
-                case funct3_slt:     exec_slti(insn, pos);  break; // 0b010
-                case funct3_sltu:    exec_sltiu(insn, pos); break; // 0b011
-                case funct3_xor:     exec_xori(insn, pos);  break;
-                case funct3_or:      exec_ori(insn, pos);   break;
-                case funct3_and:     exec_andi(insn, pos);  break;
-                case funct3_sll:     exec_slli(insn, pos);  break;
-                case funct3_srl_sra:
-                {
-                    uint32_t f7 = get_funct7(insn);
-                    if (f7 == funct7_srl)      exec_srli(insn, pos);
-                    else if (f7 == funct7_sra) exec_srai(insn, pos);
-                    else                       exec_illegal_insn(insn, pos);
-                    break;
-                }
-                default:
-                    exec_illegal_insn(insn, pos);
-            }
+            predecoded &d = icache[page][w % icache_page_words];
+            if (d.in_block)
+                ++block_generation;
+            d.handler = nullptr;
+            d.in_block = false;
         }
-        break;
+    }
 
-        case opcode_alu_reg:
-        {
-            uint32_t f3 = get_funct3(insn);
-            uint32_t f7 = get_funct7(insn);
-
-            switch (f3)
-            {
-                case funct3_add_sub:
-                    if (f7 == funct7_add) exec_add(insn, pos);
-                    else if (f7 == funct7_sub) exec_sub(insn, pos);
-                    else exec_illegal_insn(insn, pos);
-                    break;
-
-                case funct3_sll:
-                    if (f7 == funct7_add) exec_sll(insn, pos);
-                    else exec_illegal_insn(insn, pos);
-                    break;
-
-                case funct3_slt:
-                    if (f7 == funct7_add) exec_slt(insn, pos);
-                    else exec_illegal_insn(insn, pos);
-                    break;
-
-                case funct3_sltu:
-                    if (f7 == funct7_add) exec_sltu(insn, pos);
-                    else exec_illegal_insn(insn, pos);
-                    break;
-
-                case funct3_xor:
-                    if (f7 == funct7_add) exec_xor(insn, pos);
-                    else exec_illegal_insn(insn, pos);
-                    break;
-
-                case funct3_srl_sra:
-                    if (f7 == funct7_srl) exec_srl(insn, pos);
-                    else if (f7 == funct7_sra) exec_sra(insn, pos);
-                    else exec_illegal_insn(insn, pos);
-                    break;
-
-                case funct3_or:
-                    if (f7 == funct7_add) exec_or(insn, pos);
-                    else exec_illegal_insn(insn, pos);
-                    break;
-
-                case funct3_and:
-                    if (f7 == funct7_add) exec_and(insn, pos);
-                    else exec_illegal_insn(insn, pos);
-                    break;
-
-                default:
-                    exec_illegal_insn(insn, pos);
-            }
-        }
-        break;
+    if (watch)
+        watch->wrote(addr, len, code_seen);
+}
+
+//******************************************************************************
+// This function discards all of the hart's decodings, its instruction cache
+// and its translated (and compiled) blocks, because another hart sharing its
+// code_watch has stored to code.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_hart::flush_code()
+{
+    code_seen = watch->get_generation();
+    for (unique_ptr<predecoded[]> &page : icache)
+        page.reset();
+    ++block_generation;
+}
 
-        case opcode_system:
-            exec_system(insn, pos);
-            break;
+//******************************************************************************
+// This function will execute the given predecoded RV32I instruction by invoking
+// the exec_xxx() helper function that was selected when it was decoded, or its
+// traced instantiation.
+//
+// Parameters:
+//   trace - (template) true to print the disassembly and trace comment
+//   d     - The predecoded instruction to execute.
+//
+// Return value:
+//   None
+//******************************************************************************
+template<bool trace>
+void rv32i_hart::exec(const predecoded &d)
+{
+    if constexpr (trace)
+    {
+        char buf[render_size + instruction_width];
+        char *p = insn_text.render(buf, pc, d.insn);
+        while (p < buf + instruction_width)
+            *p++ = ' ';
+        trace_out->write(buf, p - buf);
 
-        default:
-            exec_illegal_insn(insn, pos);
-            break;
+        (this->*exec_table<true>[d.op])(d);
     }
+    else
+    {
+        (this->*d.handler)(d);
+    }
+}
+
+//******************************************************************************
+// The exec_xxx() helper for each predecoded operation, indexed by insn_op, in
+// its untraced (false) or traced (true) instantiation.
+//******************************************************************************
+template<bool trace>
+const rv32i_hart::exec_fn rv32i_hart::exec_table[op_count] =
+{
+    &rv32i_hart::exec_illegal_insn<trace>,
+    &rv32i_hart::exec_lui<trace>, &rv32i_hart::exec_auipc<trace>,
+    &rv32i_hart::exec_jal<trace>, &rv32i_hart::exec_jalr<trace>,
+    &rv32i_hart::exec_beq<trace>, &rv32i_hart::exec_bne<trace>, &rv32i_hart::exec_blt<trace>,
+    &rv32i_hart::exec_bge<trace>, &rv32i_hart::exec_bltu<trace>, &rv32i_hart::exec_bgeu<trace>,
+    &rv32i_hart::exec_lb<trace>, &rv32i_hart::exec_lh<trace>, &rv32i_hart::exec_lw<trace>,
+    &rv32i_hart::exec_lbu<trace>, &rv32i_hart::exec_lhu<trace>,
+    &rv32i_hart::exec_sb<trace>, &rv32i_hart::exec_sh<trace>, &rv32i_hart::exec_sw<trace>,
+    &rv32i_hart::exec_addi<trace>, &rv32i_hart::exec_slti<trace>, &rv32i_hart::exec_sltiu<trace>,
+    &rv32i_hart::exec_xori<trace>, &rv32i_hart::exec_ori<trace>, &rv32i_hart::exec_andi<trace>,
+    &rv32i_hart::exec_slli<trace>, &rv32i_hart::exec_srli<trace>, &rv32i_hart::exec_srai<trace>,
+    &rv32i_hart::exec_add<trace>, &rv32i_hart::exec_sub<trace>, &rv32i_hart::exec_sll<trace>,
+    &rv32i_hart::exec_slt<trace>, &rv32i_hart::exec_sltu<trace>, &rv32i_hart::exec_xor<trace>,
+    &rv32i_hart::exec_srl<trace>, &rv32i_hart::exec_sra<trace>,
+    &rv32i_hart::exec_or<trace>, &rv32i_hart::exec_and<trace>,
+    &rv32i_hart::exec_ecall<trace>, &rv32i_hart::exec_ebreak<trace>,
+    &rv32i_hart::exec_csrrw<trace>, &rv32i_hart::exec_csrrs<trace>, &rv32i_hart::exec_csrrc<trace>,
+    &rv32i_hart::exec_csrrwi<trace>, &rv32i_hart::exec_csrrsi<trace>, &rv32i_hart::exec_csrrci<trace>,
+};
+
+//******************************************************************************
+// This function decodes an RV32I instruction into the compact form that is kept
+// in the instruction cache. The fields come from the shared decoder
+// (rv32i_decode::decode_insn()); this adds the exec_xxx() helper that
+// implements the instruction.
+//
+// Parameters:
+//   insn - The 32-bit instruction fetched from memory.
+//
+// Return value:
+//   The predecoded instruction.
+//******************************************************************************
+rv32i_hart::predecoded rv32i_hart::predecode(uint32_t insn)
+{
+    decoded_insn di = decode_insn(0, insn);
+
+    predecoded d;
+    d.insn    = insn;
+    d.rd      = di.rd;
+    d.rs1     = di.rs1;
+    d.rs2     = di.rs2;
+    d.imm     = di.imm;
+    d.op      = di.op;
+    d.handler = exec_table<false>[d.op];
+    return d;
 }
 
 //******************************************************************************
 // This function handles illegal or unimplemented instructions
 // Parameters:
-//   insn - The 32-bit illegal instruction that triggered the error.
-//   pos  - Optional pointer to an output stream for printing the error
-//          message
+//   d    - The predecoded illegal instruction that triggered the error.
+//   trace - (template) true in the traced instantiation (nothing is printed)
 //
 // Return value:
 //   None
 //******************************************************************************
-void rv32i_hart::exec_illegal_insn(uint32_t /*insn*/, ostream * /*pos*/)
+template<bool trace>
+void rv32i_hart::exec_illegal_insn(const predecoded &/*d*/)
 {
     halt = true;
     halt_reason = "Illegal instruction";
@@ -287,43 +547,45 @@ void rv32i_hart::exec_illegal_insn(uint32_t /*insn*/, ostream * /*pos*/)
 // it to the PC as required, and write the result into register rd.
 // 
 // Parameters:
-//   insn - the 32-bit encoded instruction being executed
-//   pos  - optional ostream used to print execution trace comments; if nullptr,
-//          no trace output is produced
+//   d    - the predecoded instruction being executed
+//   trace - (template) true to print the trace comment; the untraced
+//           instantiation contains no trace code at all
 //
 // Return value:
 //   None
 //******************************************************************************
 
-void rv32i_hart::exec_lui(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_lui(const predecoded &d)
 {
-    uint32_t rd    = get_rd(insn);
-    int32_t imm_u  = get_imm_u(insn);   // << 12 already
+    uint32_t rd    = d.rd;
+    int32_t imm_u  = d.imm;   // << 12 already
     uint32_t res   = static_cast<uint32_t>(imm_u);
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd
-             << " = " << hex::to_hex0x32(res);
+        *trace_out << "// x" << rd
+                   << " = " << hex::to_hex0x32(res);
     }
 
     regs.set(rd, imm_u);
     pc += 4;
 }
 
-void rv32i_hart::exec_auipc(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_auipc(const predecoded &d)
 {
-    uint32_t rd       = get_rd(insn);
+    uint32_t rd       = d.rd;
     uint32_t pc_before = pc;
-    int32_t imm_u     = get_imm_u(insn);
+    int32_t imm_u     = d.imm;
     uint32_t res      = pc_before + static_cast<uint32_t>(imm_u);
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd
-             << " = " << hex::to_hex0x32(pc_before)
-             << " + " << hex::to_hex0x32(static_cast<uint32_t>(imm_u))
-             << " = " << hex::to_hex0x32(res);
+        *trace_out << "// x" << rd
+                   << " = " << hex::to_hex0x32(pc_before)
+                   << " + " << hex::to_hex0x32(static_cast<uint32_t>(imm_u))
+                   << " = " << hex::to_hex0x32(res);
     }
 
     regs.set(rd, static_cast<int32_t>(res));
@@ -337,53 +599,55 @@ void rv32i_hart::exec_auipc(uint32_t insn, ostream *pos)
 // write the return address into rd, and perform the jump
 // 
 // Parameters:
-//   insn - the 32-bit encoded instruction being executed
-//   pos  - optional ostream to print trace comments, or nullptr for no output
+//   d    - the predecoded instruction being executed
+//   trace - (template) true to print the trace comment
 //
 // Return value:
 //   None. These functions modify the destination register and update the PC.
 //******************************************************************************
 
-void rv32i_hart::exec_jal(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_jal(const predecoded &d)
 {
-    uint32_t rd        = get_rd(insn);
+    uint32_t rd        = d.rd;
     uint32_t pc_before = pc;
-    int32_t imm_j      = get_imm_j(insn);
+    int32_t imm_j      = d.imm;
     uint32_t link      = pc_before + 4;
     uint32_t target    = pc_before + static_cast<uint32_t>(imm_j);
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd
-             << " = " << hex::to_hex0x32(link)
-             << ",  pc = " << hex::to_hex0x32(pc_before)
-             << " + "    << hex::to_hex0x32(static_cast<uint32_t>(imm_j))
-             << " = "    << hex::to_hex0x32(target);
+        *trace_out << "// x" << rd
+                   << " = " << hex::to_hex0x32(link)
+                   << ",  pc = " << hex::to_hex0x32(pc_before)
+                   << " + "    << hex::to_hex0x32(static_cast<uint32_t>(imm_j))
+                   << " = "    << hex::to_hex0x32(target);
     }
 
     regs.set(rd, static_cast<int32_t>(link));
     pc = target;
 }
 
-void rv32i_hart::exec_jalr(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_jalr(const predecoded &d)
 {
-    uint32_t rd        = get_rd(insn);
-    uint32_t rs1       = get_rs1(insn);
+    uint32_t rd        = d.rd;
+    uint32_t rs1       = d.rs1;
     uint32_t pc_before = pc;
-    int32_t imm_i      = get_imm_i(insn);
+    int32_t imm_i      = d.imm;
 
     uint32_t base   = static_cast<uint32_t>(regs.get(rs1));
     uint32_t link   = pc_before + 4;
     uint32_t sum    = base + static_cast<uint32_t>(imm_i);
     uint32_t target = sum & ~1u;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd
-             << " = " << hex::to_hex0x32(link)
-             << ",  pc = (" << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
-             << " + "       << hex::to_hex0x32(base)
-             << ") & 0xfffffffe = " << hex::to_hex0x32(target);
+        *trace_out << "// x" << rd
+                   << " = " << hex::to_hex0x32(link)
+                   << ",  pc = (" << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
+                   << " + "       << hex::to_hex0x32(base)
+                   << ") & 0xfffffffe = " << hex::to_hex0x32(target);
     }
 
     regs.set(rd, static_cast<int32_t>(link));
@@ -395,6 +659,7 @@ void rv32i_hart::exec_jalr(uint32_t insn, ostream *pos)
 // the behavior of a branch instruction.
 
 // Parameters:
+//   os           - The stream to print the comment to.
 //   rs1_val      - The 32-bit value of the rs1 register used in the branch.
 //   rs2_val      - The 32-bit value of the rs2 register used in the branch.
 //   offset       - The signed, 32-bit branch offset computed from the
@@ -406,7 +671,7 @@ void rv32i_hart::exec_jalr(uint32_t insn, ostream *pos)
 //   A string describing the branch decision and the effect on the program counter.
 //******************************************************************************
 
-static void branch_comment(ostream *pos,
+static void branch_comment(ostream &os,
                            const char *op,
                            bool is_unsigned,
                            uint32_t pc_before,
@@ -415,20 +680,18 @@ static void branch_comment(ostream *pos,
                            uint32_t v2_u,
                            bool take)
 {
-    if (!pos) return;
-
     uint32_t offset      = static_cast<uint32_t>(imm_b);
     uint32_t fallthrough = pc_before + 4;
     uint32_t target      = pc_before + static_cast<uint32_t>(imm_b);
 
-    *pos << "// pc += ("
-         << hex::to_hex0x32(v1_u) << ' ' << op;
+    os << "// pc += ("
+       << hex::to_hex0x32(v1_u) << ' ' << op;
     if (is_unsigned)
-        *pos << 'U';
-    *pos << ' ' << hex::to_hex0x32(v2_u)
-         << " ? " << hex::to_hex0x32(offset)
-         << " : 4) = "
-         << hex::to_hex0x32(take ? target : fallthrough);
+        os << 'U';
+    os << ' ' << hex::to_hex0x32(v2_u)
+       << " ? " << hex::to_hex0x32(offset)
+       << " : 4) = "
+       << hex::to_hex0x32(take ? target : fallthrough);
 }
 
 //******************************************************************************
@@ -439,122 +702,134 @@ static void branch_comment(ostream *pos,
 // to the next sequential instruction.
 // 
 // Parameters:
-//   insn - the 32-bit encoded instruction being executed
-//   pos  - optional ostream for printing execution trace comments
+//   d    - the predecoded instruction being executed
+//   trace - (template) true to print the trace comment
 //
 // Return value:
 //   None
 //******************************************************************************
 
-void rv32i_hart::exec_beq(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_beq(const predecoded &d)
 {
-    uint32_t rs1       = get_rs1(insn);
-    uint32_t rs2       = get_rs2(insn);
+    uint32_t rs1       = d.rs1;
+    uint32_t rs2       = d.rs2;
     uint32_t pc_before = pc;
-    int32_t imm_b      = get_imm_b(insn);
+    int32_t imm_b      = d.imm;
 
     int32_t v1 = regs.get(rs1);
     int32_t v2 = regs.get(rs2);
     bool take = (v1 == v2);
 
-    branch_comment(pos, "==", false, pc_before, imm_b,
-                   static_cast<uint32_t>(v1),
-                   static_cast<uint32_t>(v2),
-                   take);
+    if constexpr (trace)
+        branch_comment(*trace_out, "==", false, pc_before, imm_b,
+                       static_cast<uint32_t>(v1),
+                       static_cast<uint32_t>(v2),
+                       take);
 
     pc = take ? pc_before + static_cast<uint32_t>(imm_b)
               : pc_before + 4;
 }
 
-void rv32i_hart::exec_bne(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_bne(const predecoded &d)
 {
-    uint32_t rs1       = get_rs1(insn);
-    uint32_t rs2       = get_rs2(insn);
+    uint32_t rs1       = d.rs1;
+    uint32_t rs2       = d.rs2;
     uint32_t pc_before = pc;
-    int32_t imm_b      = get_imm_b(insn);
+    int32_t imm_b      = d.imm;
 
     int32_t v1 = regs.get(rs1);
     int32_t v2 = regs.get(rs2);
     bool take = (v1 != v2);
 
-    branch_comment(pos, "!=", false, pc_before, imm_b,
-                   static_cast<uint32_t>(v1),
-                   static_cast<uint32_t>(v2),
-                   take);
+    if constexpr (trace)
+        branch_comment(*trace_out, "!=", false, pc_before, imm_b,
+                       static_cast<uint32_t>(v1),
+                       static_cast<uint32_t>(v2),
+                       take);
 
     pc = take ? pc_before + static_cast<uint32_t>(imm_b)
               : pc_before + 4;
 }
 
-void rv32i_hart::exec_blt(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_blt(const predecoded &d)
 {
-    uint32_t rs1       = get_rs1(insn);
-    uint32_t rs2       = get_rs2(insn);
+    uint32_t rs1       = d.rs1;
+    uint32_t rs2       = d.rs2;
     uint32_t pc_before = pc;
-    int32_t imm_b      = get_imm_b(insn);
+    int32_t imm_b      = d.imm;
 
     int32_t v1 = regs.get(rs1);
     int32_t v2 = regs.get(rs2);
     bool take = (v1 < v2);
 
-    branch_comment(pos, "<", false, pc_before, imm_b,
-                   static_cast<uint32_t>(v1),
-                   static_cast<uint32_t>(v2),
-                   take);
+    if constexpr (trace)
+        branch_comment(*trace_out, "<", false, pc_before, imm_b,
+                       static_cast<uint32_t>(v1),
+                       static_cast<uint32_t>(v2),
+                       take);
 
     pc = take ? pc_before + static_cast<uint32_t>(imm_b)
               : pc_before + 4;
 }
 
-void rv32i_hart::exec_bge(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_bge(const predecoded &d)
 {
-    uint32_t rs1       = get_rs1(insn);
-    uint32_t rs2       = get_rs2(insn);
+    uint32_t rs1       = d.rs1;
+    uint32_t rs2       = d.rs2;
     uint32_t pc_before = pc;
-    int32_t imm_b      = get_imm_b(insn);
+    int32_t imm_b      = d.imm;
 
     int32_t v1 = regs.get(rs1);
     int32_t v2 = regs.get(rs2);
     bool take = (v1 >= v2);
 
-    branch_comment(pos, ">=", false, pc_before, imm_b,
-                   static_cast<uint32_t>(v1),
-                   static_cast<uint32_t>(v2),
-                   take);
+    if constexpr (trace)
+        branch_comment(*trace_out, ">=", false, pc_before, imm_b,
+                       static_cast<uint32_t>(v1),
+                       static_cast<uint32_t>(v2),
+                       take);
 
     pc = take ? pc_before + static_cast<uint32_t>(imm_b)
               : pc_before + 4;
 }
 
-void rv32i_hart::exec_bltu(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_bltu(const predecoded &d)
 {
-    uint32_t rs1       = get_rs1(insn);
-    uint32_t rs2       = get_rs2(insn);
+    uint32_t rs1       = d.rs1;
+    uint32_t rs2       = d.rs2;
     uint32_t pc_before = pc;
-    int32_t imm_b      = get_imm_b(insn);
+    int32_t imm_b      = d.imm;
 
     uint32_t v1 = static_cast<uint32_t>(regs.get(rs1));
     uint32_t v2 = static_cast<uint32_t>(regs.get(rs2));
     bool take = (v1 < v2);
 
-    branch_comment(pos, "<", true, pc_before, imm_b, v1, v2, take);
+    if constexpr (trace)
+        branch_comment(*trace_out, "<", true, pc_before, imm_b, v1, v2, take);
 
     pc = take ? pc_before + static_cast<uint32_t>(imm_b)
               : pc_before + 4;
 }
 
-void rv32i_hart::exec_bgeu(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_bgeu(const predecoded &d)
 {
-    uint32_t rs1       = get_rs1(insn);
-    uint32_t rs2       = get_rs2(insn);
+    uint32_t rs1       = d.rs1;
+    uint32_t rs2       = d.rs2;
     uint32_t pc_before = pc;
-    int32_t imm_b      = get_imm_b(insn);
+    int32_t imm_b      = d.imm;
 
     uint32_t v1 = static_cast<uint32_t>(regs.get(rs1));
     uint32_t v2 = static_cast<uint32_t>(regs.get(rs2));
     bool take = (v1 >= v2);
 
-    branch_comment(pos, ">=", true, pc_before, imm_b, v1, v2, take);
+    if constexpr (trace)
+        branch_comment(*trace_out, ">=", true, pc_before, imm_b, v1, v2, take);
 
     pc = take ? pc_before + static_cast<uint32_t>(imm_b)
               : pc_before + 4;
@@ -568,119 +843,124 @@ void rv32i_hart::exec_bgeu(uint32_t insn, ostream *pos)
 // resulting value into rd.
 // 
 // Parameters:
-//   insn - the 32-bit load instruction to execute
-//   pos  - optional ostream for writing formatted trace comments
+//   d    - the predecoded load instruction to execute
+//   trace - (template) true to print the trace comment
 //
 // Return value:
 //   None
 //******************************************************************************
 
-void rv32i_hart::exec_lb(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_lb(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t rs1  = get_rs1(insn);
-    int32_t imm_i = get_imm_i(insn);
+    uint32_t rd   = d.rd;
+    uint32_t rs1  = d.rs1;
+    int32_t imm_i = d.imm;
 
     uint32_t base = static_cast<uint32_t>(regs.get(rs1));
     uint32_t addr = base + static_cast<uint32_t>(imm_i);
     int32_t val   = mem.get8_sx(addr);
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd
-             << " = sx(m8(" << hex::to_hex0x32(base)
-             << " + "       << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
-             << ")) = "     << hex::to_hex0x32(static_cast<uint32_t>(val));
+        *trace_out << "// x" << rd
+                   << " = sx(m8(" << hex::to_hex0x32(base)
+                   << " + "       << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
+                   << ")) = "     << hex::to_hex0x32(static_cast<uint32_t>(val));
     }
 
     regs.set(rd, val);
     pc += 4;
 }
 
-void rv32i_hart::exec_lh(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_lh(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t rs1  = get_rs1(insn);
-    int32_t imm_i = get_imm_i(insn);
+    uint32_t rd   = d.rd;
+    uint32_t rs1  = d.rs1;
+    int32_t imm_i = d.imm;
 
     uint32_t base = static_cast<uint32_t>(regs.get(rs1));
     uint32_t addr = base + static_cast<uint32_t>(imm_i);
     int32_t val   = mem.get16_sx(addr);
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd
-             << " = sx(m16(" << hex::to_hex0x32(base)
-             << " + "        << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
-             << ")) = "      << hex::to_hex0x32(static_cast<uint32_t>(val));
+        *trace_out << "// x" << rd
+                   << " = sx(m16(" << hex::to_hex0x32(base)
+                   << " + "        << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
+                   << ")) = "      << hex::to_hex0x32(static_cast<uint32_t>(val));
     }
 
     regs.set(rd, val);
     pc += 4;
 }
 
-void rv32i_hart::exec_lw(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_lw(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t rs1  = get_rs1(insn);
-    int32_t imm_i = get_imm_i(insn);
+    uint32_t rd   = d.rd;
+    uint32_t rs1  = d.rs1;
+    int32_t imm_i = d.imm;
 
     uint32_t base = static_cast<uint32_t>(regs.get(rs1));
     uint32_t addr = base + static_cast<uint32_t>(imm_i);
     int32_t val   = mem.get32_sx(addr);
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd
-             << " = sx(m32(" << hex::to_hex0x32(base)
-             << " + "        << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
-             << ")) = "      << hex::to_hex0x32(static_cast<uint32_t>(val));
+        *trace_out << "// x" << rd
+                   << " = sx(m32(" << hex::to_hex0x32(base)
+                   << " + "        << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
+                   << ")) = "      << hex::to_hex0x32(static_cast<uint32_t>(val));
     }
 
     regs.set(rd, val);
     pc += 4;
 }
 
-void rv32i_hart::exec_lbu(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_lbu(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t rs1  = get_rs1(insn);
-    int32_t imm_i = get_imm_i(insn);
+    uint32_t rd   = d.rd;
+    uint32_t rs1  = d.rs1;
+    int32_t imm_i = d.imm;
 
     uint32_t base = static_cast<uint32_t>(regs.get(rs1));
     uint32_t addr = base + static_cast<uint32_t>(imm_i);
     uint8_t  b    = mem.get8(addr);
     uint32_t val  = static_cast<uint32_t>(b);
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd
-             << " = zx(m8(" << hex::to_hex0x32(base)
-             << " + "        << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
-             << ")) = "      << hex::to_hex0x32(val);
+        *trace_out << "// x" << rd
+                   << " = zx(m8(" << hex::to_hex0x32(base)
+                   << " + "        << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
+                   << ")) = "      << hex::to_hex0x32(val);
     }
 
     regs.set(rd, static_cast<int32_t>(val));
     pc += 4;
 }
 
-void rv32i_hart::exec_lhu(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_lhu(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t rs1  = get_rs1(insn);
-    int32_t imm_i = get_imm_i(insn);
+    uint32_t rd   = d.rd;
+    uint32_t rs1  = d.rs1;
+    int32_t imm_i = d.imm;
 
     uint32_t base = static_cast<uint32_t>(regs.get(rs1));
     uint32_t addr = base + static_cast<uint32_t>(imm_i);
     uint16_t h    = mem.get16(addr);
     uint32_t val  = static_cast<uint32_t>(h);
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd
-             << " = zx(m16(" << hex::to_hex0x32(base)
-             << " + "         << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
-             << ")) = "       << hex::to_hex0x32(val);
+        *trace_out << "// x" << rd
+                   << " = zx(m16(" << hex::to_hex0x32(base)
+                   << " + "         << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
+                   << ")) = "       << hex::to_hex0x32(val);
     }
 
     regs.set(rd, static_cast<int32_t>(val));
@@ -695,73 +975,79 @@ void rv32i_hart::exec_lhu(uint32_t insn, ostream *pos)
 // address.
 // 
 // Parameters:
-//   insn - the 32-bit store instruction being executed
-//   pos  - optional ostream for trace output
+//   d    - the predecoded store instruction being executed
+//   trace - (template) true to print the trace comment
 //
 // Return value:
 //   None
 //******************************************************************************
 
-void rv32i_hart::exec_sb(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_sb(const predecoded &d)
 {
-    uint32_t rs1  = get_rs1(insn);
-    uint32_t rs2  = get_rs2(insn);
-    int32_t imm_s = get_imm_s(insn);
+    uint32_t rs1  = d.rs1;
+    uint32_t rs2  = d.rs2;
+    int32_t imm_s = d.imm;
 
     uint32_t base = static_cast<uint32_t>(regs.get(rs1));
     uint32_t addr = base + static_cast<uint32_t>(imm_s);
     uint32_t val  = static_cast<uint32_t>(regs.get(rs2)) & 0xffu;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// m8(" << hex::to_hex0x32(base)
-             << " + "     << hex::to_hex0x32(static_cast<uint32_t>(imm_s))
-             << ") = "    << hex::to_hex0x32(val);
+        *trace_out << "// m8(" << hex::to_hex0x32(base)
+                   << " + "     << hex::to_hex0x32(static_cast<uint32_t>(imm_s))
+                   << ") = "    << hex::to_hex0x32(val);
     }
 
     mem.set8(addr, static_cast<uint8_t>(val));
+    invalidate(addr, 1);
     pc += 4;
 }
 
-void rv32i_hart::exec_sh(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_sh(const predecoded &d)
 {
-    uint32_t rs1  = get_rs1(insn);
-    uint32_t rs2  = get_rs2(insn);
-    int32_t imm_s = get_imm_s(insn);
+    uint32_t rs1  = d.rs1;
+    uint32_t rs2  = d.rs2;
+    int32_t imm_s = d.imm;
 
     uint32_t base = static_cast<uint32_t>(regs.get(rs1));
     uint32_t addr = base + static_cast<uint32_t>(imm_s);
     uint32_t val  = static_cast<uint32_t>(regs.get(rs2)) & 0xffffu;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// m16(" << hex::to_hex0x32(base)
-             << " + "      << hex::to_hex0x32(static_cast<uint32_t>(imm_s))
-             << ") = "     << hex::to_hex0x32(val);
+        *trace_out << "// m16(" << hex::to_hex0x32(base)
+                   << " + "      << hex::to_hex0x32(static_cast<uint32_t>(imm_s))
+                   << ") = "     << hex::to_hex0x32(val);
     }
 
     mem.set16(addr, static_cast<uint16_t>(val));
+    invalidate(addr, 2);
     pc += 4;
 }
 
-void rv32i_hart::exec_sw(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_sw(const predecoded &d)
 {
-    uint32_t rs1  = get_rs1(insn);
-    uint32_t rs2  = get_rs2(insn);
-    int32_t imm_s = get_imm_s(insn);
+    uint32_t rs1  = d.rs1;
+    uint32_t rs2  = d.rs2;
+    int32_t imm_s = d.imm;
 
     uint32_t base = static_cast<uint32_t>(regs.get(rs1));
     uint32_t addr = base + static_cast<uint32_t>(imm_s);
     uint32_t val  = static_cast<uint32_t>(regs.get(rs2));
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// m32(" << hex::to_hex0x32(base)
-             << " + "      << hex::to_hex0x32(static_cast<uint32_t>(imm_s))
-             << ") = "     << hex::to_hex0x32(val);
+        *trace_out << "// m32(" << hex::to_hex0x32(base)
+                   << " + "      << hex::to_hex0x32(static_cast<uint32_t>(imm_s))
+                   << ") = "     << hex::to_hex0x32(val);
     }
 
     mem.set32(addr, val);
+    invalidate(addr, 4);
     pc += 4;
 }
 
@@ -772,207 +1058,216 @@ void rv32i_hart::exec_sw(uint32_t insn, ostream *pos)
 // (or shift amount), then store the result into rd.
 // 
 // Parameters:
-//   insn - the 32-bit ALU-immediate instruction
-//   pos  - optional ostream for trace comments
+//   d    - the predecoded ALU-immediate instruction
+//   trace - (template) true to print the trace comment
 //
 // Return value:
 //   None
 //******************************************************************************
 
-void rv32i_hart::exec_addi(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_addi(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t rs1  = get_rs1(insn);
-    int32_t imm_i = get_imm_i(insn);
+    uint32_t rd   = d.rd;
+    uint32_t rs1  = d.rs1;
+    int32_t imm_i = d.imm;
 
     int32_t v1  = regs.get(rs1);
     int32_t res = v1 + imm_i;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(static_cast<uint32_t>(v1))
-             << " + " << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
-             << " = " << hex::to_hex0x32(static_cast<uint32_t>(res));
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(static_cast<uint32_t>(v1))
+                   << " + " << hex::to_hex0x32(static_cast<uint32_t>(imm_i))
+                   << " = " << hex::to_hex0x32(static_cast<uint32_t>(res));
     }
 
     regs.set(rd, res);
     pc += 4;
 }
 
-void rv32i_hart::exec_slti(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_slti(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t rs1  = get_rs1(insn);
-    int32_t imm_i = get_imm_i(insn);
+    uint32_t rd   = d.rd;
+    uint32_t rs1  = d.rs1;
+    int32_t imm_i = d.imm;
 
     int32_t v1   = regs.get(rs1);
     bool cond    = (v1 < imm_i);
     int32_t res  = cond ? 1 : 0;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = ("
-             << hex::to_hex0x32(static_cast<uint32_t>(v1))
-             << " < " << imm_i
-             << ") ? 1 : 0 = "
-             << hex::to_hex0x32(static_cast<uint32_t>(res));
+        *trace_out << "// x" << rd << " = ("
+                   << hex::to_hex0x32(static_cast<uint32_t>(v1))
+                   << " < " << imm_i
+                   << ") ? 1 : 0 = "
+                   << hex::to_hex0x32(static_cast<uint32_t>(res));
     }
 
     regs.set(rd, res);
     pc += 4;
 }
 
-void rv32i_hart::exec_sltiu(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_sltiu(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t rs1  = get_rs1(insn);
-    int32_t imm_i = get_imm_i(insn);
+    uint32_t rd   = d.rd;
+    uint32_t rs1  = d.rs1;
+    int32_t imm_i = d.imm;
 
     uint32_t v1  = static_cast<uint32_t>(regs.get(rs1));
     uint32_t uimm = static_cast<uint32_t>(imm_i);
     bool cond    = (v1 < uimm);
     int32_t res  = cond ? 1 : 0;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = ("
-             << hex::to_hex0x32(v1)
-             << " <U " << imm_i
-             << ") ? 1 : 0 = "
-             << hex::to_hex0x32(static_cast<uint32_t>(res));
+        *trace_out << "// x" << rd << " = ("
+                   << hex::to_hex0x32(v1)
+                   << " <U " << imm_i
+                   << ") ? 1 : 0 = "
+                   << hex::to_hex0x32(static_cast<uint32_t>(res));
     }
 
     regs.set(rd, res);
     pc += 4;
 }
 
-void rv32i_hart::exec_xori(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_xori(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t rs1  = get_rs1(insn);
-    int32_t imm_i = get_imm_i(insn);
+    uint32_t rd   = d.rd;
+    uint32_t rs1  = d.rs1;
+    int32_t imm_i = d.imm;
 
     uint32_t v1   = static_cast<uint32_t>(regs.get(rs1));
     uint32_t uimm = static_cast<uint32_t>(imm_i);
     uint32_t res  = v1 ^ uimm;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(v1)
-             << " ^ " << hex::to_hex0x32(uimm)
-             << " = " << hex::to_hex0x32(res);
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(v1)
+                   << " ^ " << hex::to_hex0x32(uimm)
+                   << " = " << hex::to_hex0x32(res);
     }
 
     regs.set(rd, static_cast<int32_t>(res));
     pc += 4;
 }
 
-void rv32i_hart::exec_ori(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_ori(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t rs1  = get_rs1(insn);
-    int32_t imm_i = get_imm_i(insn);
+    uint32_t rd   = d.rd;
+    uint32_t rs1  = d.rs1;
+    int32_t imm_i = d.imm;
 
     uint32_t v1   = static_cast<uint32_t>(regs.get(rs1));
     uint32_t uimm = static_cast<uint32_t>(imm_i);
     uint32_t res  = v1 | uimm;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(v1)
-             << " | " << hex::to_hex0x32(uimm)
-             << " = " << hex::to_hex0x32(res);
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(v1)
+                   << " | " << hex::to_hex0x32(uimm)
+                   << " = " << hex::to_hex0x32(res);
     }
 
     regs.set(rd, static_cast<int32_t>(res));
     pc += 4;
 }
 
-void rv32i_hart::exec_andi(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_andi(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t rs1  = get_rs1(insn);
-    int32_t imm_i = get_imm_i(insn);
+    uint32_t rd   = d.rd;
+    uint32_t rs1  = d.rs1;
+    int32_t imm_i = d.imm;
 
     uint32_t v1   = static_cast<uint32_t>(regs.get(rs1));
     uint32_t uimm = static_cast<uint32_t>(imm_i);
     uint32_t res  = v1 & uimm;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(v1)
-             << " & " << hex::to_hex0x32(uimm)
-             << " = " << hex::to_hex0x32(res);
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(v1)
+                   << " & " << hex::to_hex0x32(uimm)
+                   << " = " << hex::to_hex0x32(res);
     }
 
     regs.set(rd, static_cast<int32_t>(res));
     pc += 4;
 }
 
-void rv32i_hart::exec_slli(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_slli(const predecoded &d)
 {
-    uint32_t rd    = get_rd(insn);
-    uint32_t rs1   = get_rs1(insn);
-    int32_t imm_i  = get_imm_i(insn);
+    uint32_t rd    = d.rd;
+    uint32_t rs1   = d.rs1;
+    int32_t imm_i  = d.imm;
     uint32_t shamt = static_cast<uint32_t>(imm_i) & 0x1f;
 
     uint32_t v1  = static_cast<uint32_t>(regs.get(rs1));
     uint32_t res = v1 << shamt;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(v1)
-             << " << " << shamt
-             << " = " << hex::to_hex0x32(res);
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(v1)
+                   << " << " << shamt
+                   << " = " << hex::to_hex0x32(res);
     }
 
     regs.set(rd, static_cast<int32_t>(res));
     pc += 4;
 }
 
-void rv32i_hart::exec_srli(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_srli(const predecoded &d)
 {
-    uint32_t rd    = get_rd(insn);
-    uint32_t rs1   = get_rs1(insn);
-    int32_t imm_i  = get_imm_i(insn);
+    uint32_t rd    = d.rd;
+    uint32_t rs1   = d.rs1;
+    int32_t imm_i  = d.imm;
     uint32_t shamt = static_cast<uint32_t>(imm_i) & 0x1f;
 
     uint32_t v1  = static_cast<uint32_t>(regs.get(rs1));
     uint32_t res = v1 >> shamt;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(v1)
-             << " >> " << shamt
-             << " = " << hex::to_hex0x32(res);
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(v1)
+                   << " >> " << shamt
+                   << " = " << hex::to_hex0x32(res);
     }
 
     regs.set(rd, static_cast<int32_t>(res));
     pc += 4;
 }
 
-void rv32i_hart::exec_srai(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_srai(const predecoded &d)
 {
-    uint32_t rd    = get_rd(insn);
-    uint32_t rs1   = get_rs1(insn);
-    int32_t imm_i  = get_imm_i(insn);
+    uint32_t rd    = d.rd;
+    uint32_t rs1   = d.rs1;
+    int32_t imm_i  = d.imm;
     uint32_t shamt = static_cast<uint32_t>(imm_i) & 0x1f;
 
     int32_t v1  = regs.get(rs1);
     int32_t res = v1 >> shamt;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(static_cast<uint32_t>(v1))
-             << " >> " << shamt
-             << " = " << hex::to_hex0x32(static_cast<uint32_t>(res));
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(static_cast<uint32_t>(v1))
+                   << " >> " << shamt
+                   << " = " << hex::to_hex0x32(static_cast<uint32_t>(res));
     }
 
     regs.set(rd, res);
@@ -986,231 +1281,241 @@ void rv32i_hart::exec_srai(uint32_t insn, ostream *pos)
 // the result into rd.
 // 
 // Parameters:
-//   insn - the 32-bit R-type instruction being executed
-//   pos  - optional ostream for trace output
+//   d    - the predecoded R-type instruction being executed
+//   trace - (template) true to print the trace comment
 //
 // Return value:
 //   None
 //******************************************************************************
 
-void rv32i_hart::exec_add(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_add(const predecoded &d)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-    uint32_t rs2 = get_rs2(insn);
+    uint32_t rd  = d.rd;
+    uint32_t rs1 = d.rs1;
+    uint32_t rs2 = d.rs2;
 
     int32_t v1  = regs.get(rs1);
     int32_t v2  = regs.get(rs2);
     int32_t res = v1 + v2;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(static_cast<uint32_t>(v1))
-             << " + " << hex::to_hex0x32(static_cast<uint32_t>(v2))
-             << " = " << hex::to_hex0x32(static_cast<uint32_t>(res));
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(static_cast<uint32_t>(v1))
+                   << " + " << hex::to_hex0x32(static_cast<uint32_t>(v2))
+                   << " = " << hex::to_hex0x32(static_cast<uint32_t>(res));
     }
 
     regs.set(rd, res);
     pc += 4;
 }
 
-void rv32i_hart::exec_sub(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_sub(const predecoded &d)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-    uint32_t rs2 = get_rs2(insn);
+    uint32_t rd  = d.rd;
+    uint32_t rs1 = d.rs1;
+    uint32_t rs2 = d.rs2;
 
     int32_t v1  = regs.get(rs1);
     int32_t v2  = regs.get(rs2);
     int32_t res = v1 - v2;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(static_cast<uint32_t>(v1))
-             << " - " << hex::to_hex0x32(static_cast<uint32_t>(v2))
-             << " = " << hex::to_hex0x32(static_cast<uint32_t>(res));
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(static_cast<uint32_t>(v1))
+                   << " - " << hex::to_hex0x32(static_cast<uint32_t>(v2))
+                   << " = " << hex::to_hex0x32(static_cast<uint32_t>(res));
     }
 
     regs.set(rd, res);
     pc += 4;
 }
 
-void rv32i_hart::exec_sll(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_sll(const predecoded &d)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-    uint32_t rs2 = get_rs2(insn);
+    uint32_t rd  = d.rd;
+    uint32_t rs1 = d.rs1;
+    uint32_t rs2 = d.rs2;
 
     uint32_t v1   = static_cast<uint32_t>(regs.get(rs1));
     uint32_t shamt = static_cast<uint32_t>(regs.get(rs2)) & 0x1f;
     uint32_t res  = v1 << shamt;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(v1)
-             << " << " << shamt
-             << " = " << hex::to_hex0x32(res);
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(v1)
+                   << " << " << shamt
+                   << " = " << hex::to_hex0x32(res);
     }
 
     regs.set(rd, static_cast<int32_t>(res));
     pc += 4;
 }
 
-void rv32i_hart::exec_slt(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_slt(const predecoded &d)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-    uint32_t rs2 = get_rs2(insn);
+    uint32_t rd  = d.rd;
+    uint32_t rs1 = d.rs1;
+    uint32_t rs2 = d.rs2;
 
     int32_t v1   = regs.get(rs1);
     int32_t v2   = regs.get(rs2);
     bool cond    = (v1 < v2);
     int32_t res  = cond ? 1 : 0;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = ("
-             << hex::to_hex0x32(static_cast<uint32_t>(v1))
-             << " < " << hex::to_hex0x32(static_cast<uint32_t>(v2))
-             << ") ? 1 : 0 = "
-             << hex::to_hex0x32(static_cast<uint32_t>(res));
+        *trace_out << "// x" << rd << " = ("
+                   << hex::to_hex0x32(static_cast<uint32_t>(v1))
+                   << " < " << hex::to_hex0x32(static_cast<uint32_t>(v2))
+                   << ") ? 1 : 0 = "
+                   << hex::to_hex0x32(static_cast<uint32_t>(res));
     }
 
     regs.set(rd, res);
     pc += 4;
 }
 
-void rv32i_hart::exec_sltu(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_sltu(const predecoded &d)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-    uint32_t rs2 = get_rs2(insn);
+    uint32_t rd  = d.rd;
+    uint32_t rs1 = d.rs1;
+    uint32_t rs2 = d.rs2;
 
     uint32_t v1  = static_cast<uint32_t>(regs.get(rs1));
     uint32_t v2  = static_cast<uint32_t>(regs.get(rs2));
     bool cond    = (v1 < v2);
     int32_t res  = cond ? 1 : 0;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = ("
-             << hex::to_hex0x32(v1)
-             << " <U " << hex::to_hex0x32(v2)
-             << ") ? 1 : 0 = "
-             << hex::to_hex0x32(static_cast<uint32_t>(res));
+        *trace_out << "// x" << rd << " = ("
+                   << hex::to_hex0x32(v1)
+                   << " <U " << hex::to_hex0x32(v2)
+                   << ") ? 1 : 0 = "
+                   << hex::to_hex0x32(static_cast<uint32_t>(res));
     }
 
     regs.set(rd, res);
     pc += 4;
 }
 
-void rv32i_hart::exec_xor(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_xor(const predecoded &d)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-    uint32_t rs2 = get_rs2(insn);
+    uint32_t rd  = d.rd;
+    uint32_t rs1 = d.rs1;
+    uint32_t rs2 = d.rs2;
 
     uint32_t v1  = static_cast<uint32_t>(regs.get(rs1));
     uint32_t v2  = static_cast<uint32_t>(regs.get(rs2));
     uint32_t res = v1 ^ v2;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(v1)
-             << " ^ " << hex::to_hex0x32(v2)
-             << " = " << hex::to_hex0x32(res);
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(v1)
+                   << " ^ " << hex::to_hex0x32(v2)
+                   << " = " << hex::to_hex0x32(res);
     }
 
     regs.set(rd, static_cast<int32_t>(res));
     pc += 4;
 }
 
-void rv32i_hart::exec_srl(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_srl(const predecoded &d)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-    uint32_t rs2 = get_rs2(insn);
+    uint32_t rd  = d.rd;
+    uint32_t rs1 = d.rs1;
+    uint32_t rs2 = d.rs2;
 
     uint32_t v1   = static_cast<uint32_t>(regs.get(rs1));
     uint32_t shamt = static_cast<uint32_t>(regs.get(rs2)) & 0x1f;
     uint32_t res  = v1 >> shamt;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(v1)
-             << " >> " << shamt
-             << " = " << hex::to_hex0x32(res);
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(v1)
+                   << " >> " << shamt
+                   << " = " << hex::to_hex0x32(res);
     }
 
     regs.set(rd, static_cast<int32_t>(res));
     pc += 4;
 }
 
-void rv32i_hart::exec_sra(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_sra(const predecoded &d)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-    uint32_t rs2 = get_rs2(insn);
+    uint32_t rd  = d.rd;
+    uint32_t rs1 = d.rs1;
+    uint32_t rs2 = d.rs2;
 
     int32_t v1    = regs.get(rs1);
     uint32_t shamt = static_cast<uint32_t>(regs.get(rs2)) & 0x1f;
     int32_t res   = v1 >> shamt;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(static_cast<uint32_t>(v1))
-             << " >> " << shamt
-             << " = " << hex::to_hex0x32(static_cast<uint32_t>(res));
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(static_cast<uint32_t>(v1))
+                   << " >> " << shamt
+                   << " = " << hex::to_hex0x32(static_cast<uint32_t>(res));
     }
 
     regs.set(rd, res);
     pc += 4;
 }
 
-void rv32i_hart::exec_or(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_or(const predecoded &d)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-    uint32_t rs2 = get_rs2(insn);
+    uint32_t rd  = d.rd;
+    uint32_t rs1 = d.rs1;
+    uint32_t rs2 = d.rs2;
 
     uint32_t v1  = static_cast<uint32_t>(regs.get(rs1));
     uint32_t v2  = static_cast<uint32_t>(regs.get(rs2));
     uint32_t res = v1 | v2;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(v1)
-             << " | " << hex::to_hex0x32(v2)
-             << " = " << hex::to_hex0x32(res);
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(v1)
+                   << " | " << hex::to_hex0x32(v2)
+                   << " = " << hex::to_hex0x32(res);
     }
 
     regs.set(rd, static_cast<int32_t>(res));
     pc += 4;
 }
 
-void rv32i_hart::exec_and(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_and(const predecoded &d)
 {
-    uint32_t rd  = get_rd(insn);
-    uint32_t rs1 = get_rs1(insn);
-    uint32_t rs2 = get_rs2(insn);
+    uint32_t rd  = d.rd;
+    uint32_t rs1 = d.rs1;
+    uint32_t rs2 = d.rs2;
 
     uint32_t v1  = static_cast<uint32_t>(regs.get(rs1));
     uint32_t v2  = static_cast<uint32_t>(regs.get(rs2));
     uint32_t res = v1 & v2;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = "
-             << hex::to_hex0x32(v1)
-             << " & " << hex::to_hex0x32(v2)
-             << " = " << hex::to_hex0x32(res);
+        *trace_out << "// x" << rd << " = "
+                   << hex::to_hex0x32(v1)
+                   << " & " << hex::to_hex0x32(v2)
+                   << " = " << hex::to_hex0x32(res);
     }
 
     regs.set(rd, static_cast<int32_t>(res));
@@ -1223,151 +1528,124 @@ void rv32i_hart::exec_and(uint32_t insn, ostream *pos)
 // EBREAK, and the CSR (Control and Status Register) read/modify/write family.
 // 
 // Parameters:
-//   insn - the 32-bit SYSTEM or CSR instruction to execute
-//   pos  - optional ostream for printing execution trace comments
+//   d    - the predecoded SYSTEM or CSR instruction to execute
+//   trace - (template) true to print the trace comment
 //
 // Return value:
 //   None
 //******************************************************************************
 
 
-void rv32i_hart::exec_system(uint32_t insn, ostream *pos)
-{
-    uint32_t f3 = get_funct3(insn);
-
-    if (f3 == 0)
-    {
-        // ecall / ebreak
-        if (insn == 0x00000073)
-            exec_ecall(insn, pos);
-        else if (insn == 0x00100073)
-            exec_ebreak(insn, pos);
-        else
-            exec_illegal_insn(insn, pos);
-    }
-    else
-    {
-        switch (f3)
-        {
-            case funct3_csrrw:  exec_csrrw(insn, pos);  break;
-            case funct3_csrrs:  exec_csrrs(insn, pos);  break;
-            case funct3_csrrc:  exec_csrrc(insn, pos);  break;
-            case funct3_csrrwi: exec_csrrwi(insn, pos); break;
-            case funct3_csrrsi: exec_csrrsi(insn, pos); break;
-            case funct3_csrrci: exec_csrrci(insn, pos); break;
-            default:            exec_illegal_insn(insn, pos); break;
-        }
-    }
-}
-
-void rv32i_hart::exec_ecall(uint32_t, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_ecall(const predecoded &)
 {
-    if (pos)
-        *pos << "// ECALL";
+    if constexpr (trace)
+        *trace_out << "// ECALL";
     halt = true;
     halt_reason = "ECALL instruction";
 }
 
-void rv32i_hart::exec_ebreak(uint32_t, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_ebreak(const predecoded &)
 {
-    if (pos)
-        *pos << "// HALT";
+    if constexpr (trace)
+        *trace_out << "// HALT";
     halt = true;
     halt_reason = "EBREAK instruction";
 }
 
-void rv32i_hart::exec_csrrw(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_csrrw(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t rs1  = get_rs1(insn);
-    uint32_t csr  = get_imm_i(insn) & 0xfff;
+    uint32_t rd   = d.rd;
+    uint32_t rs1  = d.rs1;
+    uint32_t csr  = d.imm & 0xfff;
 
     uint32_t rs1_val = static_cast<uint32_t>(regs.get(rs1));
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = 0";
+        *trace_out << "// x" << rd << " = " << csr_value(csr);
     }
 
-    regs.set(rd, 0);
+    regs.set(rd, static_cast<int32_t>(csr_value(csr)));
 
-    (void)csr;
     (void)rs1_val;
 
     pc += 4;
 }
 
-void rv32i_hart::exec_csrrs(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_csrrs(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t csr  = get_imm_i(insn) & 0xfff;
+    uint32_t rd   = d.rd;
+    uint32_t csr  = d.imm & 0xfff;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = 0";
+        *trace_out << "// x" << rd << " = " << csr_value(csr);
     }
 
-    regs.set(rd, 0);
-    (void)csr;
+    regs.set(rd, static_cast<int32_t>(csr_value(csr)));
     pc += 4;
 }
 
-void rv32i_hart::exec_csrrc(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_csrrc(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t csr  = get_imm_i(insn) & 0xfff;
+    uint32_t rd   = d.rd;
+    uint32_t csr  = d.imm & 0xfff;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = 0";
+        *trace_out << "// x" << rd << " = " << csr_value(csr);
     }
 
-    regs.set(rd, 0);
-    (void)csr;
+    regs.set(rd, static_cast<int32_t>(csr_value(csr)));
     pc += 4;
 }
 
-void rv32i_hart::exec_csrrwi(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_csrrwi(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t csr  = get_imm_i(insn) & 0xfff;
+    uint32_t rd   = d.rd;
+    uint32_t csr  = d.imm & 0xfff;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = 0";
+        *trace_out << "// x" << rd << " = " << csr_value(csr);
     }
 
-    regs.set(rd, 0);
-    (void)csr;
+    regs.set(rd, static_cast<int32_t>(csr_value(csr)));
     pc += 4;
 }
 
-void rv32i_hart::exec_csrrsi(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_csrrsi(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t csr  = get_imm_i(insn) & 0xfff;
+    uint32_t rd   = d.rd;
+    uint32_t csr  = d.imm & 0xfff;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = 0";
+        *trace_out << "// x" << rd << " = " << csr_value(csr);
     }
 
-    regs.set(rd, 0);
-    (void)csr;
+    regs.set(rd, static_cast<int32_t>(csr_value(csr)));
     pc += 4;
 }
 
-void rv32i_hart::exec_csrrci(uint32_t insn, ostream *pos)
+template<bool trace>
+void rv32i_hart::exec_csrrci(const predecoded &d)
 {
-    uint32_t rd   = get_rd(insn);
-    uint32_t csr  = get_imm_i(insn) & 0xfff;
+    uint32_t rd   = d.rd;
+    uint32_t csr  = d.imm & 0xfff;
 
-    if (pos)
+    if constexpr (trace)
     {
-        *pos << "// x" << rd << " = 0";
+        *trace_out << "// x" << rd << " = " << csr_value(csr);
     }
 
-    regs.set(rd, 0);
-    (void)csr;
+    regs.set(rd, static_cast<int32_t>(csr_value(csr)));
     pc += 4;
 }
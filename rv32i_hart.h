@@ -11,12 +11,20 @@
 #pragma once
 
 #include <cstdint>
+#include <iostream>
 #include <string>
-#include <ostream>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <unordered_map>
 
 #include "rv32i_decode.h"
 #include "memory.h"
 #include "registerfile.h"
+#include "render_cache.h"
+#include "jit_buffer.h"
+#include "trace_record.h"
+#include "code_watch.h"
 
 using namespace std;
 
@@ -44,6 +52,9 @@ public:
 
     void reset();                               
     void tick(const string &hdr = "");
+    void run_ticks(uint64_t exec_limit);
+    void run_threaded(uint64_t exec_limit);
+    void run_block(uint64_t exec_limit);
     void dump(const string &hdr = "") const;
 
     //******************************************************************************
@@ -74,6 +85,21 @@ public:
     //******************************************************************************
     void set_show_registers(bool b)    { show_registers = b; }
 
+    //******************************************************************************
+    // This function makes the register trace print only the registers that
+    // changed since the previous dump, on one line after the pc, with a full
+    // dump (a keyframe) every n instructions so that a reader can rebuild the
+    // whole register file from any keyframe on.
+    //
+    // Parameters:
+    //   n - The number of dumps from one keyframe to the next (0 = every dump
+    //       is a full one).
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_register_keyframes(uint32_t n) { keyframe_interval = n; }
+
     //******************************************************************************
     // This function reports whether the hart has halted execution
     //
@@ -110,6 +136,45 @@ public:
     //******************************************************************************
     uint64_t get_insn_counter() const  { return insn_counter; }
 
+    //******************************************************************************
+    // These functions return the registers and the pc of the hart.
+    //
+    // Parameters:
+    //   None.
+    //
+    // Return value:
+    //   The register file, or the address of the next instruction.
+    //******************************************************************************
+    const registerfile &get_registers() const { return regs; }
+    uint32_t get_pc() const            { return pc; }
+
+    //******************************************************************************
+    // This function enables or disables compiling hot blocks to native code when
+    // the hart runs through run_block(). Blocks the compiler cannot handle, and
+    // all blocks on hosts other than x86-64, keep being interpreted.
+    //
+    // Parameters:
+    //   b - true to enable the JIT compiler.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_jit(bool b)               { jit_enabled = b; }
+
+    void set_stop_ranges(const vector<pair<uint32_t, uint32_t>> &r);
+
+    //******************************************************************************
+    // This function sets the address of the next instruction to execute. It is
+    // used after reset() to start a program at its entry point.
+    //
+    // Parameters:
+    //   addr - The address to continue execution at.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_pc(uint32_t addr)         { pc = addr; }
+
     //******************************************************************************
     // This function sets the mhartid value associated with this hart. The
     // mhartid can be used to identify the hart in multi-hart systems, though
@@ -123,84 +188,291 @@ public:
     //******************************************************************************
     void set_mhartid(int i)           { mhartid = i; }
 
+    //******************************************************************************
+    // This function makes tick() record every retired instruction, for example
+    // to a binary trace (or stops it when s is nullptr).
+    //
+    // Parameters:
+    //   s - Where to record to. The caller opens and closes it.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_trace_sink(trace_sink *s) { record_sink = s; }
+
+    //******************************************************************************
+    // This function sets where the -i and -r traces are printed (cout until it
+    // is called), so that harts on several threads can each trace to their own
+    // stream.
+    //
+    // Parameters:
+    //   os - The stream to print to. It must outlive its use here.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_trace_output(ostream &os) { trace_out = &os; }
+
+    //******************************************************************************
+    // This function makes the hart share a code_watch with the other harts of
+    // its memory, so that code any of them stores is re-decoded by all of them
+    // (by the next block each enters).
+    //
+    // Parameters:
+    //   w - The shared watch, or nullptr for a hart of its own memory.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void set_code_watch(code_watch *w) { watch = w; code_seen = w ? w->get_generation() : 0; }
+
+    //******************************************************************************
+    // This function returns the cache the -i trace renders its disassembly
+    // through, for its hit and size counts.
+    //
+    // Parameters:
+    //   None
+    //
+    // Return value:
+    //   A const reference to the cache.
+    //******************************************************************************
+    const render_cache &get_render_cache() const { return insn_text; }
+
 protected:
     registerfile regs;
     memory &mem;
 
+    bool show_instructions = false;
+    bool show_registers    = false;
+    uint32_t keyframe_interval = 0;
+
+    uint64_t insn_counter  = 0;
+    uint32_t pc            = 0;
+
+    trace_sink *record_sink = nullptr;
+    ostream *trace_out = &cout;         // where the -i and -r traces go
+    render_cache insn_text;             // disassembly for the -i trace
+
+    void invalidate(uint32_t addr, uint32_t len);
+    void flush_code();
+
+    //******************************************************************************
+    // This function drops the hart's decodings if another hart has stored to
+    // code since they were made. The engines call it when entering a block.
+    //
+    // Parameters:
+    //   None
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void sync_code()
+    {
+        if (watch && watch->get_generation() != code_seen)
+            flush_code();
+    }
+    bool in_stop_range(uint32_t addr) const;
+
+    typedef void (rv32i_hart::*tick_fn)(const string &);
+    tick_fn select_tick() const;
+
+    //******************************************************************************
+    // This function returns the tracing flags as an index into the tables of
+    // tick_as() and tick_loop() instantiations: show_instructions is bit 0,
+    // show_registers bit 1 and a trace sink bit 2.
+    //******************************************************************************
+    unsigned trace_flags() const
+    {
+        return (show_instructions ? 1 : 0) | (show_registers ? 2 : 0) | (record_sink ? 4 : 0);
+    }
+
 private:
     static constexpr int instruction_width = 35;
 
-    void exec(uint32_t insn, ostream *pos);
+    static constexpr uint32_t icache_page_bytes = 4096;
+    static constexpr uint32_t icache_page_words = icache_page_bytes / 4;
+
+    //******************************************************************************
+    // An instruction that has been decoded once into the fields its exec_xxx()
+    // helper needs. The immediate is already sign-extended for its format.
+    //******************************************************************************
+    struct predecoded;
+    typedef void (rv32i_hart::*exec_fn)(const predecoded &);
+
+    struct predecoded
+    {
+        exec_fn handler = nullptr;          // untraced exec_xxx() instantiation
+        uint32_t insn = 0;
+        int32_t  imm  = 0;
+        uint8_t  rd   = 0;
+        uint8_t  rs1  = 0;
+        uint8_t  rs2  = 0;
+        uint8_t  op   = op_illegal;
+        bool in_block = false;
+    };
+
+    static constexpr uint32_t block_max_insns = 256;
+    static constexpr uint32_t jit_threshold   = 50;
+    static constexpr size_t   jit_code_size   = 16 << 20;
+
+    //******************************************************************************
+    // The state shared between the hart and a compiled block. The block works
+    // on the registers in place and reports where execution continues and how
+    // many of its instructions were retired.
+    //******************************************************************************
+    struct jit_context
+    {
+        int32_t *x;
+        rv32i_hart *hart;
+        uint32_t next_pc;
+        uint32_t executed;
+    };
+
+    typedef void (*native_block)(jit_context *);
+
+    //******************************************************************************
+    // A basic block: a run of predecoded instructions that ends with a jump,
+    // branch, SYSTEM or illegal instruction. exit_pc holds the possible
+    // successor addresses and exit the blocks they have been chained to.
+    //******************************************************************************
+    struct translated_block
+    {
+        vector<predecoded> ops;
+        uint32_t exit_pc[2]        = { 0, 0 };
+        translated_block *exit[2]  = { nullptr, nullptr };
+        bool indirect              = false;
+        uint64_t generation        = 0;
+        uint32_t heat              = 0;
+        native_block native        = nullptr;
+    };
+
+    void translate_block(uint32_t addr, translated_block &b);
+    static bool ends_block(const predecoded &d);
+
+    native_block compile_block(uint32_t addr, const translated_block &b);
+
+    static int32_t jit_lb(rv32i_hart *h, uint32_t addr);
+    static int32_t jit_lh(rv32i_hart *h, uint32_t addr);
+    static int32_t jit_lw(rv32i_hart *h, uint32_t addr);
+    static int32_t jit_lbu(rv32i_hart *h, uint32_t addr);
+    static int32_t jit_lhu(rv32i_hart *h, uint32_t addr);
+    static uint32_t jit_sb(rv32i_hart *h, uint32_t addr, uint32_t val);
+    static uint32_t jit_sh(rv32i_hart *h, uint32_t addr, uint32_t val);
+    static uint32_t jit_sw(rv32i_hart *h, uint32_t addr, uint32_t val);
+
+    template<bool trace> static const exec_fn exec_table[op_count];
 
-    void exec_illegal_insn(uint32_t insn, ostream *pos);
+    predecoded &fetch(uint32_t addr);
+    static predecoded predecode(uint32_t insn);
+
+    template<bool show_insns, bool show_regs, bool record> void tick_as(const string &hdr);
+    template<bool show_insns, bool show_regs, bool record> void tick_loop(uint64_t limit);
+
+    template<bool trace> void exec(const predecoded &d);
+    void dump_registers(const string &hdr);
+
+    void begin_record(trace_record &r, uint32_t addr, const predecoded &d) const;
+    void end_record(trace_record &r, const predecoded &d) const;
+
+    template<bool trace> void exec_illegal_insn(const predecoded &d);
 
  // HELPERS
 
-    void exec_lui(uint32_t insn, ostream *pos);
-    void exec_auipc(uint32_t insn, ostream *pos);
-
-    void exec_jal(uint32_t insn, ostream *pos);
-    void exec_jalr(uint32_t insn, ostream *pos);
-
-    void exec_beq(uint32_t insn, ostream *pos);
-    void exec_bne(uint32_t insn, ostream *pos);
-    void exec_blt(uint32_t insn, ostream *pos);
-    void exec_bge(uint32_t insn, ostream *pos);
-    void exec_bltu(uint32_t insn, ostream *pos);
-    void exec_bgeu(uint32_t insn, ostream *pos);
-
-    void exec_lb(uint32_t insn, ostream *pos);
-    void exec_lh(uint32_t insn, ostream *pos);
-    void exec_lw(uint32_t insn, ostream *pos);
-    void exec_lbu(uint32_t insn, ostream *pos);
-    void exec_lhu(uint32_t insn, ostream *pos);
-
-    void exec_sb(uint32_t insn, ostream *pos);
-    void exec_sh(uint32_t insn, ostream *pos);
-    void exec_sw(uint32_t insn, ostream *pos);
-
-    void exec_addi(uint32_t insn, ostream *pos);
-    void exec_slti(uint32_t insn, ostream *pos);
-    void exec_sltiu(uint32_t insn, ostream *pos);
-    void exec_xori(uint32_t insn, ostream *pos);
-    void exec_ori(uint32_t insn, ostream *pos);
-    void exec_andi(uint32_t insn, ostream *pos);
-    void exec_slli(uint32_t insn, ostream *pos);
-    void exec_srli(uint32_t insn, ostream *pos);
-    void exec_srai(uint32_t insn, ostream *pos);
-
-    void exec_add(uint32_t insn, ostream *pos);
-    void exec_sub(uint32_t insn, ostream *pos);
-    void exec_sll(uint32_t insn, ostream *pos);
-    void exec_slt(uint32_t insn, ostream *pos);
-    void exec_sltu(uint32_t insn, ostream *pos);
-    void exec_xor(uint32_t insn, ostream *pos);
-    void exec_srl(uint32_t insn, ostream *pos);
-    void exec_sra(uint32_t insn, ostream *pos);
-    void exec_or(uint32_t insn, ostream *pos);
-    void exec_and(uint32_t insn, ostream *pos);
-
-    void exec_system(uint32_t insn, ostream *pos);
-
-    void exec_ecall(uint32_t insn, ostream *pos);
-    void exec_ebreak(uint32_t insn, ostream *pos);
-
-    void exec_csrrw(uint32_t insn, ostream *pos);
-    void exec_csrrs(uint32_t insn, ostream *pos);
-    void exec_csrrc(uint32_t insn, ostream *pos);
-    void exec_csrrwi(uint32_t insn, ostream *pos);
-    void exec_csrrsi(uint32_t insn, ostream *pos);
-    void exec_csrrci(uint32_t insn, ostream *pos);
+    template<bool trace> void exec_lui(const predecoded &d);
+    template<bool trace> void exec_auipc(const predecoded &d);
+
+    template<bool trace> void exec_jal(const predecoded &d);
+    template<bool trace> void exec_jalr(const predecoded &d);
+
+    template<bool trace> void exec_beq(const predecoded &d);
+    template<bool trace> void exec_bne(const predecoded &d);
+    template<bool trace> void exec_blt(const predecoded &d);
+    template<bool trace> void exec_bge(const predecoded &d);
+    template<bool trace> void exec_bltu(const predecoded &d);
+    template<bool trace> void exec_bgeu(const predecoded &d);
+
+    template<bool trace> void exec_lb(const predecoded &d);
+    template<bool trace> void exec_lh(const predecoded &d);
+    template<bool trace> void exec_lw(const predecoded &d);
+    template<bool trace> void exec_lbu(const predecoded &d);
+    template<bool trace> void exec_lhu(const predecoded &d);
+
+    template<bool trace> void exec_sb(const predecoded &d);
+    template<bool trace> void exec_sh(const predecoded &d);
+    template<bool trace> void exec_sw(const predecoded &d);
+
+    template<bool trace> void exec_addi(const predecoded &d);
+    template<bool trace> void exec_slti(const predecoded &d);
+    template<bool trace> void exec_sltiu(const predecoded &d);
+    template<bool trace> void exec_xori(const predecoded &d);
+    template<bool trace> void exec_ori(const predecoded &d);
+    template<bool trace> void exec_andi(const predecoded &d);
+    template<bool trace> void exec_slli(const predecoded &d);
+    template<bool trace> void exec_srli(const predecoded &d);
+    template<bool trace> void exec_srai(const predecoded &d);
+
+    template<bool trace> void exec_add(const predecoded &d);
+    template<bool trace> void exec_sub(const predecoded &d);
+    template<bool trace> void exec_sll(const predecoded &d);
+    template<bool trace> void exec_slt(const predecoded &d);
+    template<bool trace> void exec_sltu(const predecoded &d);
+    template<bool trace> void exec_xor(const predecoded &d);
+    template<bool trace> void exec_srl(const predecoded &d);
+    template<bool trace> void exec_sra(const predecoded &d);
+    template<bool trace> void exec_or(const predecoded &d);
+    template<bool trace> void exec_and(const predecoded &d);
+
+    template<bool trace> void exec_ecall(const predecoded &d);
+    template<bool trace> void exec_ebreak(const predecoded &d);
+
+    template<bool trace> void exec_csrrw(const predecoded &d);
+    template<bool trace> void exec_csrrs(const predecoded &d);
+    template<bool trace> void exec_csrrc(const predecoded &d);
+    template<bool trace> void exec_csrrwi(const predecoded &d);
+    template<bool trace> void exec_csrrsi(const predecoded &d);
+    template<bool trace> void exec_csrrci(const predecoded &d);
+
+    //******************************************************************************
+    // This function returns the value a CSR instruction reads. mhartid is the
+    // only CSR implemented; every other CSR reads as zero.
+    //
+    // Parameters:
+    //   csr - The CSR number.
+    //
+    // Return value:
+    //   The value of the CSR.
+    //******************************************************************************
+    uint32_t csr_value(uint32_t csr) const { return csr == csr_mhartid ? mhartid : 0; }
 
     // CORE STATE
 
     bool halt              = false;
     string halt_reason = "none";
 
-    bool show_instructions = false;
-    bool show_registers    = false;
-
-    uint64_t insn_counter  = 0;
-    uint32_t pc            = 0;
     uint32_t mhartid       = 0;
+
+    // REGISTER TRACE
+
+    uint32_t since_keyframe = 0;         // dumps since the last full one
+    registerfile dumped_regs;             // register values at the last dump
+
+    // INSTRUCTION CACHE
+
+    vector<unique_ptr<predecoded[]>> icache;
+    predecoded uncached;
+
+    code_watch *watch              = nullptr;  // shared with the other harts
+    uint64_t code_seen             = 0;        // watch generation of the caches
+
+    // BLOCK CACHE
+
+    unordered_map<uint32_t, unique_ptr<translated_block>> blocks;
+    uint64_t block_generation      = 0;
+    translated_block **chain_from  = nullptr;
+    vector<pair<uint32_t, uint32_t>> stop_ranges;
+
+    // JIT COMPILER
+
+    bool jit_enabled               = false;
+    unique_ptr<jit_buffer> jit;
 };
@@ -0,0 +1,283 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "rv32i_hart.h"
+#include <cstdint>
+
+using namespace std;
+
+//******************************************************************************
+// This function reports whether a predecoded instruction ends a basic block,
+// which is the case for every instruction that can change the pc to anything
+// other than pc + 4 or that can halt the hart.
+//
+// Parameters:
+//   d - The predecoded instruction.
+//
+// Return value:
+//   true if the instruction is the last one of its block.
+//******************************************************************************
+bool rv32i_hart::ends_block(const predecoded &d)
+{
+    switch (d.op)
+    {
+        case op_jal:
+        case op_jalr:
+        case op_beq:
+        case op_bne:
+        case op_blt:
+        case op_bge:
+        case op_bltu:
+        case op_bgeu:
+        case op_ecall:
+        case op_ebreak:
+        case op_csrrw:
+        case op_csrrs:
+        case op_csrrc:
+        case op_csrrwi:
+        case op_csrrsi:
+        case op_csrrci:
+        case op_illegal:
+            return true;
+    }
+    return false;
+}
+
+//******************************************************************************
+// This function makes run_block() return instead of executing any instruction
+// whose address is in one of the given ranges. Blocks end before such an
+// instruction and are never chained to one, so the ranges are only looked at
+// when a block is translated or looked up, not as instructions execute. The
+// translated blocks are discarded, since they may be chained into a range.
+//
+// Parameters:
+//   r - The ranges, each the first address and the address after the last.
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_hart::set_stop_ranges(const vector<pair<uint32_t, uint32_t>> &r)
+{
+    stop_ranges = r;
+    blocks.clear();
+    chain_from = nullptr;
+}
+
+//******************************************************************************
+// This function reports whether run_block() has to stop before addr.
+//
+// Parameters:
+//   addr - The address of an instruction.
+//
+// Return value:
+//   true if addr is in one of the stop ranges.
+//******************************************************************************
+bool rv32i_hart::in_stop_range(uint32_t addr) const
+{
+    for (const pair<uint32_t, uint32_t> &r : stop_ranges)
+        if (addr >= r.first && addr < r.second)
+            return true;
+    return false;
+}
+
+//******************************************************************************
+// This function translates the basic block that starts at addr into b. The
+// instructions are taken from the instruction cache and marked so that a store
+// to any of them makes the block stale. The possible successor addresses are
+// recorded so that the block can later be chained to them.
+//
+// Parameters:
+//   addr - The (word aligned, in range) address of the first instruction.
+//   b    - The block to fill in. Any previous contents are discarded.
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_hart::translate_block(uint32_t addr, translated_block &b)
+{
+    b.ops.clear();
+    b.exit[0] = b.exit[1] = nullptr;
+    b.indirect = false;
+    b.generation = block_generation;
+    b.heat = 0;
+    b.native = nullptr;
+
+    uint32_t a = addr;
+    for (;;)
+    {
+        predecoded &d = fetch(a);
+        d.in_block = true;
+        b.ops.push_back(d);
+
+        if (ends_block(d))
+            break;
+
+        a += 4;
+        if (a >= mem.get_size() || b.ops.size() >= block_max_insns || in_stop_range(a))
+        {
+            b.exit_pc[0] = b.exit_pc[1] = a;
+            return;
+        }
+    }
+
+    const predecoded &last = b.ops.back();
+    switch (last.op)
+    {
+        case op_jal:
+            b.exit_pc[0] = b.exit_pc[1] = a + static_cast<uint32_t>(last.imm);
+            break;
+
+        case op_jalr:
+            b.indirect = true;
+            b.exit_pc[0] = b.exit_pc[1] = 0xffffffff;
+            break;
+
+        case op_beq:
+        case op_bne:
+        case op_blt:
+        case op_bge:
+        case op_bltu:
+        case op_bgeu:
+            b.exit_pc[0] = a + static_cast<uint32_t>(last.imm);
+            b.exit_pc[1] = a + 4;
+            break;
+
+        default:
+            b.exit_pc[0] = b.exit_pc[1] = a + 4;
+            break;
+    }
+}
+
+//******************************************************************************
+// This function executes instructions a basic block at a time, starting with
+// the block at the current pc and following chained successors for as long as
+// they are already translated. It returns to the caller when the hart halts,
+// when the execution limit is reached (which may be partway through a block),
+// when a store makes the translated blocks stale, or when the next block still
+// has to be looked up. The following call then translates that block and
+// chains it to the exit that led to it. When the JIT compiler is enabled, a
+// block that has been interpreted jit_threshold times is compiled to native
+// code, which is then used whenever the whole block fits within the limit.
+// It also returns, without executing anything, when the pc is in one of the
+// ranges given to set_stop_ranges(). No trace output is produced.
+//
+// Parameters:
+//   exec_limit - The maximum value of the instruction counter (0 = no limit).
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_hart::run_block(uint64_t exec_limit)
+{
+    if (halt)
+        return;
+
+    if (pc & 0x3)
+    {
+        chain_from = nullptr;
+        halt = true;
+        halt_reason = "PC alignment error";
+        return;
+    }
+
+    if (pc >= mem.get_size())
+    {
+        // fetching from outside the memory is left to tick() and its warnings
+        chain_from = nullptr;
+        tick("");
+        return;
+    }
+
+    if (!stop_ranges.empty() && in_stop_range(pc))
+    {
+        chain_from = nullptr;
+        return;
+    }
+
+    unique_ptr<translated_block> &slot = blocks[pc];
+    if (!slot)
+        slot.reset(new translated_block());
+
+    translated_block *b = slot.get();
+
+    if (chain_from)
+        *chain_from = b;
+    chain_from = nullptr;
+
+    uint64_t limit = exec_limit ? exec_limit : UINT64_MAX;
+
+    while (b)
+    {
+        sync_code();
+        if (b->generation != block_generation || b->ops.empty())
+            translate_block(pc, *b);
+
+        uint64_t generation = block_generation;
+        uint64_t n = b->ops.size();
+        if (limit - insn_counter < n)
+            n = limit - insn_counter;
+
+        if (b->native && n == b->ops.size())
+        {
+            jit_context c = { regs.data(), this, pc, 0 };
+            b->native(&c);
+            insn_counter += c.executed;
+            pc = c.next_pc;
+
+            if (block_generation != generation)
+                return;
+        }
+        else
+        {
+            uint32_t start = pc;
+
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                const predecoded &d = b->ops[i];
+                ++insn_counter;
+                (this->*d.handler)(d);
+
+                if (block_generation != generation)
+                    return;
+            }
+
+            if (jit_enabled && ++b->heat == jit_threshold)
+                b->native = compile_block(start, *b);
+        }
+
+        if (halt || n < b->ops.size() || insn_counter >= limit)
+            return;
+
+        int e;
+        if (b->indirect)
+        {
+            if (pc != b->exit_pc[0])
+            {
+                b->exit_pc[0] = pc;
+                b->exit[0] = nullptr;
+            }
+            e = 0;
+        }
+        else
+        {
+            e = (pc == b->exit_pc[0]) ? 0 : 1;
+        }
+
+        if (!b->exit[e])
+        {
+            // the caller may tick() through a stop range before calling again
+            if (stop_ranges.empty() || !in_stop_range(pc))
+                chain_from = &b->exit[e];
+            return;
+        }
+
+        b = b->exit[e];
+    }
+}
@@ -0,0 +1,415 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "rv32i_hart.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+using namespace std;
+
+//******************************************************************************
+// MEMORY HELPERS
+// Compiled blocks call these for every load and store so that guest memory is
+// accessed through the same range checks (and warnings) as the interpreter.
+// The store helpers also invalidate cached decodings and return nonzero when
+// the store hit a translated block, in which case the compiled block stops.
+//
+// Parameters:
+//   h    - The hart executing the block.
+//   addr - The effective address.
+//   val  - The value to store.
+//
+// Return value:
+//   The loaded value, or for stores whether the translated blocks went stale.
+//******************************************************************************
+
+int32_t rv32i_hart::jit_lb(rv32i_hart *h, uint32_t addr)  { return h->mem.get8_sx(addr); }
+int32_t rv32i_hart::jit_lh(rv32i_hart *h, uint32_t addr)  { return h->mem.get16_sx(addr); }
+int32_t rv32i_hart::jit_lw(rv32i_hart *h, uint32_t addr)  { return h->mem.get32_sx(addr); }
+int32_t rv32i_hart::jit_lbu(rv32i_hart *h, uint32_t addr) { return h->mem.get8(addr); }
+int32_t rv32i_hart::jit_lhu(rv32i_hart *h, uint32_t addr) { return h->mem.get16(addr); }
+
+uint32_t rv32i_hart::jit_sb(rv32i_hart *h, uint32_t addr, uint32_t val)
+{
+    uint64_t generation = h->block_generation;
+    h->mem.set8(addr, static_cast<uint8_t>(val));
+    h->invalidate(addr, 1);
+    return h->block_generation != generation;
+}
+
+uint32_t rv32i_hart::jit_sh(rv32i_hart *h, uint32_t addr, uint32_t val)
+{
+    uint64_t generation = h->block_generation;
+    h->mem.set16(addr, static_cast<uint16_t>(val));
+    h->invalidate(addr, 2);
+    return h->block_generation != generation;
+}
+
+uint32_t rv32i_hart::jit_sw(rv32i_hart *h, uint32_t addr, uint32_t val)
+{
+    uint64_t generation = h->block_generation;
+    h->mem.set32(addr, val);
+    h->invalidate(addr, 4);
+    return h->block_generation != generation;
+}
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+
+//******************************************************************************
+// X86-64 EMITTER
+// A compiled block is a function void f(jit_context *c). While it runs rbx
+// holds c and r12 holds c->x, so guest register r lives at [r12 + 4*r]. Only
+// eax, ecx, edx, esi and edi are used as scratch registers.
+//******************************************************************************
+
+static constexpr uint8_t host_eax = 0;
+static constexpr uint8_t host_ecx = 1;
+static constexpr uint8_t host_edx = 2;
+
+static void emit(vector<uint8_t> &c, std::initializer_list<uint8_t> bytes)
+{
+    c.insert(c.end(), bytes);
+}
+
+static void emit32(vector<uint8_t> &c, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i)
+        c.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+static void emit64(vector<uint8_t> &c, uint64_t v)
+{
+    for (int i = 0; i < 8; ++i)
+        c.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+// host = x[r]  (x0 reads as zero)
+static void emit_get(vector<uint8_t> &c, uint8_t host, uint32_t r)
+{
+    if (r == 0)
+        emit(c, { 0x31, static_cast<uint8_t>(0xc0 | host << 3 | host) });
+    else
+        emit(c, { 0x41, 0x8b, static_cast<uint8_t>(0x44 | host << 3), 0x24,
+                  static_cast<uint8_t>(4 * r) });
+}
+
+// x[r] = host  (writes to x0 are dropped)
+static void emit_put(vector<uint8_t> &c, uint8_t host, uint32_t r)
+{
+    if (r != 0)
+        emit(c, { 0x41, 0x89, static_cast<uint8_t>(0x44 | host << 3), 0x24,
+                  static_cast<uint8_t>(4 * r) });
+}
+
+// eax = (flags) ? 1 : 0 using the given setcc opcode
+static void emit_setcc(vector<uint8_t> &c, uint8_t setcc)
+{
+    emit(c, { 0x0f, setcc, 0xc0, 0x0f, 0xb6, 0xc0 });
+}
+
+static void emit_epilogue(vector<uint8_t> &c)
+{
+    emit(c, { 0x48, 0x83, 0xc4, 0x08,       // add rsp,8
+              0x41, 0x5c,                   // pop r12
+              0x5b,                         // pop rbx
+              0xc3 });                      // ret
+}
+
+// length of the code produced by emit_exit()
+static constexpr uint8_t exit_len = 22;
+
+// c->next_pc = next_pc; c->executed = executed; return
+static void emit_exit(vector<uint8_t> &c, uint32_t next_pc, uint32_t executed,
+                      uint8_t off_next_pc, uint8_t off_executed)
+{
+    emit(c, { 0xc7, 0x43, off_next_pc });
+    emit32(c, next_pc);
+    emit(c, { 0xc7, 0x43, off_executed });
+    emit32(c, executed);
+    emit_epilogue(c);
+}
+
+// rdi = c->hart; esi = eax; rax = fn; call rax
+static void emit_call(vector<uint8_t> &c, const void *fn, uint8_t off_hart)
+{
+    emit(c, { 0x89, 0xc6 });
+    emit(c, { 0x48, 0x8b, 0x7b, off_hart });
+    emit(c, { 0x48, 0xb8 });
+    emit64(c, reinterpret_cast<uint64_t>(fn));
+    emit(c, { 0xff, 0xd0 });
+}
+
+//******************************************************************************
+// This function compiles a translated block to x86-64 machine code. Blocks that
+// contain ECALL, EBREAK or illegal instructions are not compiled because they
+// halt the hart and are left to the interpreter.
+//
+// Parameters:
+//   addr - The address of the first instruction of the block.
+//   b    - The translated block.
+//
+// Return value:
+//   The compiled block, or nullptr if it could not be compiled.
+//******************************************************************************
+rv32i_hart::native_block rv32i_hart::compile_block(uint32_t addr, const translated_block &b)
+{
+    for (const predecoded &d : b.ops)
+        if (d.op == op_ecall || d.op == op_ebreak || d.op == op_illegal)
+            return nullptr;
+
+    if (!jit)
+        jit.reset(new jit_buffer(jit_code_size));
+    if (!jit->is_usable())
+        return nullptr;
+
+    const uint8_t off_x        = offsetof(jit_context, x);
+    const uint8_t off_hart     = offsetof(jit_context, hart);
+    const uint8_t off_next_pc  = offsetof(jit_context, next_pc);
+    const uint8_t off_executed = offsetof(jit_context, executed);
+
+    vector<uint8_t> c;
+
+    emit(c, { 0x53,                         // push rbx
+              0x41, 0x54,                   // push r12
+              0x48, 0x83, 0xec, 0x08,       // sub rsp,8
+              0x48, 0x89, 0xfb,             // mov rbx,rdi
+              0x4c, 0x8b, 0x63, off_x });   // mov r12,[rbx+x]
+
+    uint32_t a = addr;
+    uint32_t n = 0;
+
+    for (const predecoded &d : b.ops)
+    {
+        ++n;
+        uint32_t imm = static_cast<uint32_t>(d.imm);
+
+        switch (d.op)
+        {
+            case op_lui:
+                emit(c, { 0xb8 });
+                emit32(c, imm);
+                emit_put(c, host_eax, d.rd);
+                break;
+
+            case op_auipc:
+                emit(c, { 0xb8 });
+                emit32(c, a + imm);
+                emit_put(c, host_eax, d.rd);
+                break;
+
+            case op_jal:
+                emit(c, { 0xb8 });
+                emit32(c, a + 4);
+                emit_put(c, host_eax, d.rd);
+                emit_exit(c, a + imm, n, off_next_pc, off_executed);
+                break;
+
+            case op_jalr:
+                emit_get(c, host_eax, d.rs1);
+                emit(c, { 0x05 });                          // add eax,imm
+                emit32(c, imm);
+                emit(c, { 0x25 });                          // and eax,~1
+                emit32(c, ~1u);
+                emit(c, { 0xb9 });                          // mov ecx,link
+                emit32(c, a + 4);
+                emit_put(c, host_ecx, d.rd);
+                emit(c, { 0x89, 0x43, off_next_pc });       // mov [rbx+next_pc],eax
+                emit(c, { 0xc7, 0x43, off_executed });
+                emit32(c, n);
+                emit_epilogue(c);
+                break;
+
+            case op_beq:
+            case op_bne:
+            case op_blt:
+            case op_bge:
+            case op_bltu:
+            case op_bgeu:
+            {
+                uint8_t jcc = 0;
+                switch (d.op)
+                {
+                    case op_beq:  jcc = 0x74; break;        // je
+                    case op_bne:  jcc = 0x75; break;        // jne
+                    case op_blt:  jcc = 0x7c; break;        // jl
+                    case op_bge:  jcc = 0x7d; break;        // jge
+                    case op_bltu: jcc = 0x72; break;        // jb
+                    case op_bgeu: jcc = 0x73; break;        // jae
+                }
+                emit_get(c, host_eax, d.rs1);
+                emit_get(c, host_ecx, d.rs2);
+                emit(c, { 0x39, 0xc8, jcc, exit_len });     // cmp eax,ecx; jcc taken
+                emit_exit(c, a + 4, n, off_next_pc, off_executed);
+                emit_exit(c, a + imm, n, off_next_pc, off_executed);
+                break;
+            }
+
+            case op_lb:
+            case op_lh:
+            case op_lw:
+            case op_lbu:
+            case op_lhu:
+            {
+                int32_t (*fn)(rv32i_hart *, uint32_t) = nullptr;
+                switch (d.op)
+                {
+                    case op_lb:  fn = &rv32i_hart::jit_lb;  break;
+                    case op_lh:  fn = &rv32i_hart::jit_lh;  break;
+                    case op_lw:  fn = &rv32i_hart::jit_lw;  break;
+                    case op_lbu: fn = &rv32i_hart::jit_lbu; break;
+                    case op_lhu: fn = &rv32i_hart::jit_lhu; break;
+                }
+                emit_get(c, host_eax, d.rs1);
+                emit(c, { 0x05 });
+                emit32(c, imm);
+                emit_call(c, reinterpret_cast<const void *>(fn), off_hart);
+                emit_put(c, host_eax, d.rd);
+                break;
+            }
+
+            case op_sb:
+            case op_sh:
+            case op_sw:
+            {
+                uint32_t (*fn)(rv32i_hart *, uint32_t, uint32_t) = nullptr;
+                switch (d.op)
+                {
+                    case op_sb: fn = &rv32i_hart::jit_sb; break;
+                    case op_sh: fn = &rv32i_hart::jit_sh; break;
+                    case op_sw: fn = &rv32i_hart::jit_sw; break;
+                }
+                emit_get(c, host_edx, d.rs2);
+                emit_get(c, host_eax, d.rs1);
+                emit(c, { 0x05 });
+                emit32(c, imm);
+                emit_call(c, reinterpret_cast<const void *>(fn), off_hart);
+                emit(c, { 0x85, 0xc0, 0x74, exit_len });    // test eax,eax; jz
+                emit_exit(c, a + 4, n, off_next_pc, off_executed);
+                break;
+            }
+
+            case op_addi:
+            case op_xori:
+            case op_ori:
+            case op_andi:
+            {
+                uint8_t opc = 0;
+                switch (d.op)
+                {
+                    case op_addi: opc = 0x05; break;
+                    case op_xori: opc = 0x35; break;
+                    case op_ori:  opc = 0x0d; break;
+                    case op_andi: opc = 0x25; break;
+                }
+                emit_get(c, host_eax, d.rs1);
+                emit(c, { opc });
+                emit32(c, imm);
+                emit_put(c, host_eax, d.rd);
+                break;
+            }
+
+            case op_slti:
+            case op_sltiu:
+                emit_get(c, host_eax, d.rs1);
+                emit(c, { 0x3d });                          // cmp eax,imm
+                emit32(c, imm);
+                emit_setcc(c, d.op == op_slti ? 0x9c : 0x92);
+                emit_put(c, host_eax, d.rd);
+                break;
+
+            case op_slli:
+            case op_srli:
+            case op_srai:
+            {
+                uint8_t modrm = d.op == op_slli ? 0xe0 : d.op == op_srli ? 0xe8 : 0xf8;
+                emit_get(c, host_eax, d.rs1);
+                emit(c, { 0xc1, modrm, static_cast<uint8_t>(imm & 0x1f) });
+                emit_put(c, host_eax, d.rd);
+                break;
+            }
+
+            case op_add:
+            case op_sub:
+            case op_xor:
+            case op_or:
+            case op_and:
+            {
+                uint8_t opc = 0;
+                switch (d.op)
+                {
+                    case op_add: opc = 0x01; break;
+                    case op_sub: opc = 0x29; break;
+                    case op_xor: opc = 0x31; break;
+                    case op_or:  opc = 0x09; break;
+                    case op_and: opc = 0x21; break;
+                }
+                emit_get(c, host_eax, d.rs1);
+                emit_get(c, host_ecx, d.rs2);
+                emit(c, { opc, 0xc8 });
+                emit_put(c, host_eax, d.rd);
+                break;
+            }
+
+            case op_slt:
+            case op_sltu:
+                emit_get(c, host_eax, d.rs1);
+                emit_get(c, host_ecx, d.rs2);
+                emit(c, { 0x39, 0xc8 });
+                emit_setcc(c, d.op == op_slt ? 0x9c : 0x92);
+                emit_put(c, host_eax, d.rd);
+                break;
+
+            case op_sll:
+            case op_srl:
+            case op_sra:
+            {
+                uint8_t modrm = d.op == op_sll ? 0xe0 : d.op == op_srl ? 0xe8 : 0xf8;
+                emit_get(c, host_eax, d.rs1);
+                emit_get(c, host_ecx, d.rs2);
+                emit(c, { 0xd3, modrm });                   // shift eax by cl
+                emit_put(c, host_eax, d.rd);
+                break;
+            }
+
+            case op_csrrw:
+            case op_csrrs:
+            case op_csrrc:
+            case op_csrrwi:
+            case op_csrrsi:
+            case op_csrrci:
+                emit(c, { 0xb8 });                          // mov eax, imm32
+                emit32(c, csr_value(d.imm & 0xfff));
+                emit_put(c, host_eax, d.rd);
+                emit_exit(c, a + 4, n, off_next_pc, off_executed);
+                break;
+        }
+
+        a += 4;
+    }
+
+    if (!ends_block(b.ops.back()))
+        emit_exit(c, a, n, off_next_pc, off_executed);
+
+    return reinterpret_cast<native_block>(jit->commit(c));
+}
+
+#else
+
+//******************************************************************************
+// There is no code generator for this host, so every block is interpreted.
+//******************************************************************************
+rv32i_hart::native_block rv32i_hart::compile_block(uint32_t, const translated_block &)
+{
+    return nullptr;
+}
+
+#endif
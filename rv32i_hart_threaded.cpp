@@ -0,0 +1,426 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "rv32i_hart.h"
+#include <cstdint>
+
+using namespace std;
+
+//******************************************************************************
+// Direct-threaded dispatch. With GCC and Clang every handler ends by jumping
+// straight to the handler of the next instruction through a table of label
+// addresses. Other compilers fall back to jumping back to a single switch.
+//******************************************************************************
+#if defined(__GNUC__)
+#define OP(name)        do_##name:
+#define DISPATCH(op)    goto *dispatch[op]
+#else
+#define OP(name)        case op_##name:
+#define DISPATCH(op)    goto dispatch_switch
+#endif
+
+//******************************************************************************
+// Fetch the next predecoded instruction and jump to its handler, stopping when
+// the execution limit is reached or the pc is misaligned. The instruction cache
+// is probed inline and fetch() is only called on a miss.
+//******************************************************************************
+#define NEXT()                                                              \
+    do                                                                      \
+    {                                                                       \
+        if (count >= limit)                                                 \
+            goto done;                                                      \
+        if (cur & 0x3)                                                      \
+        {                                                                   \
+            halt = true;                                                    \
+            halt_reason = "PC alignment error";                             \
+            goto done;                                                      \
+        }                                                                   \
+        uint32_t page = cur / icache_page_bytes;                            \
+        if (page < icache.size() && icache[page]                            \
+            && icache[page][(cur / 4) % icache_page_words].handler)         \
+            d = &icache[page][(cur / 4) % icache_page_words];               \
+        else                                                                \
+            d = &fetch(cur);                                                \
+        ++count;                                                            \
+        DISPATCH(d->op);                                                    \
+    } while (0)
+
+//******************************************************************************
+// On entering a block, drop the decodings if another hart has stored to code
+// (see rv32i_hart::sync_code()). The watch is kept in a local.
+//******************************************************************************
+#define SYNC_CODE()                                                         \
+    do                                                                      \
+    {                                                                       \
+        if (shared && shared->get_generation() != code_seen)                \
+            flush_code();                                                   \
+    } while (0)
+
+//******************************************************************************
+// Write a result to rd, keeping x0 hardwired to zero.
+//******************************************************************************
+#define SET_RD(val)                                                         \
+    do                                                                      \
+    {                                                                       \
+        x[d->rd] = (val);                                                   \
+        x[0] = 0;                                                           \
+    } while (0)
+
+//******************************************************************************
+// This function runs the hart with the threaded-code engine until it halts or
+// exec_limit instructions have been executed. It executes the same predecoded
+// instructions as tick() and leaves the registers, pc, memory and instruction
+// counter in exactly the same state, but it never produces trace output. The
+// registers are kept in a local array while running and written back to the
+// register file when the engine stops.
+//
+// Parameters:
+//   exec_limit - The maximum value of the instruction counter (0 = no limit).
+//
+// Return value:
+//   None
+//******************************************************************************
+void rv32i_hart::run_threaded(uint64_t exec_limit)
+{
+    if (halt)
+        return;
+
+    int32_t x[32];
+    for (uint32_t i = 0; i < 32; ++i)
+        x[i] = regs.get(i);
+
+    uint64_t limit = exec_limit ? exec_limit : UINT64_MAX;
+    uint64_t count = insn_counter;
+    uint32_t cur   = pc;
+
+    const predecoded *d = nullptr;
+    code_watch *const shared = watch;
+
+#if defined(__GNUC__)
+    void *dispatch[op_count];
+    dispatch[op_illegal] = &&do_illegal;
+    dispatch[op_lui]     = &&do_lui;
+    dispatch[op_auipc]   = &&do_auipc;
+    dispatch[op_jal]     = &&do_jal;
+    dispatch[op_jalr]    = &&do_jalr;
+    dispatch[op_beq]     = &&do_beq;
+    dispatch[op_bne]     = &&do_bne;
+    dispatch[op_blt]     = &&do_blt;
+    dispatch[op_bge]     = &&do_bge;
+    dispatch[op_bltu]    = &&do_bltu;
+    dispatch[op_bgeu]    = &&do_bgeu;
+    dispatch[op_lb]      = &&do_lb;
+    dispatch[op_lh]      = &&do_lh;
+    dispatch[op_lw]      = &&do_lw;
+    dispatch[op_lbu]     = &&do_lbu;
+    dispatch[op_lhu]     = &&do_lhu;
+    dispatch[op_sb]      = &&do_sb;
+    dispatch[op_sh]      = &&do_sh;
+    dispatch[op_sw]      = &&do_sw;
+    dispatch[op_addi]    = &&do_addi;
+    dispatch[op_slti]    = &&do_slti;
+    dispatch[op_sltiu]   = &&do_sltiu;
+    dispatch[op_xori]    = &&do_xori;
+    dispatch[op_ori]     = &&do_ori;
+    dispatch[op_andi]    = &&do_andi;
+    dispatch[op_slli]    = &&do_slli;
+    dispatch[op_srli]    = &&do_srli;
+    dispatch[op_srai]    = &&do_srai;
+    dispatch[op_add]     = &&do_add;
+    dispatch[op_sub]     = &&do_sub;
+    dispatch[op_sll]     = &&do_sll;
+    dispatch[op_slt]     = &&do_slt;
+    dispatch[op_sltu]    = &&do_sltu;
+    dispatch[op_xor]     = &&do_xor;
+    dispatch[op_srl]     = &&do_srl;
+    dispatch[op_sra]     = &&do_sra;
+    dispatch[op_or]      = &&do_or;
+    dispatch[op_and]     = &&do_and;
+    dispatch[op_ecall]   = &&do_ecall;
+    dispatch[op_ebreak]  = &&do_ebreak;
+    dispatch[op_csrrw]   = &&do_csrrw;
+    dispatch[op_csrrs]   = &&do_csrrs;
+    dispatch[op_csrrc]   = &&do_csrrc;
+    dispatch[op_csrrwi]  = &&do_csrrwi;
+    dispatch[op_csrrsi]  = &&do_csrrsi;
+    dispatch[op_csrrci]  = &&do_csrrci;
+#endif
+
+    SYNC_CODE();
+    NEXT();
+
+#if !defined(__GNUC__)
+dispatch_switch:
+    switch (d->op)
+    {
+#endif
+
+    // U-TYPE and JUMPS
+
+    OP(lui)
+        SET_RD(d->imm);
+        cur += 4;
+        NEXT();
+
+    OP(auipc)
+        SET_RD(static_cast<int32_t>(cur + static_cast<uint32_t>(d->imm)));
+        cur += 4;
+        NEXT();
+
+    OP(jal)
+    {
+        uint32_t target = cur + static_cast<uint32_t>(d->imm);
+        SET_RD(static_cast<int32_t>(cur + 4));
+        cur = target;
+        SYNC_CODE();
+        NEXT();
+    }
+
+    OP(jalr)
+    {
+        uint32_t target = (static_cast<uint32_t>(x[d->rs1]) + static_cast<uint32_t>(d->imm)) & ~1u;
+        SET_RD(static_cast<int32_t>(cur + 4));
+        cur = target;
+        SYNC_CODE();
+        NEXT();
+    }
+
+    // B-TYPE
+
+    OP(beq)
+        cur += (x[d->rs1] == x[d->rs2]) ? static_cast<uint32_t>(d->imm) : 4;
+        SYNC_CODE();
+        NEXT();
+
+    OP(bne)
+        cur += (x[d->rs1] != x[d->rs2]) ? static_cast<uint32_t>(d->imm) : 4;
+        SYNC_CODE();
+        NEXT();
+
+    OP(blt)
+        cur += (x[d->rs1] < x[d->rs2]) ? static_cast<uint32_t>(d->imm) : 4;
+        SYNC_CODE();
+        NEXT();
+
+    OP(bge)
+        cur += (x[d->rs1] >= x[d->rs2]) ? static_cast<uint32_t>(d->imm) : 4;
+        SYNC_CODE();
+        NEXT();
+
+    OP(bltu)
+        cur += (static_cast<uint32_t>(x[d->rs1]) < static_cast<uint32_t>(x[d->rs2]))
+                ? static_cast<uint32_t>(d->imm) : 4;
+        SYNC_CODE();
+        NEXT();
+
+    OP(bgeu)
+        cur += (static_cast<uint32_t>(x[d->rs1]) >= static_cast<uint32_t>(x[d->rs2]))
+                ? static_cast<uint32_t>(d->imm) : 4;
+        SYNC_CODE();
+        NEXT();
+
+    // LOADS
+
+    OP(lb)
+        SET_RD(mem.get8_sx(static_cast<uint32_t>(x[d->rs1]) + static_cast<uint32_t>(d->imm)));
+        cur += 4;
+        NEXT();
+
+    OP(lh)
+        SET_RD(mem.get16_sx(static_cast<uint32_t>(x[d->rs1]) + static_cast<uint32_t>(d->imm)));
+        cur += 4;
+        NEXT();
+
+    OP(lw)
+        SET_RD(mem.get32_sx(static_cast<uint32_t>(x[d->rs1]) + static_cast<uint32_t>(d->imm)));
+        cur += 4;
+        NEXT();
+
+    OP(lbu)
+        SET_RD(mem.get8(static_cast<uint32_t>(x[d->rs1]) + static_cast<uint32_t>(d->imm)));
+        cur += 4;
+        NEXT();
+
+    OP(lhu)
+        SET_RD(mem.get16(static_cast<uint32_t>(x[d->rs1]) + static_cast<uint32_t>(d->imm)));
+        cur += 4;
+        NEXT();
+
+    // STORES
+
+    OP(sb)
+    {
+        uint32_t addr = static_cast<uint32_t>(x[d->rs1]) + static_cast<uint32_t>(d->imm);
+        mem.set8(addr, static_cast<uint8_t>(x[d->rs2]));
+        invalidate(addr, 1);
+        cur += 4;
+        NEXT();
+    }
+
+    OP(sh)
+    {
+        uint32_t addr = static_cast<uint32_t>(x[d->rs1]) + static_cast<uint32_t>(d->imm);
+        mem.set16(addr, static_cast<uint16_t>(x[d->rs2]));
+        invalidate(addr, 2);
+        cur += 4;
+        NEXT();
+    }
+
+    OP(sw)
+    {
+        uint32_t addr = static_cast<uint32_t>(x[d->rs1]) + static_cast<uint32_t>(d->imm);
+        mem.set32(addr, static_cast<uint32_t>(x[d->rs2]));
+        invalidate(addr, 4);
+        cur += 4;
+        NEXT();
+    }
+
+    // I-TYPE ALU
+
+    OP(addi)
+        SET_RD(static_cast<int32_t>(static_cast<uint32_t>(x[d->rs1]) + static_cast<uint32_t>(d->imm)));
+        cur += 4;
+        NEXT();
+
+    OP(slti)
+        SET_RD(x[d->rs1] < d->imm ? 1 : 0);
+        cur += 4;
+        NEXT();
+
+    OP(sltiu)
+        SET_RD(static_cast<uint32_t>(x[d->rs1]) < static_cast<uint32_t>(d->imm) ? 1 : 0);
+        cur += 4;
+        NEXT();
+
+    OP(xori)
+        SET_RD(x[d->rs1] ^ d->imm);
+        cur += 4;
+        NEXT();
+
+    OP(ori)
+        SET_RD(x[d->rs1] | d->imm);
+        cur += 4;
+        NEXT();
+
+    OP(andi)
+        SET_RD(x[d->rs1] & d->imm);
+        cur += 4;
+        NEXT();
+
+    OP(slli)
+        SET_RD(static_cast<int32_t>(static_cast<uint32_t>(x[d->rs1]) << (d->imm & 0x1f)));
+        cur += 4;
+        NEXT();
+
+    OP(srli)
+        SET_RD(static_cast<int32_t>(static_cast<uint32_t>(x[d->rs1]) >> (d->imm & 0x1f)));
+        cur += 4;
+        NEXT();
+
+    OP(srai)
+        SET_RD(x[d->rs1] >> (d->imm & 0x1f));
+        cur += 4;
+        NEXT();
+
+    // R-TYPE ALU
+
+    OP(add)
+        SET_RD(static_cast<int32_t>(static_cast<uint32_t>(x[d->rs1]) + static_cast<uint32_t>(x[d->rs2])));
+        cur += 4;
+        NEXT();
+
+    OP(sub)
+        SET_RD(static_cast<int32_t>(static_cast<uint32_t>(x[d->rs1]) - static_cast<uint32_t>(x[d->rs2])));
+        cur += 4;
+        NEXT();
+
+    OP(sll)
+        SET_RD(static_cast<int32_t>(static_cast<uint32_t>(x[d->rs1]) << (x[d->rs2] & 0x1f)));
+        cur += 4;
+        NEXT();
+
+    OP(slt)
+        SET_RD(x[d->rs1] < x[d->rs2] ? 1 : 0);
+        cur += 4;
+        NEXT();
+
+    OP(sltu)
+        SET_RD(static_cast<uint32_t>(x[d->rs1]) < static_cast<uint32_t>(x[d->rs2]) ? 1 : 0);
+        cur += 4;
+        NEXT();
+
+    OP(xor)
+        SET_RD(x[d->rs1] ^ x[d->rs2]);
+        cur += 4;
+        NEXT();
+
+    OP(srl)
+        SET_RD(static_cast<int32_t>(static_cast<uint32_t>(x[d->rs1]) >> (x[d->rs2] & 0x1f)));
+        cur += 4;
+        NEXT();
+
+    OP(sra)
+        SET_RD(x[d->rs1] >> (x[d->rs2] & 0x1f));
+        cur += 4;
+        NEXT();
+
+    OP(or)
+        SET_RD(x[d->rs1] | x[d->rs2]);
+        cur += 4;
+        NEXT();
+
+    OP(and)
+        SET_RD(x[d->rs1] & x[d->rs2]);
+        cur += 4;
+        NEXT();
+
+    // SYSTEM
+
+    OP(csrrw)
+    OP(csrrs)
+    OP(csrrc)
+    OP(csrrwi)
+    OP(csrrsi)
+    OP(csrrci)
+        SET_RD(static_cast<int32_t>(csr_value(d->imm & 0xfff)));
+        cur += 4;
+        NEXT();
+
+    OP(ecall)
+        halt = true;
+        halt_reason = "ECALL instruction";
+        goto done;
+
+    OP(ebreak)
+        halt = true;
+        halt_reason = "EBREAK instruction";
+        goto done;
+
+    OP(illegal)
+        halt = true;
+        halt_reason = "Illegal instruction";
+        goto done;
+
+#if !defined(__GNUC__)
+    }
+#endif
+
+done:
+    for (uint32_t i = 1; i < 32; ++i)
+        regs.set(i, x[i]);
+    pc = cur;
+    insn_counter = count;
+}
+
+#undef OP
+#undef DISPATCH
+#undef NEXT
+#undef SET_RD
+#undef SYNC_CODE
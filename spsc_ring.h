@@ -0,0 +1,107 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+using namespace std;
+
+//******************************************************************************
+// A fixed size ring buffer that passes values from exactly one producer thread
+// to exactly one consumer thread without locks. Each side owns one index and
+// only reads the other's; the release store of an index publishes the slots
+// before it. Each side also keeps a private copy of the other's index so it
+// only touches the shared cache line when the ring looks full or empty.
+//******************************************************************************
+template<typename T>
+class spsc_ring
+{
+public:
+    //******************************************************************************
+    // This constructor creates an empty ring.
+    //
+    // Parameters:
+    //   capacity - The number of slots, rounded up to a power of two.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    explicit spsc_ring(size_t capacity)
+    {
+        size_t n = 1;
+        while (n < capacity)
+            n <<= 1;
+        slots.reset(new T[n]);
+        mask = n - 1;
+    }
+
+    //******************************************************************************
+    // This function appends a value, waiting for the consumer to make room when
+    // the ring is full. Only the producer thread may call it.
+    //
+    // Parameters:
+    //   v - The value to append.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    void push(const T &v)
+    {
+        size_t t = tail.load(memory_order_relaxed);
+        while (t - head_seen > mask)
+        {
+            head_seen = head.load(memory_order_acquire);
+            if (t - head_seen > mask)
+                this_thread::yield();
+        }
+
+        slots[t & mask] = v;
+        tail.store(t + 1, memory_order_release);
+    }
+
+    //******************************************************************************
+    // This function removes the oldest value if there is one. Only the consumer
+    // thread may call it.
+    //
+    // Parameters:
+    //   v - Set to the value removed.
+    //
+    // Return value:
+    //   true if a value was removed, false if the ring was empty.
+    //******************************************************************************
+    bool pop(T &v)
+    {
+        size_t h = head.load(memory_order_relaxed);
+        if (h == tail_seen)
+        {
+            tail_seen = tail.load(memory_order_acquire);
+            if (h == tail_seen)
+                return false;
+        }
+
+        v = slots[h & mask];
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+
+private:
+    unique_ptr<T[]> slots;
+    size_t mask;
+
+    alignas(64) atomic<size_t> tail{0};     // next slot to fill (producer)
+    size_t head_seen = 0;                   // producer's copy of head
+
+    alignas(64) atomic<size_t> head{0};     // next slot to empty (consumer)
+    size_t tail_seen = 0;                   // consumer's copy of tail
+};
@@ -0,0 +1,566 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+//******************************************************************************
+// rv32i_aot reads the same flat binary image that memory::load_file() reads,
+// discovers the reachable code by recursive descent from pc 0 and writes one
+// C++ source file in which every basic block is a function over an aot_state.
+// Compiled together with the simulator sources (everything except main.cpp)
+// it becomes a stand-alone simulator for that one image:
+//
+//     rv32i_aot -o prog.cpp prog.bin
+//     g++ -O2 -I. prog.cpp $(ls *.cpp | grep -v main.cpp)
+//     ./a.out [-l exec_limit] [-m hex-mem-size] [-s] [-z] prog.bin
+//
+// Indirect jumps are dispatched through the block table at run time, and any
+// target that was not discovered is executed by the interpreter.
+//******************************************************************************
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <set>
+#include <map>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "../rv32i_decode.h"
+#include "../hex.h"
+
+using namespace std;
+
+static constexpr uint32_t max_block_insns = 1024;
+
+//******************************************************************************
+// The instruction classes that matter for building the control-flow graph.
+//******************************************************************************
+enum insn_kind
+{
+    kind_normal,
+    kind_branch,
+    kind_jal,
+    kind_jalr,
+    kind_halt
+};
+
+//******************************************************************************
+// This function classifies an instruction for control-flow discovery. ECALL,
+// EBREAK and anything that does not decode are halts; the translator never
+// emits code for them and leaves them to the interpreter.
+//
+// Parameters:
+//   d - The decoded instruction.
+//
+// Return value:
+//   The kind of the instruction.
+//******************************************************************************
+static insn_kind classify(const rv32i_decode::decoded_insn &d)
+{
+    switch (d.op)
+    {
+        case rv32i_decode::op_illegal:
+        case rv32i_decode::op_ecall:
+        case rv32i_decode::op_ebreak:
+            return kind_halt;
+        case rv32i_decode::op_jal:
+            return kind_jal;
+        case rv32i_decode::op_jalr:
+            return kind_jalr;
+    }
+    return d.format == rv32i_decode::fmt_b ? kind_branch : kind_normal;
+}
+
+//******************************************************************************
+// This function reads a flat binary image into a vector of bytes.
+//
+// Parameters:
+//   fname - The name of the image file.
+//   image - Filled with the contents of the file.
+//
+// Return value:
+//   true if the file could be read.
+//******************************************************************************
+static bool load_image(const string &fname, vector<uint8_t> &image)
+{
+    ifstream infile(fname, ios::in | ios::binary);
+    if (!infile)
+    {
+        cerr << "Can't open file '" << fname << "' for reading." << endl;
+        return false;
+    }
+
+    image.assign(istreambuf_iterator<char>(infile), istreambuf_iterator<char>());
+    return true;
+}
+
+//******************************************************************************
+// This function returns the little-endian word at addr in the image.
+//******************************************************************************
+static uint32_t word_at(const vector<uint8_t> &image, uint32_t addr)
+{
+    return image[addr] | image[addr + 1] << 8 | image[addr + 2] << 16
+         | static_cast<uint32_t>(image[addr + 3]) << 24;
+}
+
+//******************************************************************************
+// This function walks the control-flow graph from pc 0. Every branch target,
+// fall-through, jump target and call return address becomes a block leader.
+//
+// Parameters:
+//   image   - The program image.
+//   leaders - Filled with the addresses at which blocks start.
+//   code    - Filled with the addresses of every reachable instruction.
+//
+// Return value:
+//   None
+//******************************************************************************
+static void discover(const vector<uint8_t> &image, set<uint32_t> &leaders, set<uint32_t> &code)
+{
+    uint32_t limit = image.size() & ~3u;
+    vector<uint32_t> work;
+
+    auto add = [&](uint32_t addr)
+    {
+        if ((addr & 3) == 0 && addr < limit && leaders.insert(addr).second)
+            work.push_back(addr);
+    };
+
+    add(0);
+
+    while (!work.empty())
+    {
+        uint32_t addr = work.back();
+        work.pop_back();
+
+        for (; addr < limit; addr += 4)
+        {
+            if (!code.insert(addr).second)
+                break;
+
+            rv32i_decode::decoded_insn d = rv32i_decode::decode_insn(addr, word_at(image, addr));
+            insn_kind k = classify(d);
+
+            if (k == kind_normal)
+                continue;
+
+            if (k == kind_branch)
+            {
+                add(d.target);
+                add(addr + 4);
+            }
+            else if (k == kind_jal)
+            {
+                add(d.target);
+                if (d.rd != 0)
+                    add(addr + 4);
+            }
+            else if (k == kind_jalr)
+            {
+                if (d.rd != 0)
+                    add(addr + 4);
+            }
+            break;
+        }
+    }
+}
+
+//******************************************************************************
+// EXPRESSION HELPERS
+// Render guest register reads as C++ expressions. x0 always reads as zero.
+//******************************************************************************
+
+static string xs(uint32_t r)
+{
+    return r == 0 ? string("0") : "x[" + to_string(r) + "]";
+}
+
+static string xu(uint32_t r)
+{
+    return r == 0 ? string("0u") : "static_cast<uint32_t>(x[" + to_string(r) + "])";
+}
+
+static string u32(uint32_t v)
+{
+    return hex::to_hex0x32(v) + "u";
+}
+
+//******************************************************************************
+// This function writes the statement that stores an expression into rd, or
+// nothing when rd is x0.
+//******************************************************************************
+static void emit_set(ostream &os, uint32_t rd, const string &expr)
+{
+    if (rd != 0)
+        os << "    x[" << rd << "] = static_cast<int32_t>(" << expr << ");\n";
+}
+
+//******************************************************************************
+// This function writes the statements that end a block and continue at a
+// constant pc.
+//******************************************************************************
+static void emit_exit(ostream &os, const string &indent, uint32_t next, uint32_t executed)
+{
+    os << indent << "s.pc = " << u32(next) << ";\n"
+       << indent << "s.executed = " << executed << ";\n";
+}
+
+//******************************************************************************
+// This function writes the C++ function for the block that starts at addr. The
+// block ends after a branch or jump, before a halting instruction, or where it
+// would run into another leader.
+//
+// Parameters:
+//   os      - The stream to write the function to.
+//   image   - The program image.
+//   leaders - The block leaders.
+//   addr    - The address of the first instruction of the block.
+//
+// Return value:
+//   The number of instructions in the block (0 if the leader is a halt).
+//******************************************************************************
+static uint32_t emit_block(ostream &os, const vector<uint8_t> &image,
+                           const set<uint32_t> &leaders, uint32_t addr)
+{
+    uint32_t limit = image.size() & ~3u;
+
+    if (classify(rv32i_decode::decode_insn(addr, word_at(image, addr))) == kind_halt)
+        return 0;
+
+    os << "static void b_" << hex::to_hex32(addr) << "(aot_state &s)\n"
+       << "{\n"
+       << "    int32_t *x = s.x;\n";
+
+    uint32_t n = 0;
+    uint32_t a = addr;
+
+    for (;;)
+    {
+        rv32i_decode::decoded_insn d = rv32i_decode::decode_insn(a, word_at(image, a));
+        insn_kind k = classify(d);
+
+        if (k == kind_halt)
+        {
+            emit_exit(os, "    ", a, n);
+            break;
+        }
+
+        ++n;
+
+        uint32_t rd  = d.rd;
+        uint32_t rs1 = d.rs1;
+        uint32_t rs2 = d.rs2;
+        uint32_t imm = static_cast<uint32_t>(d.imm);
+
+        char text[rv32i_decode::render_size];
+        os << "\n    // " << hex::to_hex32(a) << ": "
+           << string(text, rv32i_decode::render(text, d)) << "\n";
+
+        const char *op = nullptr;       // C++ operator of a branch or ALU operation
+        const char *fn = nullptr;       // memory or hart function of a load or store
+        bool is_signed = false;         // compare or shift as int32_t
+
+        switch (d.op)
+        {
+            case rv32i_decode::op_beq:  op = "==";                  break;
+            case rv32i_decode::op_bne:  op = "!=";                  break;
+            case rv32i_decode::op_blt:  op = "<";  is_signed = true; break;
+            case rv32i_decode::op_bge:  op = ">="; is_signed = true; break;
+            case rv32i_decode::op_bltu: op = "<";                   break;
+            case rv32i_decode::op_bgeu: op = ">=";                  break;
+
+            case rv32i_decode::op_lb:  fn = "get8_sx";  break;
+            case rv32i_decode::op_lh:  fn = "get16_sx"; break;
+            case rv32i_decode::op_lw:  fn = "get32_sx"; break;
+            case rv32i_decode::op_lbu: fn = "get8";     break;
+            case rv32i_decode::op_lhu: fn = "get16";    break;
+
+            case rv32i_decode::op_sb: fn = "store8";  break;
+            case rv32i_decode::op_sh: fn = "store16"; break;
+            case rv32i_decode::op_sw: fn = "store32"; break;
+
+            case rv32i_decode::op_addi: case rv32i_decode::op_add:  op = "+";  break;
+            case rv32i_decode::op_sub:                              op = "-";  break;
+            case rv32i_decode::op_xori: case rv32i_decode::op_xor:  op = "^";  break;
+            case rv32i_decode::op_ori:  case rv32i_decode::op_or:   op = "|";  break;
+            case rv32i_decode::op_andi: case rv32i_decode::op_and:  op = "&";  break;
+            case rv32i_decode::op_slli: case rv32i_decode::op_sll:  op = "<<"; break;
+            case rv32i_decode::op_srli: case rv32i_decode::op_srl:  op = ">>"; break;
+            case rv32i_decode::op_srai: case rv32i_decode::op_sra:  op = ">>"; is_signed = true; break;
+        }
+
+        switch (d.op)
+        {
+            case rv32i_decode::op_lui:
+                emit_set(os, rd, u32(imm));
+                break;
+
+            case rv32i_decode::op_auipc:
+                emit_set(os, rd, u32(a + imm));
+                break;
+
+            case rv32i_decode::op_jal:
+                emit_set(os, rd, u32(a + 4));
+                emit_exit(os, "    ", d.target, n);
+                break;
+
+            case rv32i_decode::op_jalr:
+                os << "    uint32_t target = (" << xu(rs1) << " + " << u32(imm) << ") & ~1u;\n";
+                emit_set(os, rd, u32(a + 4));
+                os << "    s.pc = target;\n"
+                   << "    s.executed = " << n << ";\n";
+                break;
+
+            case rv32i_decode::op_beq: case rv32i_decode::op_bne:
+            case rv32i_decode::op_blt: case rv32i_decode::op_bge:
+            case rv32i_decode::op_bltu: case rv32i_decode::op_bgeu:
+            {
+                string v1 = is_signed ? xs(rs1) : xu(rs1);
+                string v2 = is_signed ? xs(rs2) : xu(rs2);
+                os << "    s.pc = (" << v1 << " " << op << " " << v2 << ") ? "
+                   << u32(d.target) << " : " << u32(a + 4) << ";\n"
+                   << "    s.executed = " << n << ";\n";
+                break;
+            }
+
+            case rv32i_decode::op_lb: case rv32i_decode::op_lh: case rv32i_decode::op_lw:
+            case rv32i_decode::op_lbu: case rv32i_decode::op_lhu:
+            {
+                string load = string("s.mem->") + fn + "(" + xu(rs1) + " + " + u32(imm) + ")";
+                if (rd != 0)
+                    emit_set(os, rd, load);
+                else
+                    os << "    (void)" << load << ";\n";
+                break;
+            }
+
+            case rv32i_decode::op_sb: case rv32i_decode::op_sh: case rv32i_decode::op_sw:
+                os << "    if (s.hart->" << fn << "(" << xu(rs1) << " + "
+                   << u32(imm) << ", " << xu(rs2) << "))\n"
+                   << "    {\n";
+                emit_exit(os, "        ", a + 4, n);
+                os << "        return;\n"
+                   << "    }\n";
+                break;
+
+            case rv32i_decode::op_slti:
+                emit_set(os, rd, xs(rs1) + " < " + to_string(d.imm) + " ? 1 : 0");
+                break;
+
+            case rv32i_decode::op_sltiu:
+                emit_set(os, rd, xu(rs1) + " < " + u32(imm) + " ? 1 : 0");
+                break;
+
+            case rv32i_decode::op_slt:
+                emit_set(os, rd, xs(rs1) + " < " + xs(rs2) + " ? 1 : 0");
+                break;
+
+            case rv32i_decode::op_sltu:
+                emit_set(os, rd, xu(rs1) + " < " + xu(rs2) + " ? 1 : 0");
+                break;
+
+            case rv32i_decode::op_slli: case rv32i_decode::op_srli: case rv32i_decode::op_srai:
+                emit_set(os, rd, (is_signed ? "static_cast<int32_t>(" + xu(rs1) + ")" : xu(rs1))
+                                 + " " + op + " " + to_string(imm));
+                break;
+
+            case rv32i_decode::op_sll: case rv32i_decode::op_srl: case rv32i_decode::op_sra:
+                emit_set(os, rd, (is_signed ? "static_cast<int32_t>(" + xu(rs1) + ")" : xu(rs1))
+                                 + " " + op + " (" + xu(rs2) + " & 0x1f)");
+                break;
+
+            case rv32i_decode::op_addi: case rv32i_decode::op_xori:
+            case rv32i_decode::op_ori: case rv32i_decode::op_andi:
+                emit_set(os, rd, xu(rs1) + " " + op + " " + u32(imm));
+                break;
+
+            case rv32i_decode::op_add: case rv32i_decode::op_sub: case rv32i_decode::op_xor:
+            case rv32i_decode::op_or: case rv32i_decode::op_and:
+                emit_set(os, rd, xu(rs1) + " " + op + " " + xu(rs2));
+                break;
+
+            default:
+                // the CSR instructions all read as zero in this simulator
+                emit_set(os, rd, "0");
+                break;
+        }
+
+        if (k != kind_normal)
+            break;
+
+        a += 4;
+        if (a >= limit || leaders.count(a) || n >= max_block_insns)
+        {
+            emit_exit(os, "    ", a, n);
+            break;
+        }
+    }
+
+    os << "}\n\n";
+    return n;
+}
+
+//******************************************************************************
+// This function writes the whole generated program: the block functions, the
+// sorted block table, the list of translated words and a main() that accepts
+// the simulation options of rv32i.
+//
+// Parameters:
+//   os    - The stream to write the program to.
+//   fname - The name of the image (for the header comment).
+//   image - The program image.
+//
+// Return value:
+//   None
+//******************************************************************************
+static void emit_program(ostream &os, const string &fname, const vector<uint8_t> &image)
+{
+    set<uint32_t> leaders;
+    set<uint32_t> code;
+    discover(image, leaders, code);
+
+    os << "//******************************************************************************\n"
+       << "// Generated by rv32i_aot from " << fname << ". Do not edit.\n"
+       << "//******************************************************************************\n\n"
+       << "#include <iostream>\n"
+       << "#include <sstream>\n"
+       << "#include <cstdint>\n"
+       << "#include <cstdlib>\n"
+       << "#include <unistd.h>\n\n"
+       << "#include \"aot_hart.h\"\n"
+       << "#include \"memory.h\"\n\n"
+       << "using namespace std;\n\n";
+
+    map<uint32_t, uint32_t> lengths;
+    for (uint32_t addr : leaders)
+    {
+        uint32_t n = emit_block(os, image, leaders, addr);
+        if (n)
+            lengths[addr] = n;
+    }
+
+    os << "static const aot_block blocks[] =\n{\n";
+    for (const auto &b : lengths)
+        os << "    { " << u32(b.first) << ", " << b.second << ", b_" << hex::to_hex32(b.first) << " },\n";
+    os << "};\n\n";
+
+    os << "static const aot_word words[] =\n{\n";
+    for (uint32_t addr : code)
+        os << "    { " << u32(addr) << ", " << u32(word_at(image, addr)) << " },\n";
+    os << "};\n\n";
+
+    os << "static void usage()\n"
+       << "{\n"
+       << "    cerr << \"Usage: " << "aot [-s] [-z] [-l exec_limit] [-m hex-mem-size] infile\" << endl;\n"
+       << "    exit(1);\n"
+       << "}\n\n"
+       << "int main(int argc, char **argv)\n"
+       << "{\n"
+       << "    uint32_t memory_limit = 0x100;\n"
+       << "    uint64_t exec_limit   = 0;\n"
+       << "    bool opt_show_speed   = false;\n"
+       << "    bool opt_final_dump   = false;\n"
+       << "    int opt;\n\n"
+       << "    while ((opt = getopt(argc, argv, \"m:szl:\")) != -1)\n"
+       << "    {\n"
+       << "        switch (opt)\n"
+       << "        {\n"
+       << "            case 'm':\n"
+       << "            {\n"
+       << "                istringstream iss(optarg);\n"
+       << "                iss >> std::hex >> memory_limit;\n"
+       << "                if (!iss)\n"
+       << "                    usage();\n"
+       << "                break;\n"
+       << "            }\n"
+       << "            case 'l':\n"
+       << "            {\n"
+       << "                istringstream iss(optarg);\n"
+       << "                iss >> exec_limit;\n"
+       << "                if (!iss)\n"
+       << "                    usage();\n"
+       << "                break;\n"
+       << "            }\n"
+       << "            case 's': opt_show_speed = true; break;\n"
+       << "            case 'z': opt_final_dump = true; break;\n"
+       << "            default:  usage();\n"
+       << "        }\n"
+       << "    }\n\n"
+       << "    if (optind >= argc)\n"
+       << "        usage();\n\n"
+       << "    memory mem(memory_limit);\n"
+       << "    if (!mem.load_file(argv[optind]))\n"
+       << "        usage();\n\n"
+       << "    aot_hart cpu(mem, blocks, sizeof(blocks) / sizeof(blocks[0]),\n"
+       << "                 words, sizeof(words) / sizeof(words[0]));\n"
+       << "    cpu.reset();\n"
+       << "    cpu.set_mhartid(0);\n"
+       << "    cpu.set_show_speed(opt_show_speed);\n"
+       << "    cpu.run(exec_limit);\n\n"
+       << "    if (opt_final_dump)\n"
+       << "    {\n"
+       << "        cpu.dump(\"\");\n"
+       << "        mem.dump();\n"
+       << "    }\n\n"
+       << "    return 0;\n"
+       << "}\n";
+}
+
+static void usage()
+{
+    cerr << "Usage: rv32i_aot [-o outfile] infile" << endl;
+    cerr << "    -o  write the generated C++ to outfile (default = standard output)" << endl;
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    string outname;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'o':
+                outname = optarg;
+                break;
+
+            default:
+                usage();
+        }
+    }
+
+    if (optind >= argc)
+        usage();
+
+    vector<uint8_t> image;
+    if (!load_image(argv[optind], image))
+        usage();
+
+    if (outname.empty())
+    {
+        emit_program(cout, argv[optind], image);
+        return 0;
+    }
+
+    ofstream outfile(outname);
+    if (!outfile)
+    {
+        cerr << "Can't open file '" << outname << "' for writing." << endl;
+        return 1;
+    }
+
+    emit_program(outfile, argv[optind], image);
+    return 0;
+}
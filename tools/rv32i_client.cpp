@@ -0,0 +1,248 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+
+//******************************************************************************
+// rv32i_client sends jobs to a simulator started with `rv32i -u socket` and
+// prints what became of them: for each image the text of its traces, then a
+// line with the image name and the fields of a row of `rv32i -j`. The jobs are
+// sent one after another over one connection. It needs none of the simulator
+// sources:
+//
+//     g++ -O2 tools/rv32i_client.cpp -o rv32i_client
+//     ./rv32i_client [-m hex-mem-size] [-l exec_limit] [-i] [-r] [-x] [-s] [-q] socket [image...]
+//
+// Images are sent by (absolute) file name, so the server reads each file and
+// reads it again only when it has changed; with -x their bytes are sent
+// instead, for a server that can't see the client's files.
+//******************************************************************************
+
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+//******************************************************************************
+// Print a usage message and abort the program.
+//******************************************************************************
+static void usage()
+{
+    cerr << "Usage: rv32i_client [-m hex-mem-size] [-l exec_limit] [-i] [-r] [-x] [-s] [-q] socket [image...]" << endl;
+    cerr << "    -m  specify memory size in hex (default = 0x100)" << endl;
+    cerr << "    -l  limit the number of instructions executed (0 = no limit)" << endl;
+    cerr << "    -i  show instructions as they execute" << endl;
+    cerr << "    -r  show register dump before each instruction" << endl;
+    cerr << "    -x  send the bytes of the images rather than their names" << endl;
+    cerr << "    -s  show the server's job and image cache counts after the jobs" << endl;
+    cerr << "    -q  ask the server to quit after the jobs" << endl;
+    exit(1);
+}
+
+//******************************************************************************
+// This function sends all of s.
+//
+// Parameters:
+//   fd - The connection.
+//   s  - What to send.
+//
+// Return value:
+//   true if all of it was sent.
+//******************************************************************************
+static bool send_all(int fd, const string &s)
+{
+    for (size_t done = 0; done < s.size(); )
+    {
+        ssize_t k = send(fd, s.data() + done, s.size() - done, MSG_NOSIGNAL);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k <= 0)
+            return false;
+        done += k;
+    }
+    return true;
+}
+
+//******************************************************************************
+// This function sends a request and receives the reply to it.
+//
+// Parameters:
+//   fd      - The connection.
+//   request - The request, with its newline (and bytes).
+//   body    - Set to the body of the reply.
+//
+// Return value:
+//   true if the reply is ok, false (after printing why) if not.
+//******************************************************************************
+static bool call(int fd, const string &request, string &body)
+{
+    if (!send_all(fd, request))
+    {
+        cerr << "Can't send to the server: " << strerror(errno) << "." << endl;
+        return false;
+    }
+
+    // the reply is a header line and then the number of bytes it gives
+    string header;
+    char c;
+    ssize_t k;
+    while ((k = recv(fd, &c, 1, 0)) == 1 && c != '\n')
+        header += c;
+
+    istringstream iss(header);
+    string status;
+    size_t n = 0;
+    if (k != 1 || !(iss >> status) || status != "ok" || !(iss >> n))
+    {
+        cerr << "The server replied: " << (k == 1 ? header : "nothing") << endl;
+        return false;
+    }
+
+    body.resize(n);
+    for (size_t done = 0; done < n; done += k)
+    {
+        k = recv(fd, &body[done], n - done, 0);
+        if (k <= 0)
+        {
+            cerr << "The server closed the connection." << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    string mem_size = "100";
+    uint64_t exec_limit = 0;
+    string trace;
+    bool opt_inline = false;
+    bool opt_stats = false;
+    bool opt_quit = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:l:irxsq")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                mem_size = optarg;
+                if (mem_size.empty() || mem_size.find_first_not_of("0123456789abcdefABCDEF") != string::npos)
+                    usage();
+                break;
+
+            case 'l':
+            {
+                istringstream iss(optarg);
+                if (!(iss >> exec_limit))
+                    usage();
+                break;
+            }
+
+            case 'i':
+            case 'r':
+                trace += static_cast<char>(opt);
+                break;
+
+            case 'x':
+                opt_inline = true;
+                break;
+
+            case 's':
+                opt_stats = true;
+                break;
+
+            case 'q':
+                opt_quit = true;
+                break;
+
+            default:
+                usage();
+        }
+    }
+
+    if (optind >= argc)
+        usage();
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    string path = argv[optind++];
+    if (path.size() >= sizeof(addr.sun_path))
+        usage();
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+    {
+        cerr << "Can't connect to '" << path << "': " << strerror(errno) << "." << endl;
+        return 1;
+    }
+
+    string prefix = "run " + mem_size + " " + to_string(exec_limit) + " " + (trace.empty() ? "-" : trace) + " ";
+    string body;
+    int status = 0;
+
+    for (; optind < argc; ++optind)
+    {
+        string image = argv[optind];
+        string request;
+        if (opt_inline)
+        {
+            ifstream in(image, ios::in | ios::binary);
+            string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+            if (!in && !in.eof())
+            {
+                cerr << "Can't open file '" << image << "' for reading." << endl;
+                status = 1;
+                continue;
+            }
+            request = prefix + "bytes " + to_string(bytes.size()) + "\n" + bytes;
+        }
+        else
+        {
+            char full[PATH_MAX];
+            request = prefix + "file " + (realpath(image.c_str(), full) ? full : image.c_str()) + "\n";
+        }
+
+        if (!call(fd, request, body))
+            return 1;
+
+        // the result is the last line of the body, after the trace
+        size_t row = body.rfind('\n', body.size() - 2);
+        row = row == string::npos ? 0 : row + 1;
+        cout << body.substr(0, row) << image << "\t" << body.substr(row);
+        if (body.compare(row, 5, "error") == 0)
+            status = 1;
+    }
+
+    if (opt_stats)
+    {
+        if (!call(fd, "stats\n", body))
+            return 1;
+        cout << body;
+    }
+
+    if (opt_quit && !call(fd, "quit\n", body))
+        return 1;
+
+    close(fd);
+    return status;
+}
@@ -0,0 +1,110 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+//******************************************************************************
+// rv32i_trace expands a binary trace written with `rv32i -b tracefile` back
+// into exactly the text that `rv32i -i` prints for the same run, including the
+// range warnings and the final halt and instruction count lines. With -r the
+// register dumps of `rv32i -i -r` are added as well (and with -k interval
+// those of `rv32i -i -r -k interval`). It is built together
+// with the simulator sources (everything except main.cpp):
+//
+//     g++ -O2 -I. tools/rv32i_trace.cpp $(ls *.cpp | grep -v main.cpp) -o rv32i_trace
+//     ./rv32i_trace [-r] [-k interval] tracefile
+//
+// The trace is replayed on a trace_replay_hart, so the text is produced by the
+// same code that produces it in the simulator.
+//******************************************************************************
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "../trace_replay_hart.h"
+#include "../trace_reader.h"
+
+using namespace std;
+
+//******************************************************************************
+// Print a usage message and abort the program.
+//******************************************************************************
+static void usage()
+{
+    cerr << "Usage: rv32i_trace [-r] [-k interval] tracefile" << endl;
+    cerr << "    -r  show register dump before each instruction" << endl;
+    cerr << "    -k  with -r, show only changed registers, with a full dump every interval instructions" << endl;
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    static char cout_buffer[1 << 20];
+    ios::sync_with_stdio(false);
+    cout.rdbuf()->pubsetbuf(cout_buffer, sizeof(cout_buffer));
+
+    bool opt_show_regs = false;
+    uint32_t keyframes = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "rk:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r':
+                opt_show_regs = true;
+                break;
+
+            case 'k':
+                keyframes = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+                if (keyframes == 0)
+                    usage();
+                break;
+
+            default:
+                usage();
+        }
+    }
+
+    if (optind >= argc)
+        usage();
+
+    trace_reader trace;
+    if (!trace.open(argv[optind]))
+    {
+        cerr << "Can't read binary trace '" << argv[optind] << "'." << endl;
+        return 1;
+    }
+
+    memory mem(static_cast<uint32_t>(trace.get_mem_size() - 1));
+    trace_replay_hart hart(mem);
+    hart.set_show_instructions(true);
+    hart.set_show_registers(opt_show_regs);
+    hart.set_register_keyframes(keyframes);
+    hart.start();
+
+    uint64_t mismatches = 0;
+    trace_record r;
+    while (trace.next(r))
+        if (!hart.step(r))
+            ++mismatches;
+    hart.finish(trace.is_halted());
+
+    if (trace.is_halted())
+        cout << "Execution terminated. Reason: " << trace.get_halt_reason() << "\n";
+    cout << trace.get_insn_count() << " instructions executed" << endl;
+
+    if (!trace.is_complete())
+        cerr << "WARNING: the trace ends early or is damaged" << endl;
+    if (mismatches)
+        cerr << "WARNING: " << mismatches << " instructions did not replay as recorded" << endl;
+
+    return trace.is_complete() && !mismatches ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "trace_reader.h"
+#include <cstring>
+
+using namespace std;
+
+//******************************************************************************
+// This function opens a trace file and reads its header.
+//
+// Parameters:
+//   fname - The name of the trace file.
+//
+// Return value:
+//   true if the file could be opened and is a binary trace.
+//******************************************************************************
+bool trace_reader::open(const string &fname)
+{
+    in.open(fname, ios::in | ios::binary);
+    if (!in)
+        return false;
+
+    uint8_t hdr[16];
+    if (!in.read(reinterpret_cast<char *>(hdr), sizeof(hdr)) || memcmp(hdr, "RV32BTR1", 8) != 0)
+        return false;
+
+    mem_size = 0;
+    for (int i = 0; i < 8; ++i)
+        mem_size |= static_cast<uint64_t>(hdr[8 + i]) << (8 * i);
+    return true;
+}
+
+//******************************************************************************
+// This function reads the next retired instruction from the trace.
+//
+// Parameters:
+//   r - Set to the instruction.
+//
+// Return value:
+//   true if there was another instruction, false at the end of the trace (or
+//   when the trace is damaged, see is_complete()).
+//******************************************************************************
+bool trace_reader::next(trace_record &r)
+{
+    uint8_t flags;
+    if (!get_byte(flags))
+        return false;
+
+    if (flags == trace_record::rec_end)
+    {
+        uint32_t lo, hi, n;
+        uint8_t h;
+        if (!get_varint(lo) || !get_varint(hi) || !get_byte(h) || !get_varint(n))
+            return false;
+
+        halt_reason.clear();
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            uint8_t c;
+            if (!get_byte(c))
+                return false;
+            halt_reason += static_cast<char>(c);
+        }
+
+        insn_count = (static_cast<uint64_t>(hi) << 32) | lo;
+        halted = h != 0;
+        complete = true;
+        return false;
+    }
+
+    uint32_t delta = 0;
+    if ((flags & trace_record::rec_jump) && !get_svarint(delta))
+        return false;
+    r.pc = prev_pc + 4 + delta;
+    prev_pc = r.pc;
+
+    r.insn = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        uint8_t b;
+        if (!get_byte(b))
+            return false;
+        r.insn |= static_cast<uint32_t>(b) << (8 * i);
+    }
+
+    r.rd = 0;
+    r.rd_value = 0;
+    if (flags & trace_record::rec_rd)
+    {
+        uint8_t rd;
+        if (!get_byte(rd) || rd >= 32 || !get_svarint(delta))
+            return false;
+        r.rd = rd;
+        r.rd_value = last_value[rd] + delta;
+        last_value[rd] = r.rd_value;
+    }
+
+    r.has_mem = (flags & trace_record::rec_mem) != 0;
+    r.mem_addr = 0;
+    r.mem_value = 0;
+    if (r.has_mem)
+    {
+        if (!get_svarint(delta) || !get_varint(r.mem_value))
+            return false;
+        r.mem_addr = prev_addr + delta;
+        prev_addr = r.mem_addr;
+    }
+
+    return true;
+}
+
+//******************************************************************************
+// This function reads and unpacks the next block of the trace.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   true if a block was read.
+//******************************************************************************
+bool trace_reader::fill()
+{
+    uint8_t hdr[8];
+    if (!in.read(reinterpret_cast<char *>(hdr), sizeof(hdr)))
+        return false;
+
+    uint32_t raw_len = 0, packed_len = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        raw_len    |= static_cast<uint32_t>(hdr[i]) << (8 * i);
+        packed_len |= static_cast<uint32_t>(hdr[4 + i]) << (8 * i);
+    }
+
+    packed.resize(packed_len);
+    if (!in.read(reinterpret_cast<char *>(packed.data()), packed_len))
+        return false;
+
+    pos = 0;
+    if (packed_len == raw_len)
+    {
+        block.swap(packed);
+        return true;
+    }
+    return decompress(packed.data(), packed.size(), block, raw_len);
+}
+
+//******************************************************************************
+// These functions take the next byte, LEB128 varint or zigzag varint from the
+// current block, moving on to the next block as needed.
+//
+// Parameters:
+//   b, v - Set to the value read.
+//
+// Return value:
+//   true if the value could be read.
+//******************************************************************************
+bool trace_reader::get_byte(uint8_t &b)
+{
+    while (pos >= block.size())
+        if (!fill())
+            return false;
+
+    b = block[pos++];
+    return true;
+}
+
+bool trace_reader::get_varint(uint32_t &v)
+{
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        uint8_t b;
+        if (!get_byte(b))
+            return false;
+        v |= static_cast<uint32_t>(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool trace_reader::get_svarint(uint32_t &v)
+{
+    if (!get_varint(v))
+        return false;
+    v = (v >> 1) ^ (0 - (v & 1));
+    return true;
+}
+
+//******************************************************************************
+// This function undoes trace_writer::compress().
+//
+// Parameters:
+//   in      - The compressed bytes.
+//   len     - The number of compressed bytes.
+//   out     - Replaced by the decompressed bytes.
+//   raw_len - The expected number of decompressed bytes.
+//
+// Return value:
+//   true if the data decompressed to exactly raw_len bytes.
+//******************************************************************************
+bool trace_reader::decompress(const uint8_t *in, size_t len, vector<uint8_t> &out, size_t raw_len)
+{
+    out.clear();
+    out.reserve(raw_len);
+
+    const uint8_t *p = in;
+    const uint8_t *end = in + len;
+
+    auto get_length = [&p, end](size_t &n)
+    {
+        uint8_t b;
+        do
+        {
+            if (p == end)
+                return false;
+            b = *p++;
+            n += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (p < end)
+    {
+        uint8_t token = *p++;
+
+        size_t lit = token >> 4;
+        if (lit == 15 && !get_length(lit))
+            return false;
+        if (lit > static_cast<size_t>(end - p) || out.size() + lit > raw_len)
+            return false;
+        out.insert(out.end(), p, p + lit);
+        p += lit;
+
+        if (p == end)
+            break;
+
+        if (end - p < 2)
+            return false;
+        size_t dist = p[0] | (p[1] << 8);
+        p += 2;
+
+        size_t n = token & 0xf;
+        if (n == 15 && !get_length(n))
+            return false;
+        n += 4;
+
+        if (dist == 0 || dist > out.size() || out.size() + n > raw_len)
+            return false;
+
+        // byte by byte, since the match may overlap the bytes it produces
+        size_t from = out.size() - dist;
+        for (size_t i = 0; i < n; ++i)
+            out.push_back(out[from + i]);
+    }
+
+    return out.size() == raw_len;
+}
@@ -0,0 +1,69 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "trace_record.h"
+
+using namespace std;
+
+//******************************************************************************
+// This class reads back a binary trace written by trace_writer, one retired
+// instruction at a time, decompressing a block whenever the previous one has
+// been used up.
+//******************************************************************************
+class trace_reader
+{
+public:
+    bool open(const string &fname);
+    bool next(trace_record &r);
+
+    static bool decompress(const uint8_t *in, size_t len, vector<uint8_t> &out, size_t raw_len);
+
+    //******************************************************************************
+    // These functions return the memory size from the header and, once next()
+    // has returned false, the final state of the hart from the end record.
+    //******************************************************************************
+    uint64_t get_mem_size() const            { return mem_size; }
+    bool is_halted() const                   { return halted; }
+    const string &get_halt_reason() const    { return halt_reason; }
+    uint64_t get_insn_count() const          { return insn_count; }
+
+    //******************************************************************************
+    // This function reports whether the trace was read all the way to its end
+    // record (rather than stopping at damaged or missing data).
+    //******************************************************************************
+    bool is_complete() const                 { return complete; }
+
+private:
+    bool fill();
+    bool get_byte(uint8_t &b);
+    bool get_varint(uint32_t &v);
+    bool get_svarint(uint32_t &v);
+
+    ifstream in;
+    vector<uint8_t> block;
+    vector<uint8_t> packed;
+    size_t pos = 0;
+
+    uint64_t mem_size = 0;
+    uint32_t prev_pc = 0xfffffffc;
+    uint32_t prev_addr = 0;
+    uint32_t last_value[32] = {};
+
+    bool complete = false;
+    bool halted = false;
+    string halt_reason;
+    uint64_t insn_count = 0;
+};
@@ -0,0 +1,72 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+//******************************************************************************
+// One retired instruction in a binary trace (see trace_writer and trace_reader).
+//
+// A trace file starts with the 8 byte magic "RV32BTR1" and the 64-bit memory
+// size, followed by blocks of records. Each block is stored as its raw length
+// and its packed length (both 32-bit little-endian) and the packed bytes; a
+// block whose packed length equals its raw length is stored uncompressed,
+// any other block is compressed with the LZ codec in trace_writer.cpp.
+//
+// A record is a flags byte followed by the fields the flags select:
+//   rec_jump  - zigzag varint of pc - (previous pc + 4)
+//               (always the 4 byte little-endian instruction word)
+//   rec_rd    - rd, then zigzag varint of the new value - the last value
+//               recorded for rd
+//   rec_mem   - zigzag varint of addr - previous memory address, then a
+//               varint of the loaded or stored value
+// A flags byte of rec_end ends the trace and is followed by the instruction
+// count (varints of its low and high 32 bits), a halted byte and the halt
+// reason as a varint length and that many characters.
+//******************************************************************************
+struct trace_record
+{
+    uint32_t pc;
+    uint32_t insn;
+    uint32_t rd;            // 0 = no register was written
+    uint32_t rd_value;
+    bool     has_mem;       // a load or store
+    uint32_t mem_addr;
+    uint32_t mem_value;     // loaded (extended) or stored (truncated) value
+
+    static constexpr uint8_t rec_jump = 0x01;
+    static constexpr uint8_t rec_rd   = 0x02;
+    static constexpr uint8_t rec_mem  = 0x04;
+    static constexpr uint8_t rec_end  = 0x80;
+
+    static constexpr uint32_t block_size = 1 << 16;
+};
+
+//******************************************************************************
+// Anything that retired instructions can be recorded to: a binary trace file
+// (trace_writer) or the background trace formatter (async_trace).
+//******************************************************************************
+class trace_sink
+{
+public:
+    virtual ~trace_sink() {}
+
+    //******************************************************************************
+    // This function records one retired instruction.
+    //
+    // Parameters:
+    //   r - The instruction.
+    //
+    // Return value:
+    //   None
+    //******************************************************************************
+    virtual void write(const trace_record &r) = 0;
+};
@@ -0,0 +1,95 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "trace_replay_hart.h"
+
+using namespace std;
+
+//******************************************************************************
+// This function resets the hart and sets up the registers as
+// cpu_single_hart::run() does before the first recorded instruction.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   None
+//******************************************************************************
+void trace_replay_hart::start()
+{
+    reset();
+    regs.set(2, static_cast<int32_t>(mem.get_size()));
+}
+
+//******************************************************************************
+// This function executes one recorded instruction.
+//
+// Parameters:
+//   r - The instruction.
+//
+// Return value:
+//   true if the register it wrote got the recorded value.
+//******************************************************************************
+bool trace_replay_hart::step(const trace_record &r)
+{
+    pc = r.pc;
+    if (!(r.pc & 3) && r.pc < mem.get_size())
+        seed(r.pc, r.insn, 4);
+
+    if (r.has_mem && get_opcode(r.insn) == opcode_load)
+        seed(r.mem_addr, r.mem_value, 1u << (get_funct3(r.insn) & 3));
+
+    tick("");
+
+    return !r.rd || static_cast<uint32_t>(regs.get(r.rd)) == r.rd_value;
+}
+
+//******************************************************************************
+// This function ends the replay. A run that ended with a halt that retired
+// nothing (a misaligned pc) gets the final tick() that halted it.
+//
+// Parameters:
+//   halted - true if the recorded hart halted.
+//
+// Return value:
+//   None
+//******************************************************************************
+void trace_replay_hart::finish(bool halted)
+{
+    if (halted && !is_halted())
+        tick("");
+}
+
+//******************************************************************************
+// This function stores the width low bytes of val at addr, skipping any byte
+// that is outside the memory (the simulator reads those as zero anyway) or
+// that already holds the right value.
+//
+// Parameters:
+//   addr  - The address of the first byte.
+//   val   - The value to store, least significant byte first.
+//   width - The number of bytes.
+//
+// Return value:
+//   None
+//******************************************************************************
+void trace_replay_hart::seed(uint32_t addr, uint32_t val, uint32_t width)
+{
+    for (uint32_t i = 0; i < width; ++i)
+    {
+        uint32_t a = addr + i;
+        uint8_t b = static_cast<uint8_t>(val >> (8 * i));
+        if (a < mem.get_size() && mem.get8(a) != b)
+        {
+            mem.set8(a, b);
+            invalidate(a, 1);
+        }
+    }
+}
@@ -0,0 +1,36 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include "rv32i_hart.h"
+#include "trace_record.h"
+
+using namespace std;
+
+//******************************************************************************
+// A hart that executes recorded instructions instead of the ones in its memory.
+// Its memory is seeded with each instruction word and loaded value just before
+// it is needed, so tick() prints exactly the trace (and range warnings) that
+// the hart that recorded them printed, or would have printed.
+//******************************************************************************
+class trace_replay_hart : public rv32i_hart
+{
+public:
+    trace_replay_hart(memory &m) : rv32i_hart(m) {}
+
+    void start();
+    bool step(const trace_record &r);
+    void finish(bool halted);
+
+private:
+    void seed(uint32_t addr, uint32_t val, uint32_t width);
+};
@@ -0,0 +1,256 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#include "trace_writer.h"
+#include <cstring>
+
+using namespace std;
+
+//******************************************************************************
+// destructor finishes a trace that was not closed, without a halt reason
+//******************************************************************************
+trace_writer::~trace_writer()
+{
+    if (out.is_open())
+        close(false, "", 0);
+}
+
+//******************************************************************************
+// This function creates the trace file and writes its header.
+//
+// Parameters:
+//   fname    - The name of the trace file.
+//   mem_size - The size of the simulated memory, needed to replay the trace.
+//
+// Return value:
+//   true if the file could be created.
+//******************************************************************************
+bool trace_writer::open(const string &fname, uint64_t mem_size)
+{
+    out.open(fname, ios::out | ios::binary | ios::trunc);
+    if (!out)
+        return false;
+
+    uint8_t hdr[16] = { 'R', 'V', '3', '2', 'B', 'T', 'R', '1' };
+    for (int i = 0; i < 8; ++i)
+        hdr[8 + i] = static_cast<uint8_t>(mem_size >> (8 * i));
+    out.write(reinterpret_cast<const char *>(hdr), sizeof(hdr));
+
+    raw.reserve(trace_record::block_size + 64);
+    return true;
+}
+
+//******************************************************************************
+// This function appends one retired instruction to the trace.
+//
+// Parameters:
+//   r - The instruction to record.
+//
+// Return value:
+//   None
+//******************************************************************************
+void trace_writer::write(const trace_record &r)
+{
+    uint8_t flags = 0;
+    if (r.pc != prev_pc + 4)
+        flags |= trace_record::rec_jump;
+    if (r.rd)
+        flags |= trace_record::rec_rd;
+    if (r.has_mem)
+        flags |= trace_record::rec_mem;
+
+    raw.push_back(flags);
+
+    if (flags & trace_record::rec_jump)
+        put_svarint(r.pc - (prev_pc + 4));
+    prev_pc = r.pc;
+
+    for (int i = 0; i < 4; ++i)
+        raw.push_back(static_cast<uint8_t>(r.insn >> (8 * i)));
+
+    if (flags & trace_record::rec_rd)
+    {
+        raw.push_back(static_cast<uint8_t>(r.rd));
+        put_svarint(r.rd_value - last_value[r.rd]);
+        last_value[r.rd] = r.rd_value;
+    }
+
+    if (flags & trace_record::rec_mem)
+    {
+        put_svarint(r.mem_addr - prev_addr);
+        prev_addr = r.mem_addr;
+        put_varint(r.mem_value);
+    }
+
+    if (raw.size() >= trace_record::block_size)
+        flush_block();
+}
+
+//******************************************************************************
+// This function ends the trace with the final state of the hart and closes the
+// file.
+//
+// Parameters:
+//   halted      - true if the hart halted.
+//   halt_reason - Why it halted.
+//   insn_count  - The number of instructions executed.
+//
+// Return value:
+//   None
+//******************************************************************************
+void trace_writer::close(bool halted, const string &halt_reason, uint64_t insn_count)
+{
+    raw.push_back(trace_record::rec_end);
+    put_varint(static_cast<uint32_t>(insn_count));
+    put_varint(static_cast<uint32_t>(insn_count >> 32));
+    raw.push_back(halted ? 1 : 0);
+    put_varint(halt_reason.size());
+    raw.insert(raw.end(), halt_reason.begin(), halt_reason.end());
+
+    flush_block();
+    out.close();
+}
+
+//******************************************************************************
+// These functions append an unsigned LEB128 varint, and a zigzag encoded one
+// for values that are really signed differences, to the block buffer.
+//
+// Parameters:
+//   v - The value to append.
+//
+// Return value:
+//   None
+//******************************************************************************
+void trace_writer::put_varint(uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        raw.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    raw.push_back(static_cast<uint8_t>(v));
+}
+
+void trace_writer::put_svarint(uint32_t v)
+{
+    put_varint((v << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(v) >> 31));
+}
+
+//******************************************************************************
+// This function compresses the block buffer and writes it to the file. A block
+// that does not get smaller is written as it is.
+//
+// Parameters:
+//   None
+//
+// Return value:
+//   None
+//******************************************************************************
+void trace_writer::flush_block()
+{
+    if (raw.empty())
+        return;
+
+    compress(raw.data(), raw.size(), packed);
+
+    const vector<uint8_t> &data = packed.size() < raw.size() ? packed : raw;
+
+    uint8_t hdr[8];
+    for (int i = 0; i < 4; ++i)
+    {
+        hdr[i]     = static_cast<uint8_t>(raw.size() >> (8 * i));
+        hdr[4 + i] = static_cast<uint8_t>(data.size() >> (8 * i));
+    }
+    out.write(reinterpret_cast<const char *>(hdr), sizeof(hdr));
+    out.write(reinterpret_cast<const char *>(data.data()), data.size());
+
+    raw.clear();
+}
+
+//******************************************************************************
+// This function compresses len bytes with a small LZ77 codec. The output is a
+// series of sequences, each a token byte holding the number of literals (high
+// nibble) and the match length - 4 (low nibble), where 15 means that more
+// length bytes follow (each adding up to 255). The token is followed by the
+// extra literal length bytes, the literals, the 16-bit little-endian distance
+// back to the match and the extra match length bytes. The last sequence has
+// only literals. Matches are found through a hash of the next 4 bytes.
+//
+// Parameters:
+//   in  - The bytes to compress.
+//   len - The number of bytes.
+//   out - Replaced by the compressed bytes.
+//
+// Return value:
+//   None
+//******************************************************************************
+void trace_writer::compress(const uint8_t *in, size_t len, vector<uint8_t> &out)
+{
+    const int hash_bits = 13;
+    int32_t table[1 << hash_bits];
+    memset(table, 0xff, sizeof(table));
+
+    out.clear();
+
+    auto read32 = [in](size_t i)
+    {
+        uint32_t v;
+        memcpy(&v, in + i, 4);
+        return v;
+    };
+
+    auto put_length = [&out](size_t n)
+    {
+        for (; n >= 255; n -= 255)
+            out.push_back(255);
+        out.push_back(static_cast<uint8_t>(n));
+    };
+
+    auto put_sequence = [&](size_t lit_start, size_t lit_len, size_t dist, size_t match_len)
+    {
+        size_t ml = match_len ? match_len - 4 : 0;
+        out.push_back(static_cast<uint8_t>(((lit_len < 15 ? lit_len : 15) << 4) | (ml < 15 ? ml : 15)));
+        if (lit_len >= 15)
+            put_length(lit_len - 15);
+        out.insert(out.end(), in + lit_start, in + lit_start + lit_len);
+        if (!match_len)
+            return;
+        out.push_back(static_cast<uint8_t>(dist));
+        out.push_back(static_cast<uint8_t>(dist >> 8));
+        if (ml >= 15)
+            put_length(ml - 15);
+    };
+
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + 4 <= len)
+    {
+        uint32_t v = read32(i);
+        uint32_t h = (v * 2654435761u) >> (32 - hash_bits);
+        int32_t cand = table[h];
+        table[h] = static_cast<int32_t>(i);
+
+        if (cand < 0 || i - cand > 0xffff || read32(cand) != v)
+        {
+            ++i;
+            continue;
+        }
+
+        size_t n = 4;
+        while (i + n < len && in[cand + n] == in[i + n])
+            ++n;
+
+        put_sequence(anchor, i - anchor, i - cand, n);
+        i += n;
+        anchor = i;
+    }
+
+    put_sequence(anchor, len - anchor, 0, 0);
+}
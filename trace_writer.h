@@ -0,0 +1,48 @@
+//******************************************************************************
+// Yusuf Oner
+// z2048138
+// CSCI 463
+//
+// I certify that this is my own work, and where applicable an extension
+// of the starter code for the assignment.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "trace_record.h"
+
+using namespace std;
+
+//******************************************************************************
+// This class writes a binary trace of retired instructions. Records are
+// delta-encoded into a block buffer and every full block is compressed and
+// written out, so a trace of a long run stays small and cheap to produce.
+//******************************************************************************
+class trace_writer : public trace_sink
+{
+public:
+    ~trace_writer();
+
+    bool open(const string &fname, uint64_t mem_size);
+    void write(const trace_record &r) override;
+    void close(bool halted, const string &halt_reason, uint64_t insn_count);
+
+    static void compress(const uint8_t *in, size_t len, vector<uint8_t> &out);
+
+private:
+    void put_varint(uint32_t v);
+    void put_svarint(uint32_t v);
+    void flush_block();
+
+    ofstream out;
+    vector<uint8_t> raw;
+    vector<uint8_t> packed;
+    uint32_t prev_pc = 0xfffffffc;
+    uint32_t prev_addr = 0;
+    uint32_t last_value[32] = {};
+};